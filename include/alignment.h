@@ -0,0 +1,139 @@
+#ifndef ALIGNMENT_H
+#define ALIGNMENT_H
+
+#include <utility>
+#include <vector>
+
+#include "inventory.h"
+#include "wordlist.h"
+
+#define ALIGN_MATCH 4           // Score of aligning two identical phonemes
+#define ALIGN_GAP 4             // Penalty of aligning a phoneme with nothing
+#define ALIGN_LANES 8           // Target words scored at once by align_all
+#define ALIGN_MAX_LENGTH 2048   // Longest word scored in 16 bit lanes, longer words are scored one at a time
+
+/*
+ * global: Needleman-Wunsch, both words are aligned from end to end
+ * local:  Smith-Waterman, only the best scoring pair of substrings is aligned
+ */
+enum class AlignMode {global, local};
+
+/* Positions of the aligned phonemes of two words, -1 where one side has a gap */
+struct Alignment {
+    int score = 0;
+    std::vector<std::pair<int, int>> pairs;
+};
+
+/*
+ * How often every phoneme of one language was aligned with every phoneme of
+ * another. The last row and column count gaps.
+ */
+class Correspondences {
+private:
+    int rows;
+    int columns;
+    std::vector<unsigned long> counts;      // counts[a * columns + b]
+public:
+    Correspondences(int size_a, int size_b)
+        : rows(size_a + 1), columns(size_b + 1), counts(rows * columns, 0) {}
+
+    /* Count the pairs of an alignment of two words of dense indices */
+    void add(const Alignment&, const unsigned short* a, const unsigned short* b);
+
+    /* Add the counts of another table of the same size */
+    void merge(const Correspondences&);
+
+    unsigned long get(int a, int b) const { return counts[a * columns + b]; }
+    int get_gap_a() const { return rows - 1; }
+    int get_gap_b() const { return columns - 1; }
+};
+
+/*
+ * Aligns words of one language (a) with words of another (b).
+ *
+ * Aligning two phonemes scores ALIGN_MATCH minus the number of feature
+ * nibbles they differ in, so identical phonemes score 4 and phonemes
+ * differing in every nibble score -4. Gaps score -ALIGN_GAP each. The
+ * substitution scores are computed once per pair of inventories.
+ *
+ * align_all scores a word of a against ALIGN_LANES words of b at once in
+ * 16 bit SIMD lanes, one target word per lane. Words are short, so lanes
+ * over the target words keep every lane busy where lanes over the positions
+ * of one word would mostly hold padding.
+ */
+class Aligner {
+private:
+    Inventory inventory_a;
+    Inventory inventory_b;
+    AlignMode mode;
+    std::vector<short> scores;              // scores[a * size_b + b]
+
+    /* Returns true if a word contains a phoneme not in the inventory */
+    bool to_dense(const Inventory&, const WordList&, std::vector<unsigned short>& dense,
+                  std::vector<unsigned int>& offsets) const;
+
+    /*
+     * Score every word of a against every word of b, split between threads
+     * over the words of b. visit(a, b, scores, count, thread) receives the
+     * scores of a against words b to b + count - 1.
+     */
+    template<typename Visitor>
+    void sweep(const std::vector<unsigned short>& dense_a, const std::vector<unsigned int>& offsets_a,
+               const std::vector<unsigned short>& dense_b, const std::vector<unsigned int>& offsets_b,
+               int threads, Visitor visit) const;
+public:
+    Aligner(const Inventory& a, const Inventory& b, AlignMode mode = AlignMode::global);
+
+    /* Score of the best alignment of two words of dense indices */
+    int score(const unsigned short* a, int len_a, const unsigned short* b, int len_b) const;
+
+    /*
+     * Align two words of dense indices. The pairs of a local alignment only
+     * cover the aligned substrings.
+     */
+    Alignment align(const unsigned short* a, int len_a, const unsigned short* b, int len_b) const;
+
+    /*
+     * Align two words of phoneme IDs
+     *
+     * Returns true if a phoneme is not in its inventory
+     * Returns false otherwise
+     */
+    bool align(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b, Alignment& output) const;
+
+    /*
+     * Score every word of a against every word of b, the score of a[i] and
+     * b[j] is stored at output[i * b.size() + j]
+     *
+     * Returns true if a phoneme is not in its inventory
+     * Returns false otherwise
+     */
+    bool align_all(const WordList& a, const WordList& b, std::vector<short>& output, int threads = 0) const;
+
+    /*
+     * The best scoring word of b for every word of a, the first one on ties.
+     * Scores are INT_MIN if b is empty.
+     *
+     * Returns true if a phoneme is not in its inventory
+     * Returns false otherwise
+     */
+    bool best_matches(const WordList& a, const WordList& b, std::vector<std::pair<unsigned int, int>>& output,
+                      int threads = 0) const;
+
+    /*
+     * Align every pair of words that are each other's best match and score
+     * at least min_score, counting the phonemes aligned with each other.
+     * The pairs are stored in matches.
+     *
+     * Returns true if a phoneme is not in its inventory
+     * Returns false otherwise
+     */
+    bool correspondences(const WordList& a, const WordList& b, int min_score, Correspondences& output,
+                         std::vector<std::pair<unsigned int, unsigned int>>& matches, int threads = 0) const;
+
+    const Inventory& get_inventory_a() const { return inventory_a; }
+    const Inventory& get_inventory_b() const { return inventory_b; }
+    AlignMode get_mode() const { return mode; }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <istream>
+#include <vector>
+
+#include "inventory.h"
+#include "parallel.h"
+
+/* Marks the end of a word in a flat corpus buffer (never a valid phoneme ID) */
+#define WORD_BOUNDARY 0x0
+
+/*
+ * Reads a corpus a chunk at a time so memory stays constant.
+ *
+ * Binary corpora are a stream of 32 bit little-endian phoneme IDs with
+ * WORD_BOUNDARY after every word. Text corpora have one word per line with
+ * phoneme symbols separated by spaces, and need an inventory to parse.
+ */
+class CorpusReader {
+private:
+    std::istream& input;
+    const Inventory* inventory;         // nullptr for binary corpora
+    std::vector<unsigned int> carry;    // Partial word left over from the last chunk
+    unsigned long failed;               // Text lines that could not be parsed
+public:
+    CorpusReader(std::istream& input, const Inventory* inventory = nullptr)
+        : input(input), inventory(inventory), failed(0) {}
+
+    /*
+     * Fill chunk with whole words, each followed by WORD_BOUNDARY, using
+     * roughly max_ids IDs. A word longer than max_ids is never split, the
+     * chunk grows to hold it.
+     *
+     * Returns false once the corpus is exhausted and chunk is empty
+     */
+    bool next(std::vector<unsigned int>& chunk, size_t max_ids);
+
+    unsigned long get_failed() const { return failed; }
+};
+
+/*
+ * Split a chunk into one batch per thread without splitting words, and call
+ * fn(begin, end, batch) with pointers to the words of each batch
+ */
+template<typename Function>
+void parallel_words(const std::vector<unsigned int>& chunk, int threads, Function fn) {
+    const unsigned int* data = chunk.data();
+    size_t len = chunk.size();
+
+    parallel_batches(len, threads, [&](size_t begin, size_t end, int batch) {
+        // Move both ends forward to the next word boundary
+        while (begin > 0 && begin < len && data[begin - 1] != WORD_BOUNDARY) {
+            begin++;
+        }
+
+        while (end < len && data[end - 1] != WORD_BOUNDARY) {
+            end++;
+        }
+
+        if (begin < end) {
+            fn(data + begin, data + end, batch);
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef DERIVATION_H
+#define DERIVATION_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+
+/*
+ * Derives a lexicon through an ordered list of rules, keeping every
+ * intermediate form so that edits only re-derive what they can affect.
+ *
+ * Stage 0 holds the underlying forms and stage r + 1 holds the output of
+ * rule r. Rules never change the length of a word, so all stages share the
+ * same word offsets.
+ *
+ * For every rule a dependency index records
+ *  - which words contain each phoneme in the rule's input
+ *  - which words the rule was blocked on, keyed by the missing result ID
+ * Editing a rule only re-derives words containing a phoneme in the old or new
+ * cur_class, and adding a phoneme only re-derives words blocked on it.
+ * Words whose output is unchanged stop propagating to later rules.
+ */
+class Derivation {
+private:
+    typedef std::unordered_map<unsigned int, std::vector<unsigned int>> Postings;
+
+    SoundSystem& sound_system;
+    Inventory inventory;
+    std::vector<Rule> rules;
+
+    std::vector<unsigned int> offsets;                  // Word i spans [offsets[i], offsets[i + 1])
+    std::vector<std::vector<unsigned int>> stages;      // Flat forms, one buffer per stage
+
+    /*
+     * Postings are append only, entries may be stale after a word changes.
+     * Stale entries only cost a redundant re-application of a rule.
+     */
+    std::vector<Postings> occurrences;                  // Per rule: input phoneme -> words
+    std::vector<Postings> blocked;                      // Per rule: missing result -> words
+
+    // Deduplication of words within a stage
+    std::vector<unsigned int> marks;
+    unsigned int epoch;
+
+    // Scratch buffers reused by derive_word
+    std::vector<unsigned int> scratch;
+    std::vector<unsigned int> missing;
+
+    void index_word(int rule, unsigned int word);
+
+    /*
+     * Re-applies a rule to a word and updates the index
+     * Returns true if the output of the rule changed
+     */
+    bool derive_word(int rule, unsigned int word);
+
+    /*
+     * Re-derive dirty words starting at rule from. Words blocked on added_id
+     * are re-derived as well (0x0 for none).
+     *
+     * Returns the number of rule applications performed
+     */
+    long propagate(int from, std::vector<unsigned int>& dirty, unsigned int added_id);
+
+    bool mark(unsigned int word);
+public:
+    Derivation(SoundSystem&, const std::vector<Rule>&);
+
+    /* Adds a word and derives it through every rule, returns its index */
+    unsigned int add_word(const std::vector<unsigned int>&);
+
+    /*
+     * Replace the rule at the given index and re-derive affected words
+     *
+     * Returns the number of rule applications performed
+     */
+    long set_rule(int index, const Rule&);
+
+    /*
+     * Adds a phoneme to the sound system and re-derives words blocked on it
+     *
+     * Returns -1 if the phoneme could not be added
+     * Returns the number of rule applications performed otherwise
+     */
+    long insert_consonant(std::string symbol, unsigned int id);
+    long insert_vowel(std::string symbol, unsigned int id);
+
+    /* Form of a word after the given stage (0 is the underlying form), empty if either is out of range */
+    std::vector<unsigned int> get_form(unsigned int word, int stage) const;
+    std::vector<unsigned int> get_surface(unsigned int word) const { return get_form(word, rules.size()); }
+
+    int get_stage_count() const { return stages.size(); }
+    unsigned int get_word_count() const { return offsets.size() - 1; }
+    const Inventory& get_inventory() const { return inventory; }
+    const std::vector<Rule>& get_rules() const { return rules; }
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "inventory.h"
+
+/*
+ * Cost of inserting or deleting a phoneme.
+ * Substitutions cost between 1 and 8, so keeping this at half the maximum
+ * substitution cost keeps the weighted distance a metric.
+ */
+#define INDEL_COST 4
+
+/* Number of feature nibbles that differ between two phoneme IDs (0 to 8) */
+int feature_distance(unsigned int, unsigned int);
+
+/*
+ * Precomputed substitution costs between every pair of phonemes in an
+ * inventory, or between the phonemes of two inventories
+ */
+class CostMatrix {
+private:
+    int size;
+    int columns;
+    std::vector<unsigned char> costs;       // costs[a * columns + b]
+public:
+    CostMatrix(const Inventory& inventory) : CostMatrix(inventory, inventory) {}
+    CostMatrix(const Inventory& rows, const Inventory& columns);
+
+    int get_cost(int a, int b) const { return costs[a * columns + b]; }
+    int get_size() const { return size; }
+    int get_columns() const { return columns; }
+};
+
+/*
+ * Weighted edit distance between two words of dense phoneme indices
+ * Returns bound + 1 as soon as the distance is known to exceed bound
+ */
+int weighted_distance(const CostMatrix&, const unsigned short* a, int len_a,
+                      const unsigned short* b, int len_b, int bound);
+
+/*
+ * Bit-parallel (Myers/Hyyrö) unit-cost edit distance against a fixed pattern
+ * of at most 64 phonemes. Every weighted edit costs at least 1, so this is a
+ * lower bound of the weighted distance.
+ */
+class Pattern {
+private:
+    std::vector<uint64_t> peq;      // Bitmask of pattern positions per dense index
+    std::vector<unsigned short> symbols;
+    int len;
+public:
+    Pattern(int inventory_size) : peq(inventory_size, 0), len(0) {}
+
+    /* Returns true if the pattern is longer than 64 phonemes */
+    bool set(const unsigned short*, int);
+
+    int distance(const unsigned short* text, int text_len) const;
+    int get_length() const { return len; }
+};
+
+/*
+ * BK-tree over a lexicon using the weighted distance.
+ * Queries first check the unit-cost bound and only run the weighted
+ * distance on words that can still be within range.
+ */
+class SimilarityIndex {
+private:
+    struct Node {
+        unsigned int word;
+        unsigned int first_child;
+        unsigned int next_sibling;
+        unsigned short distance;        // Distance to the parent
+        unsigned short max_child;       // Largest distance to a child
+    };
+
+    Inventory inventory;
+    CostMatrix costs;
+    std::vector<Node> nodes;
+    std::vector<unsigned short> words;      // Dense indices of every word
+    std::vector<unsigned int> offsets;      // Word i spans [offsets[i], offsets[i + 1])
+
+    /*
+     * Visit every node that may be within radius of the query.
+     * visit(word, distance) returns the radius to use from then on.
+     */
+    template<typename Visitor>
+    void search(const std::vector<unsigned short>&, int radius, Visitor visit) const;
+
+    /* Returns true if the word contains a phoneme not in the inventory */
+    bool to_dense(const std::vector<unsigned int>&, std::vector<unsigned short>&) const;
+public:
+    SimilarityIndex(const Inventory&);
+
+    /*
+     * Adds a word to the index
+     * Returns the index of the word (or of an identical word already added)
+     * Returns -1 if the word contains a phoneme not in the inventory
+     */
+    long insert(const std::vector<unsigned int>&);
+
+    /* Every word within radius of the given word, as (word, distance) sorted by distance */
+    std::vector<std::pair<unsigned int, int>> within(const std::vector<unsigned int>&, int radius) const;
+
+    /* The k closest words, as (word, distance) sorted by distance */
+    std::vector<std::pair<unsigned int, int>> nearest(const std::vector<unsigned int>&, int k) const;
+
+    std::vector<unsigned int> get_word(unsigned int) const;
+    unsigned int get_word_count() const { return offsets.size() - 1; }
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "phonotactics.h"
+
+/* Decides whether a generated word is kept */
+typedef std::function<bool(const std::vector<unsigned int>&)> WordFilter;
+
+/*
+ * Generates random words from a language's phonotactics.
+ *
+ * A word is built by choosing a number of syllables from the listed ranges,
+ * then a type (such as CCVC) for each syllable and a random allowed sequence
+ * of the right length for each of its constituents.
+ */
+class Generator {
+private:
+    struct Shape {
+        int lengths[3];     // Onset, nucleus and coda lengths
+    };
+
+    const Phonotactics& phonotactics;
+    std::mt19937 rng;
+    std::vector<Shape> shapes;                              // Types with sequences of every length needed
+    std::vector<std::vector<std::vector<unsigned int>>> by_length[3];   // by_length[part][len]
+
+    const std::vector<unsigned int>* pick(int part, int len);
+public:
+    Generator(const Phonotactics&, unsigned int seed = 0);
+
+    /*
+     * Generate a word that passes the filter (if given)
+     *
+     * Returns true if no word passed within max_attempts
+     * Returns false otherwise
+     */
+    bool generate(std::vector<unsigned int>& word, const WordFilter& filter = WordFilter(), int max_attempts = 100);
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+
+/*
+ * Simulates a lexicon through hundreds of ordered sound changes.
+ *
+ * Only the underlying forms are stored in full. Each stage is stored as the
+ * list of positions the rule changed, sorted by word. A full snapshot is kept
+ * every checkpoint_interval stages so that reading a word at any stage never
+ * replays more than checkpoint_interval stages of changes.
+ */
+class History {
+public:
+    /* A segment changed by a stage */
+    struct Change {
+        unsigned int word;
+        unsigned int position;
+        unsigned int id;            // New ID of the segment
+    };
+private:
+    Inventory inventory;
+    std::vector<Rule> rules;
+    int checkpoint_interval;
+
+    std::vector<unsigned int> offsets;                  // Word i spans [offsets[i], offsets[i + 1])
+    std::vector<unsigned int> underlying;
+    std::vector<std::vector<Change>> changes;           // changes[r] holds the changes made by rule r
+    std::vector<std::vector<unsigned int>> checkpoints; // checkpoints[c] is stage (c + 1) * checkpoint_interval
+
+    /* Range of changes made by a rule to a word */
+    std::pair<const Change*, const Change*> find_changes(int rule, unsigned int word) const;
+public:
+    History(const Inventory&, const std::vector<Rule>&, int checkpoint_interval = 16);
+
+    unsigned int add_word(const std::vector<unsigned int>&);
+
+    /*
+     * Apply every rule to every word, replacing any previous run.
+     * The lexicon is split into one batch per thread and each batch runs
+     * through all stages independently (0 threads uses every core).
+     */
+    void run(int threads = 0);
+
+    /* Form of a word after the given stage (0 is the underlying form), empty if either is out of range */
+    std::vector<unsigned int> get_form(unsigned int word, int stage) const;
+
+    /*
+     * Returns the index of the last rule that changed the segment at position
+     * on or before the given stage
+     * Returns -1 if the segment is unchanged from the underlying form, or if
+     * the word, position or stage is out of range
+     */
+    int changed_by(unsigned int word, unsigned int position, int stage) const;
+
+    /* Every change made to a word, in stage order (stage = rule + 1) */
+    std::vector<std::pair<int, Change>> trace(unsigned int word) const;
+
+    /* Bytes used by forms, changes and checkpoints */
+    size_t get_memory() const;
+
+    int get_stage_count() const { return rules.size() + 1; }
+    unsigned int get_word_count() const { return offsets.size() - 1; }
+    size_t get_change_count(int rule) const { return changes[rule].size(); }
+};
+
+#endif
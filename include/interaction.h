@@ -0,0 +1,112 @@
+#ifndef INTERACTION_H
+#define INTERACTION_H
+
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+
+/* Ways the changes of one rule can affect another, as bits */
+#define INTERACTION_FEEDS 0x1       // Puts a segment into a class the other rule needs
+#define INTERACTION_BLEEDS 0x2      // Takes a segment out of a class the other rule needs
+#define INTERACTION_TARGETS 0x4     // Changes a segment the other rule would change differently
+
+/*
+ * Static analysis of which rules of an ordered list interact.
+ *
+ * Rules only compare phonemes against bitmask classes, so everything a rule
+ * can do is the finite set of changes x -> y over the inventory where x is
+ * in cur_class and y is its result. A later rule can only be affected by
+ * such a change if x and y differ in a class it reads: cur_class, its
+ * environment, and for a projected rule the classes of its tier. Rules that
+ * do not affect each other read the same segments whether or not the other
+ * applied first, so they can apply to a word at the same time.
+ *
+ * Rules are grouped into passes: a rule goes in the pass after every
+ * earlier rule that affects it, and no earlier than an earlier rule it
+ * affects. Applying each pass at once to the output of the one before gives
+ * the same outputs as applying the rules in order.
+ *
+ * The analysis is over the inventory it was made with. Tier conditions are
+ * ignored, so it can only report more interactions than there are.
+ */
+class Interactions {
+private:
+    int count;
+    std::vector<unsigned char> effects;     // effects[a * count + b]
+    std::vector<int> passes;                // Pass of each rule
+    int pass_count = 0;
+public:
+    Interactions(const Inventory&, const std::vector<Rule>&);
+
+    /* INTERACTION_* bits of how the changes of rule a can affect rule b, in either order */
+    unsigned int get(int a, int b) const { return effects[a * count + b]; }
+
+    /* Returns true if a is before b and affects it, so b has to be applied after a */
+    bool depends(int a, int b) const { return a < b && effects[a * count + b] != 0; }
+
+    int get_pass(int rule) const { return passes[rule]; }
+    int get_pass_count() const { return pass_count; }
+    int get_rule_count() const { return count; }
+
+    /* Rules of every pass, in their original order */
+    std::vector<std::vector<int>> get_passes() const;
+};
+
+/* Names of the INTERACTION_* bits set in effects, such as "feeds, bleeds" */
+std::string interaction_names(unsigned int effects);
+
+/*
+ * An ordered list of rules applied a pass of Interactions at a time, giving
+ * the same outputs as applying every rule in order.
+ *
+ * The local rules of a pass are fused into one sweep over the word: no two
+ * of them can change the same phoneme, so a table gives the one rule to
+ * check at each position. Projected rules of a pass read the input of the
+ * pass and their changes are merged into its output.
+ */
+class Cascade {
+private:
+    Inventory inventory;
+    std::vector<Rule> rules;
+    Interactions interactions;
+
+    std::vector<int> first;                 // Rules of pass p are order[first[p], first[p + 1])
+    std::vector<int> order;
+    std::vector<int> targets;               // targets[p * size + index], local rule changing a phoneme in pass p, -1 if none
+
+    // Open addressing table from ID to inventory index, faster than Inventory::index_of on the hot path
+    std::vector<unsigned int> slots;        // 0 if empty, which is never a phoneme
+    std::vector<int> slot_indices;
+    int shift;
+
+    int find(unsigned int id) const {
+        for (size_t s = (id * 0x9e3779b1u) >> shift; ; s = (s + 1) & (slots.size() - 1)) {
+            if (slots[s] == id || slots[s] == 0) {
+                return slot_indices[s];
+            }
+        }
+    }
+
+    int apply_pass(int pass, const unsigned int* word, unsigned int* output, int len) const;
+public:
+    Cascade(const Inventory&, const std::vector<Rule>&);
+
+    /*
+     * Apply every rule to a word of len phonemes, writing the result to
+     * output. Tier conditions see every segment unmarked, as in Rule::apply
+     * without tiers. Changes to a traced word are recorded with the index of
+     * their rule.
+     *
+     * Returns the number of changes made by all rules
+     */
+    int apply(const unsigned int* word, unsigned int* output, int len) const;
+
+    std::vector<unsigned int> apply(const std::vector<unsigned int>&) const;
+
+    const Interactions& get_interactions() const { return interactions; }
+    int get_pass_count() const { return interactions.get_pass_count(); }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "soundsystem.h"
+#include "tiers.h"
+
+/*
+ * Compiled, read-only view of a SoundSystem.
+ *
+ * Phonemes are stored sorted by ID so that every phoneme has a dense index
+ * (0 to size() - 1). Tables sized by the inventory should be indexed by it
+ * instead of by the sparse 28 bit IDs.
+ * Suprasegmentals are not phonemes and have no index, only a mark per
+ * tier value.
+ */
+class Inventory {
+private:
+    std::vector<unsigned int> ids;          // Sorted phoneme IDs
+    std::vector<std::string> symbols;       // symbols[i] is the symbol of ids[i]
+    std::unordered_map<std::string, int> indices;   // Symbol -> dense index
+    size_t max_length = 0;                  // Longest symbol in bytes
+    std::vector<std::string> marks[NUM_TIERS];      // marks[tier][value], empty if there is none
+public:
+    Inventory() {}
+    Inventory(const SoundSystem&);
+
+    /*
+     * Returns the dense index of the phoneme with the given ID
+     * Returns -1 if the phoneme is not in the inventory
+     */
+    int index_of(unsigned int id) const;
+
+    bool contains(unsigned int id) const { return index_of(id) >= 0; }
+
+    /*
+     * Parse a word written as phoneme symbols separated by spaces
+     *
+     * Returns true if a symbol is not in the inventory
+     * Returns false otherwise
+     */
+    bool parse(const std::string&, std::vector<unsigned int>&) const;
+
+    /*
+     * Split text into phonemes, always taking the longest symbol that matches.
+     * Spaces between symbols are optional. With ipa_fallback, text that is
+     * not a symbol of the inventory is matched against the standard IPA
+     * table, which can give IDs the inventory does not contain.
+     *
+     * Returns true if part of the text is not a symbol in the inventory (or the IPA table)
+     * Returns false otherwise
+     */
+    bool tokenize(const std::string&, std::vector<unsigned int>&, bool ipa_fallback = false) const;
+
+    /* Concatenate the symbols of a sequence of phoneme IDs */
+    std::string render(const std::vector<unsigned int>&) const;
+
+    /*
+     * Concatenate the symbols of a word starting at offset in the segments
+     * the tiers belong to, with their suprasegmental marks. Stress is
+     * written before the first segment it spans, tone after the last and
+     * length after every segment.
+     */
+    std::string render(const unsigned int* word, int len, const Tiers&, size_t offset) const;
+
+    /* Returns the mark of a value on a tier, or the empty string if it has none */
+    const std::string& get_mark(Tier, unsigned int value) const;
+
+    int size() const { return ids.size(); }
+    unsigned int get_id(int index) const { return ids[index]; }
+    const std::string& get_symbol(int index) const { return symbols[index]; }
+    const std::vector<unsigned int>& get_ids() const { return ids; }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef INVERSE_H
+#define INVERSE_H
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+#include "phonotactics.h"
+#include "lexicon.h"
+
+#define INVERSE_CACHE (1 << 16)     // Entries kept per cache before it is cleared
+
+/*
+ * Finds every underlying form an ordered list of rules derives a surface
+ * form from, such as /vednel/ for [vennel].
+ *
+ * A rule maps x to x + (res_class - cur_class), so each rule is inverted
+ * once into a table giving, for every phoneme of the inventory, the
+ * phonemes the rule changes into it. Undoing a rule then chooses at every
+ * position either the phoneme itself or one of those sources, left to
+ * right, and drops a choice as soon as the environment of a position is
+ * known and applying the rule would not give back the surface phoneme.
+ * Projected rules read the whole tier, so their choices are only checked
+ * once the word is complete. Rules are undone from the last to the first.
+ *
+ * Underlying forms can be required to be well-formed by the phonotactics
+ * and to be words of a lexicon. Both also prune the search for the first
+ * rule: a prefix no well-formed word or no word of the lexicon starts with
+ * is never extended. Intermediate forms are not underlying forms, so the
+ * searches for later rules are not pruned.
+ *
+ * As in a Lattice, an optional rule may be left out wherever it matches,
+ * unless set_optional(false) makes every rule obligatory as in
+ * Rule::apply. An optional projected rule is only undone where it applied
+ * along the whole tier or not at all. Tier conditions see every segment
+ * unmarked. Morpheme boundaries are kept in the forms but ignored by the
+ * phonotactics and the lexicon.
+ */
+class Inverse {
+public:
+    /*
+     * Results of earlier queries, lexicon prefixes and scratch buffers,
+     * reused between the queries of one thread. Only optional rules let two forms share an
+     * intermediate form, and then mostly forms of the same query, so
+     * intermediate forms are only remembered within a query. A cache is
+     * cleared when it is used with another Inverse, or after a setter.
+     */
+    class Cache {
+    private:
+        struct Entry {
+            std::vector<std::vector<unsigned int>> forms;
+            bool cut;                   // The search stopped at its limit, so forms may be missing
+        };
+
+        // Buffers of undoing one rule, reused since a search undoes one word per rule at a time
+        struct Workspace {
+            std::vector<unsigned int> choices;  // Choices of position i are [first[i], first[i + 1])
+            std::vector<int> first;
+            std::vector<int> checked;           // Positions checked once position i is chosen are [checked[i], checked[i + 1])
+            std::vector<unsigned int> input;
+            std::vector<unsigned int> output;
+            std::vector<unsigned int> prefix;
+            std::vector<int> depth;
+            std::vector<int> chosen;
+        };
+
+        std::unordered_map<std::string, Entry> results;
+        std::unordered_map<std::string, bool> prefixes;     // Lexicon prefix -> some word starts with it
+        std::vector<Workspace> workspaces;                  // One per rule
+        unsigned long stamp = 0;                            // Inverse::stamp the results are for
+
+        friend class Inverse;
+    public:
+        void clear() { results.clear(); prefixes.clear(); }
+        size_t size() const { return results.size() + prefixes.size(); }
+    };
+
+private:
+    Inventory inventory;
+    std::vector<Rule> rules;
+    const Phonotactics* phonotactics = nullptr;
+    const Lexicon* lexicon = nullptr;
+    bool optional = true;                   // Optional rules may be left out
+    bool has_optional = false;
+
+    std::vector<std::vector<std::vector<unsigned int>>> sources;   // sources[r][index], phonemes rule r changes into a phoneme
+    Cache cache;
+    unsigned long stamp;                    // Unique to the rules and settings, renewed by every setter
+
+    void restamp();
+
+    /* Returns true if the phonotactics and the lexicon allow an underlying form */
+    bool accepts(const std::vector<unsigned int>& form) const;
+
+    /* Returns true if some word of the lexicon starts with the prefix */
+    bool starts_word(const std::vector<unsigned int>& prefix, Cache&) const;
+
+    /*
+     * Call visit with every form rule r changes into form, until it returns true
+     *
+     * Returns true if visit stopped the search
+     */
+    template<typename Visit>
+    bool undo(int r, const std::vector<unsigned int>& form, Cache&, Visit visit) const;
+
+    /*
+     * Add the underlying forms of a form after stage rules to found, unless
+     * it is in seen, the intermediate forms already searched
+     *
+     * Returns true if found reached limit
+     */
+    bool search(int stage, const std::vector<unsigned int>& form, Cache&, size_t limit,
+                std::set<std::vector<unsigned int>>& found, std::unordered_set<std::string>& seen) const;
+public:
+    Inverse(const Inventory&, const std::vector<Rule>&);
+
+    /* Only keep underlying forms the phonotactics validate, nullptr to keep all */
+    void set_phonotactics(const Phonotactics* phonotactics) { this->phonotactics = phonotactics; restamp(); }
+
+    /* Only keep underlying forms in the lexicon, nullptr to keep all */
+    void set_lexicon(const Lexicon* lexicon) { this->lexicon = lexicon; restamp(); }
+
+    /* Let optional rules be left out where they match, or treat every rule as obligatory */
+    void set_optional(bool optional) { this->optional = optional; restamp(); }
+
+    /*
+     * Find the underlying forms of a surface form, sorted by their IDs. If
+     * there are more than limit, limit of them are returned and which ones
+     * is unspecified.
+     *
+     * Returns true if there are more than limit forms
+     * Returns false otherwise
+     */
+    bool invert(const std::vector<unsigned int>& surface, std::vector<std::vector<unsigned int>>& forms,
+                size_t limit, Cache&) const;
+    bool invert(const std::vector<unsigned int>& surface, std::vector<std::vector<unsigned int>>& forms,
+                size_t limit = 1000) {
+        return invert(surface, forms, limit, cache);
+    }
+
+    /*
+     * invert() every surface form, split over threads (0 for one per core)
+     * with one cache each. cut[i] is set if word i has more than limit forms
+     * (if given).
+     */
+    std::vector<std::vector<std::vector<unsigned int>>> invert_all(const std::vector<std::vector<unsigned int>>& surfaces,
+                                                                   size_t limit, int threads = 0,
+                                                                   std::vector<bool>* cut = nullptr) const;
+
+    int get_rule_count() const { return rules.size(); }
+};
+
+#endif
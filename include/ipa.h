@@ -0,0 +1,194 @@
+#ifndef IPA_H
+#define IPA_H
+
+#include <cstddef>
+#include <string>
+
+/* A standard IPA phoneme */
+struct IpaEntry {
+    unsigned int id;
+    const char* symbol;
+    const char* desc;
+};
+
+/*
+ * The IPA IDs listed in the README, compiled in and sorted by ID.
+ *
+ * Languages can list a phoneme by its symbol or ID alone and the table
+ * supplies the other. Lookups read the table directly and never allocate.
+ * Two symbols are shared by a dental and an alveolar phoneme (tʼ and ɗ),
+ * those resolve to the alveolar.
+ */
+class Ipa {
+public:
+    static constexpr IpaEntry table[] = {
+        {0x0000221, "pʼ", "Bilabial Ejective"},
+        {0x0000241, "ʘ", "Bilabial Click"},
+        {0x0000421, "tʼ", "Dental Ejective"},
+        {0x0000441, "ǀ", "Dental Click"},
+        {0x0000521, "tʼ", "Alveolar Ejective"},
+        {0x0000741, "ǃ", "Postalveolar Click"},
+        {0x0000a21, "kʼ", "Velar Ejective"},
+        {0x0006541, "ǁ", "Alveolar Lateral Click"},
+        {0x0009741, "ǂ", "Palato-Alveolar Click"},
+        {0x0040521, "sʼ", "Alveolar Fricative Ejective"},
+        {0x0110211, "p", "Voiceless Bilabial Plosive"},
+        {0x0110511, "t", "Voiceless Alveolar Plosive"},
+        {0x0110811, "ʈ", "Voiceless Retroflex Plosive"},
+        {0x0110911, "c", "Voiceless Palatal Plosive"},
+        {0x0110a11, "k", "Voiceless Velar Plosive"},
+        {0x0110b11, "q", "Voiceless Uvular Plosive"},
+        {0x0110d11, "ʔ", "Voiceless Glottal Plosive"},
+        {0x0111a11, "k͡p", "Voiceless Labial-Velar Plosive"},
+        {0x0130511, "t͡s", "Voiceless Alveolar Affricate"},
+        {0x0130711, "t͡ʃ", "Voiceless Postalveolar Affricate"},
+        {0x0130811, "ʈ͡ʂ", "Voiceless Retroflex Affricate"},
+        {0x0139511, "t͡ɕ", "Voiceless Alveolo-Palatal Affricate"},
+        {0x0140211, "ɸ", "Voiceless Bilabial Fricative"},
+        {0x0140311, "f", "Voiceless Labiodental Fricative"},
+        {0x0140411, "θ", "Voiceless Dental Fricative"},
+        {0x0140511, "s", "Voiceless Alveolar Fricative"},
+        {0x0140711, "ʃ", "Voiceless Postalveolar Fricative"},
+        {0x0140811, "ʂ", "Voiceless Retroflex Fricative"},
+        {0x0140911, "ç", "Voiceless Palatal Fricative"},
+        {0x0140a11, "x", "Voiceless Velar Fricative"},
+        {0x0140b11, "χ", "Voiceless Uvular Fricative"},
+        {0x0140c11, "ħ", "Voiceless Pharyngeal Fricative"},
+        {0x0140d11, "h", "Voiceless Glottal Fricative"},
+        {0x0146511, "ɬ", "Voiceless Alveolar Lateral Fricative"},
+        {0x0147a11, "ɧ", "Voiceless Velar and Postalveolar Fricative"},
+        {0x0149511, "ɕ", "Voiceless Alveolo-Palatal Fricative"},
+        {0x0181a11, "ʍ", "Voiceless Labial-Velar Glide"},
+        {0x0200231, "ɓ", "Bilabial Implosive"},
+        {0x0200431, "ɗ", "Dental Implosive"},
+        {0x0200531, "ɗ", "Alveolar Implosive"},
+        {0x0200931, "ʄ", "Palatal Implosive"},
+        {0x0200a31, "ɠ", "Velar Implosive"},
+        {0x0200b31, "ʛ", "Uvular Implosive"},
+        {0x0210211, "b", "Voiced Bilabial Plosive"},
+        {0x0210511, "d", "Voiced Alveolar Plosive"},
+        {0x0210811, "ɖ", "Voiced Retroflex Plosive"},
+        {0x0210911, "ɟ", "Voiced Palatal Plosive"},
+        {0x0210a11, "g", "Voiced Velar Plosive"},
+        {0x0210b11, "ɢ", "Voiced Uvular Plosive"},
+        {0x0211a11, "ɡ͡b", "Voiced Labial-Velar Plosive"},
+        {0x0220211, "m", "Voiced Bilabial Nasal"},
+        {0x0220311, "ɱ", "Voiced Labiodental Nasal"},
+        {0x0220511, "n", "Voiced Alveolar Nasal"},
+        {0x0220811, "ɳ", "Voiced Retroflex Nasal"},
+        {0x0220911, "ɲ", "Voiced Palatal Nasal"},
+        {0x0220a11, "ŋ", "Voiced Velar Nasal"},
+        {0x0220b11, "ɴ", "Voiced Uvular Nasal"},
+        {0x0221a11, "ŋ͡m", "Voiced Labial-Velar Nasal"},
+        {0x0230511, "d͡z", "Voiced Alveolar Affricate"},
+        {0x0230711, "d͡ʒ", "Voiced Postalveolar Affricate"},
+        {0x0230811, "ɖ͡ʐ", "Voiced Retroflex Affricate"},
+        {0x0239511, "d͡ʑ", "Voiced Alveolo-Palatal Affricate"},
+        {0x0240211, "β", "Voiced Bilabial Fricative"},
+        {0x0240311, "v", "Voiced Labiodental Fricative"},
+        {0x0240411, "ð", "Voiced Dental Fricative"},
+        {0x0240511, "z", "Voiced Alveolar Fricative"},
+        {0x0240711, "ʒ", "Voiced Postalveolar Fricative"},
+        {0x0240811, "ʐ", "Voiced Retroflex Fricative"},
+        {0x0240911, "ʝ", "Voiced Palatal Fricative"},
+        {0x0240a11, "ɣ", "Voiced Velar Fricative"},
+        {0x0240b11, "ʁ", "Voiced Uvular Fricative"},
+        {0x0240c11, "ʕ", "Voiced Pharyngeal Fricative"},
+        {0x0240d11, "ɦ", "Voiced Glottal Fricative"},
+        {0x0246511, "ɮ", "Voiced Alveolar Lateral Fricative"},
+        {0x0249511, "ʑ", "Voiced Alveolo-Palatal Fricative"},
+        {0x0250211, "ʙ", "Voiced Bilabial Trill"},
+        {0x0250511, "r", "Voiced Alveolar Trill"},
+        {0x0250b11, "ʀ", "Voiced Uvular Trill"},
+        {0x0260211, "ⱱ", "Voiced Bilabial Flap"},
+        {0x0260511, "ɾ", "Voiced Alveolar Flap"},
+        {0x0260811, "ɽ", "Voiced Retroflex Flap"},
+        {0x0266511, "ɺ", "Voiced Alveolar Lateral Flap"},
+        {0x0270511, "ɹ", "Voiced Alveolar Liquid"},
+        {0x0270811, "ɻ", "Voiced Retroflex Liquid"},
+        {0x0276511, "l", "Voiced Alveolar Lateral Liquid"},
+        {0x0276911, "ʎ", "Voiced Palatal Lateral Liquid"},
+        {0x0276a11, "ʟ", "Voiced Velar Lateral Liquid"},
+        {0x0280311, "ʋ", "Voiced Labiodental Glide"},
+        {0x0280911, "j", "Voiced Palatal Glide"},
+        {0x0280a11, "ɰ", "Voiced Velar Glide"},
+        {0x0281911, "ɥ", "Voiced Labial-Palatal Glide"},
+        {0x0281a11, "w", "Voiced Labial-Velar Glide"},
+        {0x11221112, "i", "Close Front Unrounded Vowel"},
+        {0x11221122, "ɪ", "Near-Close Front Unrounded Vowel"},
+        {0x11221132, "e", "Close-Mid Front Unrounded Vowel"},
+        {0x11221142, "e̞", "Mid Front Unrounded Vowel"},
+        {0x11221152, "ɛ", "Open-Mid Front Unrounded Vowel"},
+        {0x11221162, "æ", "Near-Open Front Unrounded Vowel"},
+        {0x11221172, "a", "Open Front Unrounded Vowel"},
+        {0x11221212, "ɨ", "Close Central Unrounded Vowel"},
+        {0x11221222, "ɪ̈", "Near-Close Central Unrounded Vowel"},
+        {0x11221232, "ɘ", "Close-Mid Central Unrounded Vowel"},
+        {0x11221242, "ə", "Mid Central Unrounded Vowel"},
+        {0x11221252, "ɜ", "Open-Mid Central Unrounded Vowel"},
+        {0x11221262, "ɐ", "Near-Open Central Unrounded Vowel"},
+        {0x11221272, "ä", "Open Central Unrounded Vowel"},
+        {0x11221312, "ɯ", "Close Back Unrounded Vowel"},
+        {0x11221332, "ɤ", "Close-Mid Back Unrounded Vowel"},
+        {0x11221342, "ɤ̞", "Mid Back Unrounded Vowel"},
+        {0x11221352, "ʌ", "Open-Mid Back Unrounded Vowel"},
+        {0x11221372, "ɑ", "Open Back Unrounded Vowel"},
+        {0x11222112, "y", "Close Front Rounded Vowel"},
+        {0x11222122, "ʏ", "Near-Close Front Rounded Vowel"},
+        {0x11222132, "ø", "Close-Mid Front Rounded Vowel"},
+        {0x11222142, "ø̞", "Mid Front Rounded Vowel"},
+        {0x11222152, "œ", "Open-Mid Front Rounded Vowel"},
+        {0x11222172, "ɶ", "Open Front Rounded Vowel"},
+        {0x11222212, "ʉ", "Close Central Rounded Vowel"},
+        {0x11222222, "ʊ̈", "Near-Close Central Rounded Vowel"},
+        {0x11222232, "ɵ", "Close-Mid Central Rounded Vowel"},
+        {0x11222242, "ɵ̞", "Mid Central Rounded Vowel"},
+        {0x11222252, "ɞ", "Open-Mid Central Rounded Vowel"},
+        {0x11222262, "ɞ̞", "Near-Open Central Rounded Vowel"},
+        {0x11222272, "ɒ̈", "Open Central Rounded Vowel"},
+        {0x11222312, "u", "Close Back Rounded Vowel"},
+        {0x11222322, "ʊ", "Near-Close Back Rounded Vowel"},
+        {0x11222332, "o", "Close-Mid Back Rounded Vowel"},
+        {0x11222342, "o̞", "Mid Back Rounded Vowel"},
+        {0x11222352, "ɔ", "Open-Mid Back Rounded Vowel"},
+        {0x11222372, "ɒ", "Open Back Rounded Vowel"},
+        {0x21221152, "ɝ", "Rhotic Open-Mid Front Unrounded Vowel"},
+        {0x21221242, "ɚ", "Rhotic Mid Central Unrounded Vowel"},
+        {0x21221372, "ɑ˞", "Rhotic Open Back Unrounded Vowel"},
+        {0x21222352, "ɔ˞", "Rhotic Open-Mid Back Rounded Vowel"}
+    };
+
+    static constexpr int size = sizeof(table) / sizeof(IpaEntry);
+
+    /* Returns the index of an ID in the table, or -1 if it is not standard */
+    static constexpr int index_of(unsigned int id, int low = 0, int high = size) {
+        return low >= high ? -1
+            : table[(low + high) / 2].id == id ? (low + high) / 2
+            : table[(low + high) / 2].id < id ? index_of(id, (low + high) / 2 + 1, high)
+            : index_of(id, low, (low + high) / 2);
+    }
+
+    static constexpr bool is_sorted(int i = 1) {
+        return i >= size || (table[i - 1].id < table[i].id && is_sorted(i + 1));
+    }
+
+    /* Returns nullptr if the ID is not standard */
+    static const IpaEntry* find(unsigned int id) {
+        int index = index_of(id);
+        return index < 0 ? nullptr : &table[index];
+    }
+
+    /* Returns nullptr if the symbol is not standard */
+    static const IpaEntry* find(const std::string& symbol);
+
+    /*
+     * Find the longest standard symbol at the start of text
+     *
+     * Returns the length of the symbol in bytes, or 0 if none matches
+     */
+    static size_t match(const char* text, size_t len, unsigned int* id);
+};
+
+static_assert(Ipa::is_sorted(), "The IPA table must be sorted by ID");
+
+#endif
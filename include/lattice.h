@@ -0,0 +1,106 @@
+#ifndef LATTICE_H
+#define LATTICE_H
+
+#include <utility>
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+
+/*
+ * Every output of a word under optional rules, stored as a DAG of phoneme
+ * IDs. Variants share nodes wherever their futures are identical, so k
+ * independent optional applications need O(k) nodes instead of 2^k words.
+ *
+ * Node 0 is the start and the last node is the final node, nodes are in
+ * topological order and every path has the same length since rules never
+ * change the length of a word. The lattice is deterministic: every word is
+ * spelled by exactly one path, whose cost is the lowest cost of any of its
+ * derivations. Applying an optional rule with probability p costs -log(p)
+ * and leaving it out costs -log(1 - p).
+ */
+class Lattice {
+public:
+    struct Edge {
+        unsigned int to;
+        unsigned int id;
+        double cost;
+    };
+
+    /* Visits every word of a lattice in order of their IDs, one at a time */
+    class Cursor {
+    private:
+        const Lattice* lattice;
+        std::vector<unsigned int> path;     // Index of the edge taken at each position
+        std::vector<unsigned int> word;
+        std::vector<double> costs;          // Cost of the path up to each position
+        bool started = false;
+
+        void descend(unsigned int node);
+    public:
+        Cursor(const Lattice* lattice) : lattice(lattice) {}
+
+        /*
+         * Move to the next word
+         *
+         * Returns false once every word has been visited
+         */
+        bool next();
+
+        const std::vector<unsigned int>& get_word() const { return word; }
+        double get_cost() const { return costs.empty() ? 0.0 : costs.back(); }
+    };
+
+private:
+    std::vector<unsigned int> first;        // Edges of node n span [first[n], first[n + 1])
+    std::vector<Edge> edges;                // Sorted by ID within each node
+
+    Lattice(std::vector<std::vector<Edge>>& nodes);
+
+    /* apply() for a projected rule */
+    Lattice apply_projected(const Inventory&, const Rule&) const;
+
+    /* Merge paths spelling the same word, keeping the lowest cost */
+    Lattice determinize() const;
+
+    /* Merge nodes with identical outgoing edges */
+    Lattice minimize() const;
+
+    /* Lowest cost from every node to the final node */
+    std::vector<double> get_distances() const;
+public:
+    /* A lattice holding only the given word */
+    Lattice(const unsigned int* word, int len);
+    Lattice(const std::vector<unsigned int>& word) : Lattice(word.data(), word.size()) {}
+
+    /*
+     * Apply a rule to every word of the lattice. Where an optional rule
+     * matches, the lattice keeps both the changed and unchanged segment.
+     * A result is only used if it exists in the inventory.
+     */
+    Lattice apply(const Inventory&, const Rule&) const;
+
+    /* Number of words, saturating at the largest unsigned long long */
+    unsigned long long count() const;
+
+    /* Up to k words with the lowest costs, cheapest first */
+    std::vector<std::pair<double, std::vector<unsigned int>>> best(int k) const;
+
+    Cursor iterate() const { return Cursor(this); }
+
+    unsigned int get_node_count() const { return first.size() - 1; }
+    unsigned int get_edge_count() const { return edges.size(); }
+    unsigned int get_final() const { return first.size() - 2; }
+
+    const Edge* edges_begin(unsigned int node) const { return edges.data() + first[node]; }
+    const Edge* edges_end(unsigned int node) const { return edges.data() + first[node + 1]; }
+
+    size_t get_memory() const {
+        return first.capacity() * sizeof(unsigned int) + edges.capacity() * sizeof(Edge);
+    }
+};
+
+/* Apply an ordered list of rules to a word, keeping every optional output */
+Lattice derive_lattice(const Inventory&, const std::vector<Rule>&, const std::vector<unsigned int>& word);
+
+#endif
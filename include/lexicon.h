@@ -0,0 +1,131 @@
+#ifndef LEXICON_H
+#define LEXICON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wordlist.h"
+
+/*
+ * Sorted lexicon file over phoneme IDs, read through mmap.
+ *
+ * Words are sorted by their IDs (a prefix sorts before the words it starts)
+ * and stored in blocks of LEXICON_BLOCK words. Every word in a block stores
+ * how many IDs it shares with the previous word followed by the rest, all
+ * as varints, and the first word of a block shares nothing. A sparse index
+ * holds the offset of each block, so a lookup binary searches the first
+ * words of the blocks and decodes a single block.
+ *
+ * Each word can have a 32 bit payload, such as the offset of its gloss.
+ */
+
+#define LEXICON_MAGIC 0x58454c4c       // "LLEX"
+#define LEXICON_VERSION 1
+#define LEXICON_BLOCK 32
+
+class Lexicon {
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t block_size;
+        uint32_t has_payloads;
+        uint64_t word_count;
+        uint64_t block_count;
+        uint64_t index_offset;      // Block offsets, relative to data_offset
+        uint64_t payload_offset;
+        uint64_t data_offset;
+        uint64_t data_size;
+    };
+
+    const uint8_t* map = nullptr;
+    size_t map_size = 0;
+    Header header;
+    const uint64_t* index = nullptr;
+    const uint32_t* payloads = nullptr;
+    const uint8_t* data = nullptr;
+
+    const uint8_t* block_start(uint64_t block) const { return data + index[block]; }
+    const uint8_t* block_end(uint64_t block) const {
+        return data + (block + 1 < header.block_count ? index[block + 1] : header.data_size);
+    }
+
+    friend bool write_lexicon(std::string, const WordList&, const std::vector<uint32_t>*, int);
+public:
+    /* Reads consecutive words starting at any word */
+    class Cursor {
+    private:
+        const Lexicon* lexicon;
+        long ordinal;
+        long end;
+        const uint8_t* position;
+        const uint8_t* limit;           // End of the current block
+        bool corrupt;
+        std::vector<unsigned int> word;
+    public:
+        Cursor(const Lexicon*, long begin, long end);
+
+        /*
+         * Decode the next word
+         *
+         * Returns false once the end is reached, or a word runs past the end
+         * of its block
+         */
+        bool next();
+
+        /* Returns true if iteration stopped at a corrupt word */
+        bool is_corrupt() const { return corrupt; }
+
+        const std::vector<unsigned int>& get_word() const { return word; }
+
+        /* Position of the current word in the lexicon */
+        long get_ordinal() const { return ordinal - 1; }
+        uint32_t get_payload() const { return lexicon->get_payload(ordinal - 1); }
+    };
+
+    Lexicon() {}
+    ~Lexicon() { close(); }
+
+    Lexicon(const Lexicon&) = delete;
+    Lexicon& operator=(const Lexicon&) = delete;
+
+    /*
+     * Map a lexicon file
+     *
+     * Returns true if the file couldnt be opened or is not a lexicon
+     * Returns false otherwise
+     */
+    bool open(std::string path);
+    void close();
+
+    /* Position of the first word that is not less than the given word */
+    long lower_bound(const unsigned int* word, int len) const;
+
+    /* Returns the position of the word, or -1 if it is not in the lexicon */
+    long find(const unsigned int* word, int len) const;
+
+    /* Positions [first, second) of every word starting with the prefix */
+    std::pair<long, long> prefix_range(const unsigned int* prefix, int len) const;
+
+    /* Iterate over the words at positions [begin, end) */
+    Cursor iterate(long begin, long end) const { return Cursor(this, begin, end); }
+
+    uint32_t get_payload(long ordinal) const { return payloads != nullptr ? payloads[ordinal] : 0; }
+    long get_word_count() const { return map != nullptr ? header.word_count : 0; }
+    bool has_payloads() const { return payloads != nullptr; }
+};
+
+/*
+ * Sort, dedupe and write words to a lexicon file. A word that occurs more
+ * than once keeps the payload of its first occurrence.
+ *
+ * Returns true if the file couldnt be written, there are more words than
+ * 32 bit indices or fewer payloads than words
+ * Returns false otherwise
+ */
+bool write_lexicon(std::string path, const WordList& words,
+                   const std::vector<uint32_t>* payloads = nullptr, int threads = 0);
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef LING_H
+#define LING_H
+
+/*
+ * C interface of libling, for programs embedding the library.
+ *
+ * Languages are opaque handles. Every other call works on batches of words
+ * in buffers owned by the caller, so after loading nothing is allocated on
+ * the hot path and no C++ exception crosses the interface. A handle can be
+ * used from several threads at once.
+ *
+ * A batch of words is one array of phoneme IDs and an array of count + 1
+ * offsets, word i spanning [offsets[i], offsets[i + 1]). Texts are batched
+ * the same way over bytes.
+ *
+ * When an output buffer fills up the call stops after the last word that
+ * fits, sets written and returns LING_BUFFER_FULL. Calling again with the
+ * remaining words continues where it stopped.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a declaration in this file changes */
+#define LING_API_VERSION 1
+
+typedef enum {
+    LING_OK = 0,
+    LING_NOT_FOUND,         /* The language couldnt be loaded */
+    LING_UNKNOWN_SYMBOL,    /* A text or ID is not in the inventory, see the per word results */
+    LING_BUFFER_FULL,       /* The output buffer is too small for every word */
+    LING_UNAVAILABLE,       /* The language has no data for this call, such as phonotactics */
+    LING_INVALID,           /* A null pointer or inconsistent offsets */
+    LING_INTERNAL           /* An unexpected error inside the library */
+} ling_status;
+
+typedef struct ling_language ling_language;
+
+typedef struct {
+    const uint32_t* ids;
+    const uint32_t* offsets;
+    uint32_t count;
+} ling_words;
+
+typedef struct {
+    uint32_t* ids;
+    uint32_t capacity;      /* IDs that fit in ids */
+    uint32_t* offsets;      /* Room for count + 1 offsets */
+    uint32_t written;       /* Words written by the last call */
+} ling_word_buffer;
+
+typedef struct {
+    const char* data;
+    const uint32_t* offsets;
+    uint32_t count;
+} ling_texts;
+
+typedef struct {
+    char* data;
+    uint32_t capacity;      /* Bytes that fit in data */
+    uint32_t* offsets;      /* Room for count + 1 offsets */
+    uint32_t written;       /* Texts written by the last call */
+} ling_text_buffer;
+
+/* Returns LING_API_VERSION of the library, which can differ from the header a program was built with */
+int ling_version(void);
+
+/* Returns a constant description of a status */
+const char* ling_status_string(ling_status);
+
+/*
+ * Load langs/<name> relative to the working directory: its phonemes, and
+ * its rules and phonotactics if it has them
+ */
+ling_status ling_load(const char* name, ling_language** language);
+
+void ling_free(ling_language* language);
+
+/* Number of phonemes in the inventory of a language */
+uint32_t ling_inventory_size(const ling_language* language);
+
+/*
+ * Split texts into phoneme IDs, always taking the longest symbol that
+ * matches. Spaces between symbols are optional. A text with anything that
+ * is not a symbol gives an empty word, and failed[i] (if not null) is set
+ * to 1 for it and 0 for every other text.
+ *
+ * Returns LING_UNKNOWN_SYMBOL if any text failed
+ */
+ling_status ling_tokenize(const ling_language* language, const ling_texts* input,
+                          ling_word_buffer* output, uint8_t* failed);
+
+/*
+ * Apply the rules of the language to every word, in order. Outputs have
+ * the same length as their inputs.
+ */
+ling_status ling_derive(const ling_language* language, const ling_words* input, ling_word_buffer* output);
+
+/*
+ * Check every word against the phonotactics of the language, valid[i] is
+ * set to 1 if word i is well-formed and 0 otherwise
+ *
+ * Returns LING_UNAVAILABLE if the language has no phonotactics
+ */
+ling_status ling_validate(const ling_language* language, const ling_words* input, uint8_t* valid);
+
+/*
+ * Concatenate the symbols of every word. IDs that are not in the inventory
+ * are left out.
+ */
+ling_status ling_render(const ling_language* language, const ling_words* input, ling_text_buffer* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
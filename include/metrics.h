@@ -0,0 +1,86 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Runtime counters and timers.
+ *
+ * Every thread writes to its own block of relaxed atomics, so recording a
+ * value never contends with other threads. When a thread exits its block
+ * is added to a total and freed, and the total and the blocks of running
+ * threads are summed when the metrics are written. Without LING_METRICS the
+ * macros compile to nothing.
+ */
+
+enum class Counter {
+    phonemes_loaded = 0,
+    phonemes_rejected,
+    rule_matches,           // Positions where a rule's class and environment matched, except in Cascade passes
+    rule_applications,      // Positions a rule changed
+    rule_blocked,           // Matches whose result is not in the inventory
+    cache_hits,             // Stored forms reused instead of derived again
+    cache_misses,
+    bytes_written,          // Bytes written to language and model files
+    count
+};
+
+enum class Timer {
+    load_csv = 0,
+    parse_json,
+    apply_rules,
+    write_output,
+    count
+};
+
+namespace metrics {
+
+void add(Counter, uint64_t);
+void add_time(Timer, uint64_t nanoseconds);
+
+/* Write every counter and timer, summed over all threads, as JSON */
+void write_json(std::ostream&);
+
+/*
+ * Removes --stats from the arguments of a tool. If it was given the metrics
+ * are written to stderr as JSON when the tool exits.
+ */
+void enable_stats(int& argc, char* argv[]);
+
+/* Bytes written to a file stream so far, 0 if it failed and tellp() gives -1 */
+inline uint64_t stream_bytes(std::ostream& stream) {
+    std::streamoff offset = stream.tellp();
+    return offset < 0 ? 0 : static_cast<uint64_t>(offset);
+}
+
+/* Adds the lifetime of the object to a timer */
+class ScopedTimer {
+private:
+    Timer timer;
+    std::chrono::steady_clock::time_point start;
+public:
+    ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        add_time(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+}
+
+#define METRICS_CONCAT_(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_(a, b)
+
+#ifdef LING_METRICS
+#define LING_COUNT(counter, n) metrics::add(Counter::counter, (n))
+#define LING_TIME(timer) metrics::ScopedTimer METRICS_CONCAT(metrics_timer_, __LINE__)(Timer::timer)
+#else
+#define LING_COUNT(counter, n) do { (void)sizeof(n); } while (0)
+#define LING_TIME(timer) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MINIMALPAIRS_H
+#define MINIMALPAIRS_H
+
+#include <vector>
+
+#include "inventory.h"
+#include "wordlist.h"
+
+/*
+ * Finds every minimal pair (words of the same length that differ in exactly
+ * one segment) in a lexicon without comparing all pairs of words.
+ *
+ * Each word is hashed once per position with that position wildcarded.
+ * Words sharing a hash are candidates, grouped by sorting the hashes in
+ * independent shards on separate threads. Counts are kept per contrast in
+ * tables indexed by dense phoneme index. Duplicate words are counted once
+ * per copy, so lexicons should be deduplicated first.
+ */
+class MinimalPairs {
+public:
+    struct Pair {
+        unsigned int first;         // Word indices
+        unsigned int second;
+        unsigned int position;
+    };
+
+    struct Contrast {
+        unsigned int first;         // Phoneme IDs, first < second
+        unsigned int second;
+        unsigned long count;
+    };
+private:
+    Inventory inventory;
+    std::vector<Contrast> contrasts;
+    std::vector<Pair> pairs;
+public:
+    MinimalPairs(const Inventory& inventory) : inventory(inventory) {}
+
+    /*
+     * Find minimal pairs in a lexicon, replacing previous results.
+     * Pairs are only kept if keep_pairs is true (0 threads uses every core).
+     *
+     * Returns true if a word contains a phoneme not in the inventory
+     * Returns false otherwise
+     */
+    bool find(const WordList&, bool keep_pairs = false, int threads = 0);
+
+    /* Number of minimal pairs per contrast, most frequent first */
+    const std::vector<Contrast>& get_contrasts() const { return contrasts; }
+    const std::vector<Pair>& get_pairs() const { return pairs; }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+#include "wordlist.h"
+
+enum class AffixType {prefix, suffix};
+
+struct Affix {
+    std::string name;
+    AffixType type;
+    std::vector<unsigned int> form;
+};
+
+/*
+ * Affixes of a language and the paradigm slots built from them.
+ *
+ * A slot is a list of affixes. Prefixes are written before the stem and
+ * suffixes after it, both in the order the slot lists them, with a
+ * MORPHEME_BOUNDARY between every two morphemes:
+ *
+ *   prefix # stem # suffix # suffix
+ *
+ * An empty slot is the bare stem.
+ */
+class Morphology {
+private:
+    std::vector<Affix> affixes;
+    std::unordered_map<std::string, int> affix_indices;     // Name -> index in affixes
+    std::vector<std::string> slot_names;
+    std::vector<std::vector<int>> slots;                    // Affix indices of each slot
+public:
+    Morphology() {}
+
+    /*
+     * Load langs/<name>/morphology/affixes.csv (name,type,form) and
+     * langs/<name>/morphology/paradigm.csv (slot,affixes). Forms are
+     * tokenized with the inventory and affixes are separated by spaces.
+     *
+     * Returns true if either file couldnt be opened
+     * Returns false otherwise
+     */
+    bool load(std::string name, const Inventory&);
+
+    /*
+     * Returns the index of the new affix
+     * Returns -1 if an affix with the same name exists
+     */
+    int add_affix(std::string name, AffixType, const std::vector<unsigned int>& form);
+
+    /*
+     * Add a slot made of the named affixes
+     *
+     * Returns true if an affix does not exist
+     * Returns false otherwise
+     */
+    bool add_slot(std::string name, const std::vector<std::string>& affix_names);
+
+    /*
+     * Write the form of a stem in a slot, with boundaries, to output
+     *
+     * Returns the length of the form
+     */
+    int build(const unsigned int* stem, int len, int slot, unsigned int* output) const;
+
+    /* Length of the form of a stem of len phonemes in a slot, with boundaries */
+    int get_length(int len, int slot) const;
+
+    int get_slot_count() const { return slots.size(); }
+    int get_affix_count(int slot) const { return slots[slot].size(); }
+    const std::string& get_slot_name(int slot) const { return slot_names[slot]; }
+    const std::vector<Affix>& get_affixes() const { return affixes; }
+};
+
+/*
+ * Every form of every stem in a lexicon after a list of rules.
+ *
+ * Forms are stored without boundaries as dense inventory indices in one
+ * flat buffer, stem by stem and slot by slot within a stem. Rules never
+ * change the length of a form, so every offset is known before any rule
+ * runs and threads write their stems straight into the buffer.
+ */
+class Paradigms {
+private:
+    int slot_count = 0;
+    std::vector<uint16_t> segments;         // Dense inventory indices
+    std::vector<uint32_t> offsets;          // Form i spans [offsets[i], offsets[i + 1])
+    std::vector<unsigned int> ids;          // Inventory index -> ID
+public:
+    Paradigms() {}
+
+    /*
+     * Build every slot of every stem and apply the rules in order
+     *
+     * Returns true if a stem has a phoneme missing from the inventory or a
+     * morpheme boundary in it, or the paradigms are too large to index
+     * Returns false otherwise
+     */
+    bool generate(const Morphology&, const Inventory&, const std::vector<Rule>&,
+                  const WordList& stems, int threads = 0);
+
+    std::vector<unsigned int> get_form(unsigned int stem, int slot) const;
+    int length(unsigned int stem, int slot) const;
+
+    unsigned int get_stem_count() const { return slot_count > 0 ? (offsets.size() - 1) / slot_count : 0; }
+    int get_slot_count() const { return slot_count; }
+
+    /* Bytes used by the forms and their offsets */
+    size_t get_memory() const {
+        return segments.capacity() * sizeof(uint16_t) + offsets.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+#include "corpus.h"
+#include "wordlist.h"
+
+/*
+ * Trigram phonotactic probability model over dense phoneme indices.
+ *
+ * Unigram and bigram counts are flat arrays indexed by dense index, with one
+ * extra index for the word boundary. Trigrams are sparse and kept in an
+ * open addressing hash table. Probabilities use interpolated absolute
+ * discounting, backing off from trigrams to bigrams to add-one unigrams.
+ */
+class NgramModel {
+private:
+    std::vector<unsigned int> ids;      // Sorted phoneme IDs, the dense index is the position
+    int vocab;                          // ids.size() + 1, the last index is the word boundary
+    float discount;
+
+    // Counts
+    std::vector<uint32_t> unigrams;             // vocab
+    std::vector<uint32_t> bigrams;              // vocab * vocab
+    std::vector<uint32_t> contexts;             // Times each bigram was followed by a phoneme
+    std::vector<uint64_t> trigram_keys;         // Open addressing, EMPTY_KEY marks a free slot
+    std::vector<uint32_t> trigram_counts;
+    size_t trigram_size;
+    unsigned long tokens;
+
+    // Derived by finalize()
+    std::vector<float> bigram_probs;            // P(c | b), vocab * vocab
+    std::vector<float> inv_contexts;            // 1 / contexts
+    std::vector<float> backoff;                 // Weight given to P(c | b) after context (a, b)
+
+    void reset_counts();
+    int index_of(unsigned int id) const;
+    size_t find_slot(uint64_t key) const;
+    void add_trigram(uint64_t key, uint32_t count);
+    uint32_t get_trigram(uint64_t key) const;
+
+    void count_word(const unsigned int*, int);
+
+    /* Count a buffer of words each followed by WORD_BOUNDARY */
+    void count(const unsigned int* begin, const unsigned int* end);
+    void merge(const NgramModel&);
+    void finalize();
+
+    float log_prob(int a, int b, int c) const;
+public:
+    NgramModel(const Inventory&, float discount = 0.75f);
+    NgramModel() : NgramModel(Inventory()) {}
+
+    /*
+     * Train on every word of a corpus (0 threads uses every core).
+     * Counts are added to any previous training.
+     */
+    void train(CorpusReader&, size_t chunk_size = 1 << 20, int threads = 0);
+    void train(const WordList&);
+
+    /*
+     * Natural log probability of a word, including its end
+     * Phonemes unknown to the model score as the word boundary
+     */
+    double score(const unsigned int* word, int len) const;
+    double score(const std::vector<unsigned int>& word) const { return score(word.data(), word.size()); }
+
+    /* score divided by the number of predictions (len + 1) */
+    double average(const unsigned int* word, int len) const { return score(word, len) / (len + 1); }
+
+    /* Returns true if the average log probability of the word is at least min_average */
+    bool accepts(const std::vector<unsigned int>& word, double min_average) const {
+        return average(word.data(), word.size()) >= min_average;
+    }
+
+    /* Average log probability of every word in a list (0 threads uses every core) */
+    void score_all(const WordList&, std::vector<float>& scores, int threads = 0) const;
+
+    /*
+     * Save the counts in a binary file, derived tables are rebuilt on load
+     *
+     * Returns true if the file couldnt be opened or is not a model
+     * Returns false otherwise
+     */
+    bool save(std::string path) const;
+
+    /*
+     * Load counts saved by save(), replacing the model
+     *
+     * Returns true if the file couldnt be read or is not a model, leaving
+     * the model as it was
+     * Returns false otherwise
+     */
+    bool load(std::string path);
+
+    size_t get_trigram_count() const { return trigram_size; }
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef OPTIMALITY_H
+#define OPTIMALITY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+#include "rule.h"
+#include "wordlist.h"
+
+#define OT_MAX_CONSTRAINTS 16
+
+/*
+ * Requires the edge of the word on one side of a markedness constraint.
+ * Its type nibble (0xe) is not used by any phoneme.
+ */
+#define WORD_EDGE 0xe
+
+/*
+ * markedness:   one violation for every output segment in cur_class whose
+ *               neighbours are in prev_class and next_class
+ * faithfulness: one violation for every input segment in cur_class whose
+ *               output differs in the nibbles of features (every nibble if 0)
+ *
+ * Classes are natural classes as in in_class(), 0 is not checked. A
+ * neighbour class of WORD_EDGE or MORPHEME_BOUNDARY requires the edge of the
+ * word or a boundary on that side. Other neighbours skip boundaries.
+ */
+enum class ConstraintType {markedness, faithfulness};
+
+struct Constraint {
+    std::string name;
+    ConstraintType type;
+    unsigned int cur_class;
+    unsigned int prev_class;
+    unsigned int next_class;
+    unsigned int features;
+};
+
+/* Violations of every constraint of a grammar, in ranking order */
+struct Violations {
+    unsigned short counts[OT_MAX_CONSTRAINTS] = {0};
+
+    Violations& operator+=(const Violations& other) {
+        for (int k = 0; k < OT_MAX_CONSTRAINTS; k++) {
+            counts[k] += other.counts[k];
+        }
+
+        return *this;
+    }
+
+    /* Strict domination: the first constraint that differs decides */
+    bool operator<(const Violations& other) const {
+        for (int k = 0; k < OT_MAX_CONSTRAINTS; k++) {
+            if (counts[k] != other.counts[k]) {
+                return counts[k] < other.counts[k];
+            }
+        }
+
+        return false;
+    }
+
+    bool operator==(const Violations& other) const {
+        for (int k = 0; k < OT_MAX_CONSTRAINTS; k++) {
+            if (counts[k] != other.counts[k]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/*
+ * A ranking of constraints, compiled to one weighted finite-state machine.
+ *
+ * Candidates keep the length of the input and its boundaries, and change
+ * every segment to any phoneme of the inventory of the same type, so a word
+ * of n segments has up to size^n candidates. Instead of listing them, the
+ * markedness constraints are compiled into a machine over output phonemes
+ * whose states remember just enough of the previous segment. Transitions
+ * are weighted by vectors of violations added per constraint and compared
+ * by strict domination. Faithfulness only depends on each pair of input and
+ * output segment, so it is a table added along the way.
+ *
+ * The winner is the shortest path through the positions of the input and
+ * the states of the machine, found in O(n * states * size) time. Ties go
+ * to the path found first, which keeps segments faithful where it can.
+ */
+class Grammar {
+private:
+    Inventory inventory;
+    std::vector<Constraint> constraints;
+
+    // Candidates of each input phoneme, faithful first
+    std::vector<std::vector<uint16_t>> candidates;
+    std::vector<Violations> faithfulness;   // faithfulness[input * size + output]
+
+    // Machine over size phonemes and the boundary (symbol size), state 0 is the start
+    unsigned int states = 0;
+    std::vector<uint32_t> targets;          // targets[state * (size + 1) + symbol]
+    std::vector<Violations> weights;        // Violations of each transition
+    std::vector<Violations> finals;         // Violations of ending in each state
+
+    void compile();
+public:
+    Grammar(const Inventory&);
+
+    /*
+     * Load a ranking from a csv with the header
+     * name,type,class,prev,next,features where type is markedness or
+     * faithfulness and every other value is in hex. Constraints are ranked
+     * from the first line down.
+     *
+     * Returns true if the file couldnt be opened
+     * Returns false otherwise
+     */
+    bool load(std::string path);
+
+    /*
+     * Rank a constraint below every constraint added before
+     *
+     * Returns true if the grammar already has OT_MAX_CONSTRAINTS constraints
+     * Returns false otherwise
+     */
+    bool add(const Constraint&);
+
+    /*
+     * Write the optimal candidate of a word to output
+     *
+     * Returns true if a phoneme is not in the inventory, output is then a copy of the word
+     * Returns false otherwise
+     */
+    bool evaluate(const unsigned int* word, int len, unsigned int* output, Violations* violations = nullptr) const;
+
+    /*
+     * Evaluate every word of a list, split between threads. Outputs are in
+     * the order of the inputs.
+     *
+     * Returns true if any word has a phoneme not in the inventory
+     * Returns false otherwise
+     */
+    bool evaluate(const WordList& inputs, WordList& outputs, int threads = 0) const;
+
+    /*
+     * Violations of one candidate of a word of the same length
+     *
+     * Returns true if a phoneme is not in the inventory or the candidate
+     * does not keep the boundaries of the input
+     * Returns false otherwise
+     */
+    bool assess(const unsigned int* input, const unsigned int* output, int len, Violations& violations) const;
+
+    unsigned int get_state_count() const { return states; }
+    int get_constraint_count() const { return constraints.size(); }
+    const Constraint& get_constraint(int k) const { return constraints[k]; }
+};
+
+#endif
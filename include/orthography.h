@@ -0,0 +1,118 @@
+#ifndef ORTHOGRAPHY_H
+#define ORTHOGRAPHY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+#include "wordlist.h"
+
+#define ORTHOGRAPHY_CHUNK (1 << 20)    // Least bytes of text or words per thread
+
+/*
+ * Maps between phoneme IDs and a language's spelling, in both directions.
+ *
+ * Every spelling maps to a sequence of phonemes, and can be limited to a
+ * context: strings the text has to end with before it (before) or start
+ * with after it (after). A context of # is the edge of the word.
+ *
+ * Reading walks a byte trie from each position and takes the longest
+ * spelling whose context holds. At the same length, spellings with a
+ * context are tried before those without, otherwise the first listed wins.
+ *
+ * Writing copies a precomputed string per phoneme: the first spelling of
+ * that phoneme alone without a context, or its symbol if it has none.
+ */
+class Orthography {
+private:
+    struct Entry {
+        std::vector<std::string> before;
+        std::vector<std::string> after;
+        uint32_t phonemes;                  // Offset in phonemes
+        uint32_t length;
+        bool has_context;
+    };
+
+    std::vector<unsigned int> ids;          // Sorted inventory IDs
+
+    // Open addressing table from ID to inventory index, at most a quarter full
+    std::vector<unsigned int> slot_ids;
+    std::vector<int> slot_indices;          // -1 for an empty slot
+    unsigned int slot_shift;
+
+    /* Returns the inventory index of an ID, or -1 if it is not in the inventory */
+    int index_of(unsigned int id) const {
+        for (unsigned int slot = (id * 0x9e3779b1u) >> slot_shift; ; slot = (slot + 1) & (slot_ids.size() - 1)) {
+            if (slot_indices[slot] < 0 || slot_ids[slot] == id) {
+                return slot_indices[slot];
+            }
+        }
+    }
+
+    // Writing: spelling of inventory index i spans [offsets[i], offsets[i + 1])
+    std::string spellings;
+    std::vector<uint32_t> spelling_offsets;
+
+    // Reading: trie over the bytes of every spelling, node 0 is the root
+    std::vector<int32_t> transitions;       // node * 256 + byte -> node, 0 if there is none
+    std::vector<std::vector<int>> accepts;  // Entries ending at each node, in priority order
+    std::vector<int> fixed;                 // Entry a node always gives, -1 if it has none or depends on context
+    std::vector<Entry> entries;
+    std::vector<unsigned int> phonemes;
+    size_t max_length = 0;
+
+    int add_node();
+    void write_words(const WordList&, unsigned int begin, unsigned int end, std::string& output, char separator) const;
+    size_t read_words(const char* text, const char* end, WordList& words) const;
+    bool holds(const Entry&, const char* word, const char* word_end,
+               const char* begin, const char* end) const;
+public:
+    Orthography(const Inventory&);
+
+    /*
+     * Load langs/<name>/orthography.csv with the header
+     * spelling,phonemes,before,after. Phonemes are tokenized with the
+     * inventory, contexts are lists separated by spaces.
+     *
+     * Returns true if the file couldnt be opened
+     * Returns false otherwise
+     */
+    bool load(std::string name, const Inventory&);
+
+    /*
+     * Add a spelling of a sequence of phonemes
+     *
+     * Returns true if the spelling or phonemes are empty, or a phoneme is
+     * not in the inventory
+     * Returns false otherwise
+     */
+    bool add(const std::string& spelling, const std::vector<unsigned int>& phonemes,
+             const std::vector<std::string>& before = {}, const std::vector<std::string>& after = {});
+
+    /* Append the spelling of a word to output */
+    void write(const unsigned int* word, int len, std::string& output) const;
+
+    /*
+     * Append the spelling of every word to output, each followed by the
+     * separator. Large lists are split between threads.
+     */
+    void write(const WordList&, std::string& output, char separator = '\n', int threads = 0) const;
+
+    /*
+     * Read every word of a text, words are separated by whitespace.
+     * Characters that start no spelling are skipped, and a word made only
+     * of such characters is read as an empty word, so word i is always the
+     * ith word of the text. Large texts are split between threads at
+     * whitespace.
+     *
+     * Returns the number of bytes skipped
+     */
+    size_t read(const char* text, size_t len, WordList& words, int threads = 0) const;
+
+    size_t read(const std::string& text, WordList& words, int threads = 0) const {
+        return read(text.data(), text.size(), words, threads);
+    }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/* Number of worker threads to use when 0 is requested */
+inline int default_threads() {
+    int threads = std::thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+}
+
+/*
+ * Splits [0, n) into contiguous batches, one per thread, and calls
+ * fn(begin, end, batch) for each. Batches are numbered in order, so results
+ * stored per batch can be concatenated in order.
+ *
+ * Returns the number of batches used
+ */
+template<typename Function>
+int parallel_batches(size_t n, int threads, Function fn) {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    int batches = std::max<size_t>(1, std::min<size_t>(threads, n));
+
+    if (batches == 1) {
+        fn(static_cast<size_t>(0), n, 0);
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    size_t step = n / batches, extra = n % batches, begin = 0;
+
+    for (int b = 0; b < batches; b++) {
+        size_t end = begin + step + (static_cast<size_t>(b) < extra ? 1 : 0);
+        workers.push_back(std::thread(fn, begin, end, b));
+        begin = end;
+    }
+
+    for (auto& worker: workers) {
+        worker.join();
+    }
+
+    return batches;
+}
+
+#endif
@@ -5,7 +5,8 @@
 
 enum class Type {
     consonant = 1,
-    vowel
+    vowel,
+    suprasegmental
 };
 
 enum class Voicing {
@@ -33,4 +34,10 @@ public:
     std::string get_desc() const { return desc; }
 };
 
+/*
+ * Returns true if the phoneme is in the natural class.
+ * Every non-zero digit of the class must equal the same digit of the ID.
+ */
+bool in_class(unsigned int id, unsigned int phon_class);
+
 #endif
@@ -0,0 +1,127 @@
+#ifndef PHONOTACTICS_H
+#define PHONOTACTICS_H
+
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/* Parts of a syllable */
+enum class Constituent {
+    onset = 0,
+    nucleus,
+    coda
+};
+
+/* Lengths of the constituents of one syllable, in order */
+struct Syllable {
+    int onset;
+    int nucleus;
+    int coda;
+};
+
+/* Represents the sequences allowed in each part of a syllable in a language */
+class Phonotactics {
+private:
+    std::string name;
+
+    // Allowed sequences stored as the raw bytes of their IDs
+    std::unordered_set<std::string> sequences[3];
+    std::vector<std::vector<unsigned int>> lists[3];
+    int max_length[3];
+
+    std::vector<std::string> types;     // Syllable shapes such as CVC
+    std::vector<std::pair<int, int>> num;
+
+    static std::string to_key(const unsigned int*, int);
+public:
+    Phonotactics(std::string name) : name(name), max_length{0, 0, 0} {}
+
+    /*
+     * Load phonotactics.json for the corresponding language
+     *
+     * Returns true if the file couldnt be opened or parsed
+     * Returns false otherwise
+     */
+    bool load();
+
+    /* Returns true if the sequence is allowed in the given part of a syllable */
+    bool allows(Constituent, const unsigned int*, int) const;
+
+    /*
+     * Split a word into syllables
+     *
+     * Each nucleus is the longest allowed run of vowels. Consonants between
+     * two nuclei go to the longest allowed onset, the rest to the coda.
+     * If no onsets are listed every onset gets a single consonant.
+     */
+    void syllabify(const unsigned int* word, int len, std::vector<Syllable>&) const;
+
+    /*
+     * Returns true if the word is well-formed: every constituent of its
+     * syllables is allowed, every syllable has a listed type (such as CVC) and
+     * the number of syllables is within a listed range.
+     * Only the syllabification chosen by syllabify() is checked.
+     */
+    bool validate(const unsigned int* word, int len) const;
+    bool validate(const std::vector<unsigned int>& word) const { return validate(word.data(), word.size()); }
+
+    /*
+     * Returns false if no word validate() accepts starts with the prefix.
+     * Every syllable the prefix completes is checked as validate() would,
+     * the vowels and consonants it ends with only by their length and the
+     * syllables by their number, so a prefix it accepts may still have no
+     * valid word.
+     */
+    bool allows_prefix(const unsigned int* prefix, int len) const;
+
+    const std::vector<std::vector<unsigned int>>& get_sequences(Constituent part) const {
+        return lists[static_cast<int>(part)];
+    }
+    const std::vector<std::string>& get_types() const { return types; }
+    const std::vector<std::pair<int, int>>& get_num() const { return num; }
+};
+
+/*
+ * Add sequences to a part (onset, nucleus or coda) of a language's phonotactics.json
+ *
+ * Returns true if any new sequences were added
+ * Returns false otherwise
+ */
+bool insert_sequences(std::string part, std::string lang, std::vector<std::vector<unsigned int>> sequences);
+
+/*
+ * Enumerates every sequence of phonemes where the nth phoneme is in the nth
+ * natural class, one at a time. The sequences are counted like an odometer,
+ * the last phoneme changing fastest, so memory does not grow with their number.
+ */
+class Sequences {
+private:
+    std::vector<std::vector<unsigned int>> phonemes;    // Phonemes in each class
+    std::vector<size_t> digits;
+    std::vector<unsigned int> word;
+    bool started = false;
+    bool done = false;
+public:
+    Sequences(const std::set<unsigned int>& ids, const std::vector<unsigned int>& classes);
+
+    /*
+     * Move to the next sequence
+     *
+     * Returns false once every sequence has been visited
+     */
+    bool next();
+
+    const std::vector<unsigned int>& get_word() const { return word; }
+
+    /* Number of sequences in total */
+    unsigned long long get_count() const;
+};
+
+/*
+ * Every sequence of phonemes where the nth phoneme is in the nth natural class
+ */
+std::vector<std::vector<unsigned int>> create_sequences(const std::set<unsigned int>& ids,
+                                                        const std::vector<unsigned int>& classes);
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "phoneme.h"
+#include "inventory.h"
+#include "phonotactics.h"
+#include "interaction.h"
+
+#define REGISTRY_READER_SLOTS 32    // Reader counters, threads share them round robin
+
+/*
+ * A loaded language.
+ *
+ * Phoneme records are shared with every other language that has a phoneme
+ * with the same ID and symbol, and the inventory is shared with every
+ * language that has exactly the same phonemes. Its rules.csv is compiled
+ * into a Cascade when the language is loaded.
+ */
+class Language {
+private:
+    std::string name;
+    std::vector<std::shared_ptr<const Phoneme>> phonemes;   // Sorted by ID
+    std::shared_ptr<const Inventory> inventory;
+    std::shared_ptr<const Phonotactics> phonotactics;
+    std::shared_ptr<const Cascade> cascade;
+
+    friend class Registry;
+public:
+    Language(std::string name) : name(name) {}
+
+    /* Returns the phoneme with the given ID, or nullptr if there is none */
+    const Phoneme* find(unsigned int id) const;
+
+    const std::string& get_name() const { return name; }
+    const std::vector<std::shared_ptr<const Phoneme>>& get_phonemes() const { return phonemes; }
+    const Inventory& get_inventory() const { return *inventory; }
+
+    /* Returns nullptr if the language has no phonotactics */
+    const Phonotactics* get_phonotactics() const { return phonotactics.get(); }
+
+    /* Rules of the language, without rules every word is derived unchanged */
+    const Cascade& get_cascade() const { return *cascade; }
+};
+
+/*
+ * Languages loaded from langs/<name>, looked up by name.
+ *
+ * All methods can be called from several threads. A language returned by
+ * get() stays valid after it is unloaded or reloaded, until the last
+ * reference to it is released.
+ *
+ * Readers never take a lock. The loaded languages are an immutable table
+ * published through an atomic pointer, read-copy-update style: a reader
+ * counts itself in the current epoch before reading the pointer, and a
+ * writer publishes a new table, moves to the next epoch and frees the old
+ * table once every reader of the previous epoch has left. Languages are read
+ * from disk before the table is touched, so readers keep seeing the old
+ * version until the new one is complete, and if it fails to load they keep
+ * it. Writers publish one at a time.
+ */
+class Registry {
+private:
+    typedef std::map<std::string, std::shared_ptr<const Language>> Table;
+
+    // Readers inside each epoch, by its parity, one cache line per slot
+    struct alignas(64) ReaderSlot {
+        std::atomic<long> readers[2];
+    };
+
+    /* Counts a reader in its epoch while it is in scope */
+    class ReadSection {
+    private:
+        std::atomic<long>* counter;
+    public:
+        const Table* table;
+
+        ReadSection(const Registry&);
+        ~ReadSection() { counter->fetch_sub(1, std::memory_order_release); }
+    };
+
+    mutable std::mutex mutex;               // Guards the pools
+    std::mutex write_mutex;                 // Held while a table is replaced
+    std::atomic<const Table*> table;
+    std::atomic<unsigned long> epoch;
+    std::atomic<unsigned long> version;     // Tables published so far
+    mutable ReaderSlot slots[REGISTRY_READER_SLOTS];
+
+    // Pools of shared records, keyed by ID and symbol. Entries expire once no
+    // language uses them.
+    std::unordered_map<std::string, std::weak_ptr<const Phoneme>> records;
+    std::unordered_map<std::string, std::weak_ptr<const Inventory>> inventories;
+
+    std::shared_ptr<const Language> read_language(const std::string& name);
+    std::shared_ptr<const Phoneme> intern(const std::string& key, const Phoneme&);
+    void purge();
+
+    /* Replace the table, waiting for its readers before freeing the old one. Needs write_mutex. */
+    void publish(const Table*);
+public:
+    Registry();
+    ~Registry();
+
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    /*
+     * Load a language, replacing it if it is already loaded
+     *
+     * Returns true if its phonemes couldnt be loaded
+     * Returns false otherwise
+     */
+    bool load(std::string name);
+
+    /*
+     * Read a loaded language again, such as after its files changed. It is
+     * only replaced if it is still loaded once it has been read, so a
+     * language unloaded in the meantime stays unloaded.
+     *
+     * Returns true if it is not loaded or its phonemes couldnt be loaded
+     * Returns false otherwise
+     */
+    bool reload(std::string name);
+
+    /*
+     * Load several languages in parallel
+     *
+     * Returns the number of languages that couldnt be loaded
+     */
+    int load(const std::vector<std::string>& names, int threads = 0);
+
+    /*
+     * Unload a language
+     *
+     * Returns true if the language is not loaded
+     * Returns false otherwise
+     */
+    bool unload(const std::string& name);
+
+    /* Returns nullptr if the language is not loaded */
+    std::shared_ptr<const Language> get(const std::string& name) const;
+
+    /*
+     * Call fn with the language, or nullptr if it is not loaded, without
+     * taking a reference to it. The language is only valid during the call
+     * and writers wait for the call to return before freeing it, so fn
+     * should be short.
+     */
+    template<typename Function>
+    void read(const std::string& name, Function fn) const {
+        ReadSection section(*this);
+        auto it = section.table->find(name);
+
+        fn(it == section.table->end() ? nullptr : it->second.get());
+    }
+
+    std::vector<std::string> get_names() const;
+
+    /* Number of times the loaded languages changed, to notice reloads */
+    unsigned long get_version() const { return version.load(std::memory_order_acquire); }
+
+    /* Number of distinct phoneme records and inventories in use */
+    size_t get_record_count() const;
+    size_t get_inventory_count() const;
+};
+
+#endif
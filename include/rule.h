@@ -0,0 +1,178 @@
+#ifndef RULE_H
+#define RULE_H
+
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+#include "tiers.h"
+
+/*
+ * Marks the boundary between two morphemes inside a word. Its type nibble
+ * (0xf) is not used by any phoneme.
+ */
+#define MORPHEME_BOUNDARY 0xf
+
+/*
+ * Represents an assimilation rule
+ *
+ * cur_class -> res_class / prev_class _ next_class
+ *
+ * Classes are bitmasks over phoneme IDs, a phoneme is in a class if
+ * (id & class) == class. A class of 0x0 means the environment is not checked
+ * on that side.
+ *
+ * Morpheme boundaries never change and are skipped when looking for the
+ * neighbours of a phoneme, so rules apply across them. A prev_class or
+ * next_class of MORPHEME_BOUNDARY instead requires a boundary on that side.
+ *
+ * A rule can also require a value on a suprasegmental tier, such as only
+ * applying to segments with primary stress.
+ *
+ * An optional rule applies with a probability where it matches. apply()
+ * treats every rule as obligatory; only a Lattice keeps both outputs.
+ *
+ * A projected rule applies along a tier of the segments in a projection
+ * class, such as only vowels, for harmony and long-distance agreement.
+ * prev_class and next_class are then the nearest segments on the tier,
+ * however far away. Segments in the transparent class are left off the
+ * tier, segments in the opaque class stay on it but never change, and
+ * boundaries are never on it. A spreading rule reads the output of the
+ * segment before it, so a change carries on along the tier, while an
+ * agreeing rule only reads the input. Spreading runs right to left when
+ * only next_class is given.
+ */
+class Rule {
+private:
+    unsigned int cur_class;
+    unsigned int res_class;
+    unsigned int prev_class;
+    unsigned int next_class;
+    int tier = 0;                   // Tier of the condition, 0 if there is none
+    unsigned int tier_value = 0;
+    double probability = 1.0;       // Chance of applying where the rule matches
+    unsigned int projection = 0;    // Class of the tier the rule applies on, 0 for a local rule
+    unsigned int transparent = 0;   // Left off the tier, 0 for none
+    unsigned int opaque = 0;        // On the tier but never changed, 0 for none
+    bool spreading = false;
+
+    int apply_tiers(const Inventory&, const unsigned int* word, unsigned int* output, int len,
+                    const Tiers*, size_t offset, std::vector<unsigned int>* blocked) const;
+    int apply_projected(const Inventory&, const unsigned int* word, unsigned int* output, int len,
+                        const Tiers*, size_t offset, std::vector<unsigned int>* blocked) const;
+public:
+    Rule(unsigned int cur_class, unsigned int res_class,
+         unsigned int prev_class, unsigned int next_class) {
+
+        this->cur_class = cur_class;
+        this->res_class = res_class;
+        this->prev_class = prev_class;
+        this->next_class = next_class;
+    }
+
+    Rule() : Rule(0x0, 0x0, 0x0, 0x0) {}
+
+    bool operator==(const Rule& rule) const {
+        return cur_class == rule.cur_class && res_class == rule.res_class
+            && prev_class == rule.prev_class && next_class == rule.next_class
+            && tier == rule.tier && tier_value == rule.tier_value
+            && probability == rule.probability && projection == rule.projection
+            && transparent == rule.transparent && opaque == rule.opaque
+            && spreading == rule.spreading;
+    }
+
+    /*
+     * Only apply to segments with the given value on a tier.
+     * A value of 0 means the segment is unmarked on that tier.
+     */
+    void set_condition(Tier tier, unsigned int value) {
+        this->tier = static_cast<int>(tier);
+        tier_value = value;
+    }
+
+    bool has_condition() const { return tier != 0; }
+
+    /* Make the rule optional, applying with the given probability (0 to 1) */
+    void set_probability(double probability) { this->probability = probability; }
+
+    bool is_optional() const { return probability < 1.0; }
+
+    /*
+     * Apply along the tier of segments in projection instead of to adjacent
+     * segments, spreading or only agreeing
+     */
+    void set_projection(unsigned int projection, unsigned int transparent, unsigned int opaque, bool spreading) {
+        this->projection = projection;
+        this->transparent = transparent;
+        this->opaque = opaque;
+        this->spreading = spreading;
+    }
+
+    bool is_projected() const { return projection != 0; }
+    bool is_spreading() const { return spreading; }
+
+    /* Returns true if a phoneme is on the tier of a projected rule */
+    bool is_visible(unsigned int id) const {
+        return id != MORPHEME_BOUNDARY && (id & projection) == projection
+            && (transparent == 0 || (id & transparent) != transparent);
+    }
+
+    /* Returns true if a phoneme on the tier is in cur_class and not opaque */
+    bool is_target(unsigned int id) const {
+        return (id & cur_class) == cur_class && (opaque == 0 || (id & opaque) != opaque);
+    }
+
+    /*
+     * Returns true if the phoneme at position i is in cur_class and
+     * its neighbours satisfy the environment. Only for local rules.
+     */
+    bool matches(const unsigned int* word, int len, int i) const;
+
+    /* The ID a phoneme in cur_class is changed to */
+    unsigned int get_result(unsigned int id) const { return id + (res_class - cur_class); }
+
+    /*
+     * Applies the rule to a word of len phonemes, writing the result to output.
+     * A result is only used if it exists in the inventory. Results that do not
+     * exist are appended to blocked (if given).
+     *
+     * Returns the number of phonemes changed
+     */
+    int apply(const Inventory&, const unsigned int* word, unsigned int* output, int len,
+              std::vector<unsigned int>* blocked = nullptr) const;
+
+    /*
+     * Applies the rule to a word starting at offset in the segments the tiers
+     * belong to. Without tiers every segment is unmarked.
+     */
+    int apply(const Inventory&, const unsigned int* word, unsigned int* output, int len,
+              const Tiers&, size_t offset, std::vector<unsigned int>* blocked = nullptr) const;
+
+    std::vector<unsigned int> apply(const Inventory&, const std::vector<unsigned int>&) const;
+
+    unsigned int get_cur_class() const { return cur_class; }
+    unsigned int get_res_class() const { return res_class; }
+    unsigned int get_prev_class() const { return prev_class; }
+    unsigned int get_next_class() const { return next_class; }
+    Tier get_tier() const { return static_cast<Tier>(tier); }
+    unsigned int get_tier_value() const { return tier_value; }
+    double get_probability() const { return probability; }
+    unsigned int get_projection() const { return projection; }
+    unsigned int get_transparent() const { return transparent; }
+    unsigned int get_opaque() const { return opaque; }
+};
+
+/*
+ * Load an ordered list of rules from a csv with the header cur,res,prev,next
+ * where every value is a class in hex. Two optional columns tier,value give
+ * a condition such as stress,1, and a seventh column the probability of an
+ * optional rule. Four more columns projection,transparent,opaque,mode make
+ * a projected rule, with classes in hex and a mode of spread (the default)
+ * or agree.
+ *
+ * Returns true if the file couldnt be opened
+ * Returns false otherwise
+ */
+bool load_rules(std::string path, std::vector<Rule>& rules);
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+
+#define SERVER_MAX_LINE (1 << 20)   // Longest request in bytes
+#define SERVER_MAX_QUEUE 4096       // Most requests waiting for a worker
+
+/*
+ * Answers newline-delimited JSON requests against resident languages.
+ *
+ * Every request is an object with an "op", a "lang" and an optional "id"
+ * that is copied into the response:
+ *  tokenize:  {"text": "pata"}             -> {"ids": [...]}
+ *  derive:    {"text": "pata"}             -> {"surface": "...", "ids": [...]}
+ *  validate:  {"text": "pata"}             -> {"valid": true}
+ *  syllabify: {"text": "pata"}             -> {"syllables": ["pa", "ta"]}
+ *  generate:  {"count": 10, "seed": 1}     -> {"words": [...], "failed": 0}
+ * Text may be given as "ids" instead. Failed requests get {"error": "..."},
+ * and so do lines longer than SERVER_MAX_LINE. "failed" counts the words
+ * generate couldnt build, which are left out. Requests are answered
+ * concurrently, so responses can arrive out of order. Once SERVER_MAX_QUEUE
+ * requests are waiting, reading stops until the workers catch up.
+ *
+ * Languages not loaded yet are loaded into the registry the first time they
+ * are used, together with their compiled rules, up to a limit. Names can
+ * only have letters, digits, '_' and '-', so they stay inside langs/. Every
+ * request uses the version of its language that was published when it
+ * started, see Watcher for reloading languages as their files change.
+ */
+class Server {
+private:
+    /* Where the responses to a stream of requests are written */
+    struct Connection {
+        int fd;
+        bool owned;         // Close the descriptor when the last request is answered
+        std::mutex mutex;
+
+        Connection(int fd, bool owned) : fd(fd), owned(owned) {}
+        ~Connection();
+
+        void write(const std::string&);
+    };
+
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        std::string request;
+    };
+
+    Registry& registry;
+    int threads;
+    int batch_size;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::condition_variable queue_space;
+    std::deque<Job> queue;
+    bool closed = false;
+
+    std::mutex load_mutex;          // Held while a language is loaded on first use
+    int max_loads;
+    int loads = 0;                  // Languages tried on first use so far
+
+    std::atomic<unsigned long> handled;
+
+    std::shared_ptr<const Language> find_language(const std::string& name);
+
+    void push(const std::shared_ptr<Connection>&, std::string);
+    void close();
+    void work();
+    void read_stream(int fd, const std::shared_ptr<Connection>&);
+public:
+    /*
+     * threads: number of workers (0 for one per core)
+     * batch_size: most queued requests a worker takes at once
+     * max_loads: most languages tried on first use, failed ones included
+     * (0 to only serve languages loaded before)
+     */
+    Server(Registry&, int threads = 0, int batch_size = 32, int max_loads = 16);
+
+    /* Answer one request line, without a trailing newline */
+    std::string handle(const std::string& request);
+
+    /* Serve requests from stdin to stdout until stdin is closed */
+    void serve_stdin();
+
+    /*
+     * Serve connections on a Unix domain socket until the process is stopped
+     *
+     * Returns true if the socket couldnt be created
+     */
+    bool serve_socket(const std::string& path);
+
+    unsigned long get_handled() const { return handled; }
+};
+
+#endif
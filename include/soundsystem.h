@@ -6,6 +6,7 @@
 
 #include "consonant.h"
 #include "vowel.h"
+#include "suprasegmental.h"
 
 #define MAX_PHONEME_LENGTH 10
 
@@ -15,6 +16,7 @@ private:
     std::string name;
     std::map<unsigned int, Consonant> consonants;
     std::map<unsigned int, Vowel> vowels;
+    std::map<unsigned int, Suprasegmental> suprasegmentals;
     std::map<std::string, unsigned int> ids;    // NOTE: Temporary, meant for testing
 
     /*
@@ -29,22 +31,9 @@ private:
      * Type: Represents the contents of the file passed in (consonant, vowel, or suprasegmental)
      *  1: Consonant
      *  2: Vowel
+     *  3: Suprasegmental
      */
     void read_file(std::ifstream& file, int type);
-
-    /*
-     * Adds consonant to the soundSystem
-     * Returns true if the consonant could not be added
-     * Returns false if the consonant was successfully added
-     */
-    bool insert_consonant(std::string, unsigned int);
-
-    /*
-     * Adds vowel to the soundSystem
-     * Returns true if the vowel could not be added
-     * Returns false if vowel was successfully added
-     */
-    bool insert_vowel(std::string, unsigned int);
 public:
     SoundSystem(std::string name) {
         this->name = name;
@@ -59,16 +48,39 @@ public:
     bool save();
 
     /*
-     * Load phonemes from a csv from the corresponding language
+     * Load phonemes from a csv from the corresponding language.
+     * suprasegmentals.csv is optional.
      *
      * Returns true if file couldnt be opened
      * Returns false otherwise
      */
     bool load();
 
-    std::map<unsigned int, Consonant> get_consonants() const { return consonants; }
-    std::map<unsigned int, Vowel> get_vowels() const { return vowels; }
-    std::map<std::string, unsigned int> get_ids() const { return ids; }
+    /*
+     * Adds consonant to the soundSystem
+     * Returns true if the consonant could not be added
+     * Returns false if the consonant was successfully added
+     */
+    bool insert_consonant(std::string, unsigned int);
+
+    /*
+     * Adds vowel to the soundSystem
+     * Returns true if the vowel could not be added
+     * Returns false if vowel was successfully added
+     */
+    bool insert_vowel(std::string, unsigned int);
+
+    /*
+     * Adds suprasegmental to the soundSystem
+     * Returns true if the suprasegmental could not be added
+     * Returns false if the suprasegmental was successfully added
+     */
+    bool insert_suprasegmental(std::string, unsigned int);
+
+    const std::map<unsigned int, Consonant>& get_consonants() const { return consonants; }
+    const std::map<unsigned int, Vowel>& get_vowels() const { return vowels; }
+    const std::map<unsigned int, Suprasegmental>& get_suprasegmentals() const { return suprasegmentals; }
+    const std::map<std::string, unsigned int>& get_ids() const { return ids; }
 };
 
 #endif
@@ -0,0 +1,61 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "inventory.h"
+#include "phonotactics.h"
+#include "corpus.h"
+
+/*
+ * Phoneme, bigram, natural class and syllable constituent frequencies.
+ *
+ * Counting is done in per-thread tables indexed by dense phoneme index and
+ * merged once the whole corpus has been read. The corpus is streamed a
+ * chunk at a time, so memory does not grow with its size.
+ */
+class Statistics {
+private:
+    struct Tables {
+        unsigned long words;
+        unsigned long unknown;                  // Segments not in the inventory
+        std::vector<unsigned long> unigrams;    // Per dense index
+        std::vector<unsigned long> bigrams;     // (size + 1)^2, index size is the word boundary
+        std::unordered_map<std::string, unsigned long> constituents[3];
+    };
+
+    Inventory inventory;
+    const Phonotactics* phonotactics;   // Constituents are only counted if given
+    std::vector<unsigned int> classes;
+
+    Tables totals;
+
+    void reset(Tables&) const;
+    void count_words(const unsigned int* begin, const unsigned int* end, Tables&) const;
+    void merge(const Tables&);
+
+    std::string render_key(const std::string&) const;
+public:
+    Statistics(const Inventory&, const std::vector<unsigned int>& classes,
+               const Phonotactics* phonotactics = nullptr);
+
+    /*
+     * Count every word in a corpus, chunk_size IDs at a time
+     * (0 threads uses every core)
+     */
+    void count(CorpusReader&, size_t chunk_size = 1 << 20, int threads = 0);
+
+    /* Export as rows of statistic,sequence,count */
+    void write_csv(std::ostream&) const;
+    void write_json(std::ostream&) const;
+
+    unsigned long get_words() const { return totals.words; }
+    unsigned long get_count(unsigned int id) const;
+    unsigned long get_count(unsigned int first, unsigned int second) const;
+    unsigned long get_class_count(unsigned int phon_class) const;
+};
+
+#endif
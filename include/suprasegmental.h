@@ -0,0 +1,65 @@
+#ifndef SUPRASEGMENTAL_H
+#define SUPRASEGMENTAL_H
+
+#include <string>
+
+/*
+ * Suprasegmental features, each stored on its own tier instead of in the
+ * IDs of the segments they span
+ */
+enum class Tier {
+    tone = 1,
+    stress,
+    length
+};
+
+#define NUM_TIERS 3
+
+/* Pitch levels of a tone */
+enum class Tone {
+    extra_low = 1,
+    low,
+    mid,
+    high,
+    extra_high
+};
+
+enum class Stress {
+    primary = 1,
+    secondary
+};
+
+/*
+ * Represents a mark for one value of a tier, such as ˈ for primary stress.
+ * Lengths use the values of the Length enum in vowel.h.
+ */
+class Suprasegmental {
+private:
+    std::string symbol;
+    std::string desc;
+    Tier tier;
+    unsigned int value;
+    unsigned int id;
+
+    unsigned int calc_id() const;
+    std::string update_desc() const;
+public:
+    Suprasegmental(std::string symbol, Tier tier, unsigned int value) {
+        this->symbol = symbol;
+        this->tier = tier;
+        this->value = value;
+
+        id = calc_id();
+        desc = update_desc();
+    }
+
+    Suprasegmental() {}
+
+    Tier get_tier() const { return tier; }
+    unsigned int get_value() const { return value; }
+    unsigned int get_id() const { return id; }
+    std::string get_symbol() const { return symbol; }
+    std::string get_desc() const { return desc; }
+};
+
+#endif
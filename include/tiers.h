@@ -0,0 +1,66 @@
+#ifndef TIERS_H
+#define TIERS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "suprasegmental.h"
+
+/*
+ * Tone, stress and length of a flat buffer of segments, such as the IDs of
+ * a WordList.
+ *
+ * Each tier is run-length encoded: a run gives the value of every segment
+ * from its start up to the start of the next run. A value of 0 means the
+ * tier is unmarked. Tones and stress usually span whole syllables, so a tier
+ * costs one run per change of value instead of one value per segment.
+ */
+class Tiers {
+public:
+    struct Run {
+        unsigned int start;
+        unsigned int value;
+    };
+
+    /* Reads the values of one tier at consecutive positions */
+    class Cursor {
+    private:
+        const std::vector<Run>* runs;
+        size_t run;             // Index of the run after the current one
+        size_t position;
+        unsigned int current;
+    public:
+        Cursor(const Tiers&, Tier, size_t position);
+
+        unsigned int value() const { return current; }
+
+        /* Move to the next position */
+        void advance() {
+            position++;
+
+            while (run < runs->size() && (*runs)[run].start <= position) {
+                current = (*runs)[run++].value;
+            }
+        }
+    };
+private:
+    std::vector<Run> runs[NUM_TIERS];      // Sorted by start, neighbours differ in value
+
+    static int index(Tier tier) { return static_cast<int>(tier) - 1; }
+public:
+    /* Give the segments [begin, end) a value on a tier */
+    void set(Tier, size_t begin, size_t end, unsigned int value);
+
+    /* Value of a tier at a position */
+    unsigned int get(Tier, size_t position) const;
+
+    /* Remove every value at or after a position, such as when a word list is cut */
+    void truncate(size_t length);
+
+    void clear();
+
+    const std::vector<Run>& get_runs(Tier tier) const { return runs[index(tier)]; }
+    size_t get_memory() const;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Tracing of which rule changed which segment of which word.
+ *
+ * Callers deriving a word name it by a handle, such as its index in a
+ * lexicon, and say which rule they apply. Rules then record every change
+ * they make to the word as a 16 byte event in a ring buffer of their
+ * thread, overwriting the oldest events once it is full. Only the owning
+ * thread writes a ring, and no lock is taken after its first event.
+ *
+ * Words are sampled by a hash of their handle, so a word is traced at every
+ * stage of its derivation or not at all. Tracing can also be limited to
+ * one word or one rule. While tracing is off, deriving a word checks one
+ * flag, and a rule changing a word that is not sampled checks one flag of
+ * its thread. Without LING_TRACE it compiles to nothing.
+ *
+ * Traces are written to a binary file and decoded offline into readable
+ * derivations, see tests/trace_tool.cpp.
+ */
+
+#define TRACE_MAGIC 0x4352544c     // "LTRC"
+#define TRACE_VERSION 1
+#define TRACE_INPUT 0xffff          // Rule of the events holding the form a derivation starts from
+#define TRACE_ANY 0xffffffff        // No filter
+
+namespace trace {
+
+struct Event {
+    uint32_t word;                  // Handle given by the caller
+    uint16_t rule;                  // Index of the rule, or TRACE_INPUT
+    uint16_t position;
+    uint32_t from;                  // For TRACE_INPUT the phoneme at position
+    uint32_t to;                    // For TRACE_INPUT the index of the first rule applied
+};
+
+struct Settings {
+    size_t capacity = 1 << 16;      // Events kept per thread, rounded up to a power of two
+    uint32_t sample = 1;            // Trace one in sample words
+    uint32_t word = TRACE_ANY;      // Only trace the word with this handle
+    uint32_t rule = TRACE_ANY;      // Only trace changes of this rule
+};
+
+extern std::atomic<bool> enabled_flag;
+
+// Set by enable(), read inline so words that are not sampled cost no call
+extern uint64_t sample_below;           // Words are sampled if the hash of their handle is below this
+extern uint32_t sample_word;            // Settings::word
+
+// State of the word being derived on a thread, read inline for the same reason
+extern thread_local bool traced_flag;   // The word is sampled
+extern thread_local bool active_flag;   // and the current rule passes the filter
+
+#ifdef LING_TRACE
+inline bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+inline bool traced() { return traced_flag; }
+inline bool active() { return active_flag; }
+#else
+inline bool enabled() { return false; }
+inline bool traced() { return false; }
+inline bool active() { return false; }
+#endif
+
+/*
+ * Start tracing, dropping every event recorded before. Only call while no
+ * other thread is deriving words.
+ */
+void enable(const Settings&);
+void disable();
+
+/* Returns true if the word with this handle is traced while tracing is on */
+inline bool sampled(uint32_t handle) {
+    if (sample_word != TRACE_ANY) {
+        return handle == sample_word;
+    }
+
+    return static_cast<uint32_t>(handle * 0x9e3779b1u) < sample_below;
+}
+
+bool start_word(uint32_t handle, const unsigned int* word, int len, int rule);
+
+/*
+ * Start deriving a word from the given rule on. If the word is sampled its
+ * form is recorded, and changes on this thread are recorded until
+ * end_word(), which has to be called before the next word.
+ *
+ * Returns true if the word is traced
+ */
+inline bool begin_word(uint32_t handle, const unsigned int* word, int len, int rule = 0) {
+    return enabled() && sampled(handle) && start_word(handle, word, len, rule);
+}
+
+void end_word();
+
+/* Set the rule the changes of a traced word come from */
+void set_rule(int rule);
+
+/* Record a change to the traced word, callers check active() first */
+void change(int position, unsigned int from, unsigned int to);
+
+/* Every event still in a ring, one list per thread, oldest first */
+std::vector<std::vector<Event>> collect();
+
+/*
+ * Write every event still in a ring to a file
+ *
+ * Returns true if the file couldnt be written
+ * Returns false otherwise
+ */
+bool write(const std::string& path);
+
+/*
+ * Read the events of a file written by write()
+ *
+ * Returns true if the file couldnt be read or is not a trace
+ * Returns false otherwise
+ */
+bool read(const std::string& path, std::vector<std::vector<Event>>& threads);
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "registry.h"
+
+#define WATCH_INTERVAL 500      // Milliseconds between polls, and between looking for newly loaded languages
+#define WATCH_SETTLE 50         // Milliseconds a language's files have to be left alone before it is reloaded
+
+/*
+ * Reloads the languages of a registry when their files change, such as
+ * after SoundSystem::save() or insert_sequences().
+ *
+ * A background thread watches langs/<name>/units and langs/<name>/phonology
+ * of every loaded language, including languages loaded later. Changes are
+ * seen through inotify, or where that is unavailable (or polling is asked
+ * for) by comparing the modification time and size of every file at an
+ * interval. If inotify drops events every language is taken as changed.
+ * Once the files of a language have been left alone for WATCH_SETTLE ms it
+ * is reloaded with Registry::reload(), which reads the sound system,
+ * phonotactics and rules and publishes them without blocking readers,
+ * unless the language was unloaded meanwhile. If the files no longer load
+ * the old version stays.
+ */
+class Watcher {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Modification time in nanoseconds and size of a file
+    typedef std::pair<int64_t, int64_t> Stamp;
+
+    struct Watched {
+        std::vector<int> descriptors;           // inotify watches
+        std::map<std::string, Stamp> stamps;    // Files when polling
+        bool pending = false;                   // Changed and waiting to settle
+        Clock::time_point deadline;
+    };
+
+    Registry& registry;
+    bool polling;
+    int interval;
+
+    std::map<std::string, Watched> languages;
+    std::map<int, std::string> descriptor_languages;
+    unsigned long synced_version = 0;
+
+    int inotify_fd = -1;
+    int wake_fds[2] = {-1, -1};                 // Written to by stop() to end a wait
+    std::thread thread;
+    std::atomic<bool> running;
+
+    std::atomic<unsigned long> reloads;
+    std::atomic<unsigned long> failures;
+
+    /* Start watching newly loaded languages and stop watching unloaded ones */
+    void sync();
+
+    /* Stamps of every file of a language */
+    static std::map<std::string, Stamp> scan(const std::string& name);
+
+    /* Mark a language as changed, reloading it once it settles */
+    void touch(Watched&);
+
+    void read_events();
+    void run();
+public:
+    /* polling: compare files every interval ms even if inotify is available */
+    Watcher(Registry&, bool polling = false, int interval = WATCH_INTERVAL);
+    ~Watcher() { stop(); }
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    /*
+     * Start watching in a background thread
+     *
+     * Returns true if it is already running or couldnt be started
+     * Returns false otherwise
+     */
+    bool start();
+
+    /* Stop watching and wait for a reload in progress to finish */
+    void stop();
+
+    /* Returns true if changes are found by polling instead of inotify */
+    bool is_polling() const { return polling; }
+
+    unsigned long get_reloads() const { return reloads; }
+    unsigned long get_failures() const { return failures; }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef WORDLIST_H
+#define WORDLIST_H
+
+#include <vector>
+
+/* A list of words stored in one flat buffer of phoneme IDs */
+class WordList {
+private:
+    std::vector<unsigned int> ids;
+    std::vector<unsigned int> offsets;      // Word i spans [offsets[i], offsets[i + 1])
+public:
+    WordList() : offsets(1, 0) {}
+
+    unsigned int add(const unsigned int* word, int len) {
+        ids.insert(ids.end(), word, word + len);
+        offsets.push_back(ids.size());
+        return offsets.size() - 2;
+    }
+
+    unsigned int add(const std::vector<unsigned int>& word) { return add(word.data(), word.size()); }
+
+    /* Add every word of another list, in order */
+    void append(const WordList& words) {
+        unsigned int base = ids.size();
+
+        ids.insert(ids.end(), words.ids.begin(), words.ids.end());
+
+        for (size_t i = 1; i < words.offsets.size(); i++) {
+            offsets.push_back(base + words.offsets[i]);
+        }
+    }
+
+    void clear() {
+        ids.clear();
+        offsets.assign(1, 0);
+    }
+
+    const unsigned int* get(unsigned int index) const { return ids.data() + offsets[index]; }
+    int length(unsigned int index) const { return offsets[index + 1] - offsets[index]; }
+
+    std::vector<unsigned int> get_word(unsigned int index) const {
+        return std::vector<unsigned int>(ids.begin() + offsets[index], ids.begin() + offsets[index + 1]);
+    }
+
+    unsigned int size() const { return offsets.size() - 1; }
+    const std::vector<unsigned int>& get_ids() const { return ids; }
+};
+
+#endif
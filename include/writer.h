@@ -0,0 +1,111 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "inventory.h"
+
+#define WRITER_BUFFER (1 << 20)        // Bytes buffered before each write
+
+/*
+ * Formats a Writer can export words in
+ *
+ * ndjson: one object per line, {"ids":[...],"text":"..."}
+ * csv:    the header ids,text then one word per line, IDs in hex separated by spaces
+ * binary: 32 bit little-endian IDs with WORD_BOUNDARY after every word, as read by CorpusReader
+ *
+ * The text of a word is only written when the writer has an inventory.
+ */
+enum class Format {ndjson, csv, binary};
+
+/*
+ * Parse the name of a format
+ *
+ * Returns true if there is no format with that name
+ * Returns false otherwise
+ */
+bool parse_format(const std::string&, Format&);
+
+/*
+ * Streams words to a file through a fixed buffer, so memory stays constant
+ * however many words are written.
+ *
+ * Output can be split into chunks of a fixed number of words, written to
+ * <path>.0, <path>.1 and so on. Every chunk is a complete file on its own.
+ * A path of - writes to stdout.
+ */
+class Writer {
+private:
+    Format format;
+    const Inventory* inventory;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    std::string path;
+    std::ofstream file;
+    std::ostream* output = nullptr;
+    unsigned long chunk_words = 0;
+    unsigned long chunk = 0;
+    unsigned long words = 0;
+    unsigned long long bytes = 0;
+    bool failed = false;
+
+    bool open_chunk();
+    bool flush();
+    char* reserve(size_t);
+public:
+    Writer(Format, const Inventory* inventory = nullptr, size_t buffer_size = WRITER_BUFFER);
+    ~Writer() { close(); }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /*
+     * Start writing to a path, in chunks of chunk_words words if it is not 0
+     *
+     * Returns true if the file couldnt be opened
+     * Returns false otherwise
+     */
+    bool open(std::string path, unsigned long chunk_words = 0);
+
+    /*
+     * Returns true if the output could not be written
+     * Returns false otherwise
+     */
+    bool write(const unsigned int* word, int len);
+    bool write(const std::vector<unsigned int>& word) { return write(word.data(), word.size()); }
+
+    /*
+     * Write every word of a cursor, anything with next() and get_word()
+     * such as Sequences or Lexicon::Cursor
+     *
+     * Returns true if the output could not be written
+     * Returns false otherwise
+     */
+    template<typename Cursor>
+    bool write_all(Cursor& cursor) {
+        while (cursor.next()) {
+            if (write(cursor.get_word())) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * Flush and close the output
+     *
+     * Returns true if any write failed
+     * Returns false otherwise
+     */
+    bool close();
+
+    unsigned long get_words() const { return words; }
+    unsigned long long get_bytes() const { return bytes; }
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "ling.h"
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "interaction.h"
+#include "phonotactics.h"
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_same<uint32_t, unsigned int>::value, "phoneme IDs are passed through as unsigned int");
+
+struct ling_language {
+    Inventory inventory;
+    Cascade cascade;            // The rules, fused into as few passes as they allow
+    Phonotactics phonotactics;
+    bool has_phonotactics;
+
+    // Byte trie over every symbol for tokenizing without allocating, node 0 is the root
+    std::vector<int32_t> transitions;       // node * 256 + byte -> node, 0 if there is none
+    std::vector<int32_t> accepts;           // Inventory index of the symbol ending at a node, -1 if none
+
+    ling_language(const std::string& name, const SoundSystem& sound_system, const std::vector<Rule>& rules)
+        : inventory(sound_system), cascade(inventory, rules), phonotactics(name), has_phonotactics(false) {
+
+        transitions.assign(256, 0);
+        accepts.assign(1, -1);
+
+        for (int i = 0; i < inventory.size(); i++) {
+            int32_t node = 0;
+
+            for (auto const& c: inventory.get_symbol(i)) {
+                int32_t& next = transitions[node * 256 + static_cast<unsigned char>(c)];
+
+                if (next == 0) {
+                    next = accepts.size();
+                    accepts.push_back(-1);
+                    transitions.resize(transitions.size() + 256, 0);
+                }
+
+                // resize may have moved the table, so read the transition again
+                node = transitions[node * 256 + static_cast<unsigned char>(c)];
+            }
+
+            if (accepts[node] < 0) {
+                accepts[node] = i;
+            }
+        }
+    }
+};
+
+// Returns true if an output buffer is missing but claims room
+static bool invalid_buffer(const void* data, uint32_t capacity) {
+    return data == nullptr && capacity > 0;
+}
+
+// Returns true if a batch is missing or its offsets decrease
+static bool invalid_batch(const uint32_t* offsets, uint32_t count, const void* data) {
+    if (offsets == nullptr || (data == nullptr && count > 0 && offsets[count] > offsets[0])) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+extern "C" {
+
+int ling_version(void) {
+    return LING_API_VERSION;
+}
+
+const char* ling_status_string(ling_status status) {
+    switch (status) {
+        case LING_OK: return "ok";
+        case LING_NOT_FOUND: return "language not found";
+        case LING_UNKNOWN_SYMBOL: return "unknown symbol";
+        case LING_BUFFER_FULL: return "output buffer full";
+        case LING_UNAVAILABLE: return "not available for this language";
+        case LING_INVALID: return "invalid argument";
+        case LING_INTERNAL: return "internal error";
+    }
+
+    return "unknown status";
+}
+
+ling_status ling_load(const char* name, ling_language** language) {
+    if (name == nullptr || language == nullptr) {
+        return LING_INVALID;
+    }
+
+    *language = nullptr;
+
+    try {
+        SoundSystem sound_system(name);
+
+        if (sound_system.load()) {
+            return LING_NOT_FOUND;
+        }
+
+        // Languages without rules derive every word unchanged
+        std::vector<Rule> rules;
+        load_rules("langs/" + std::string(name) + "/phonology/rules.csv", rules);
+
+        ling_language* loaded = new ling_language(name, sound_system, rules);
+        loaded->has_phonotactics = !loaded->phonotactics.load();
+
+        *language = loaded;
+        return LING_OK;
+    } catch (...) {
+        return LING_INTERNAL;
+    }
+}
+
+void ling_free(ling_language* language) {
+    delete language;
+}
+
+uint32_t ling_inventory_size(const ling_language* language) {
+    return language == nullptr ? 0 : language->inventory.size();
+}
+
+ling_status ling_tokenize(const ling_language* language, const ling_texts* input,
+                          ling_word_buffer* output, uint8_t* failed) {
+
+    if (language == nullptr || input == nullptr || output == nullptr || output->offsets == nullptr
+        || invalid_buffer(output->ids, output->capacity)
+        || invalid_batch(input->offsets, input->count, input->data)) {
+        return LING_INVALID;
+    }
+
+    try {
+        const int32_t* transitions = language->transitions.data();
+        const int32_t* accepts = language->accepts.data();
+        uint32_t used = 0;
+        bool any_failed = false;
+
+        output->offsets[0] = 0;
+        output->written = 0;
+
+        for (uint32_t w = 0; w < input->count; w++) {
+            const char* text = input->data + input->offsets[w];
+            const char* end = input->data + input->offsets[w + 1];
+            uint32_t start = used;
+            bool ok = true;
+
+            while (text < end) {
+                if (*text == ' ') {
+                    text++;
+                    continue;
+                }
+
+                // Longest symbol starting here
+                int32_t node = 0, match = -1;
+                const char* match_end = text;
+
+                for (const char* c = text; c < end; c++) {
+                    node = transitions[node * 256 + static_cast<unsigned char>(*c)];
+
+                    if (node == 0) {
+                        break;
+                    }
+
+                    if (accepts[node] >= 0) {
+                        match = accepts[node];
+                        match_end = c + 1;
+                    }
+                }
+
+                if (match < 0) {
+                    ok = false;
+                    break;
+                }
+
+                if (used == output->capacity) {
+                    return LING_BUFFER_FULL;
+                }
+
+                output->ids[used++] = language->inventory.get_id(match);
+                text = match_end;
+            }
+
+            if (!ok) {
+                used = start;
+                any_failed = true;
+            }
+
+            if (failed != nullptr) {
+                failed[w] = !ok;
+            }
+
+            output->offsets[w + 1] = used;
+            output->written = w + 1;
+        }
+
+        return any_failed ? LING_UNKNOWN_SYMBOL : LING_OK;
+    } catch (...) {
+        return LING_INTERNAL;
+    }
+}
+
+ling_status ling_derive(const ling_language* language, const ling_words* input, ling_word_buffer* output) {
+    if (language == nullptr || input == nullptr || output == nullptr || output->offsets == nullptr
+        || invalid_buffer(output->ids, output->capacity)
+        || invalid_batch(input->offsets, input->count, input->ids)) {
+        return LING_INVALID;
+    }
+
+    try {
+        uint32_t used = 0;
+
+        output->offsets[0] = 0;
+        output->written = 0;
+
+        for (uint32_t w = 0; w < input->count; w++) {
+            const unsigned int* word = input->ids + input->offsets[w];
+            uint32_t len = input->offsets[w + 1] - input->offsets[w];
+
+            if (output->capacity - used < len) {
+                return LING_BUFFER_FULL;
+            }
+
+            language->cascade.apply(word, output->ids + used, len);
+
+            used += len;
+            output->offsets[w + 1] = used;
+            output->written = w + 1;
+        }
+
+        return LING_OK;
+    } catch (...) {
+        return LING_INTERNAL;
+    }
+}
+
+ling_status ling_validate(const ling_language* language, const ling_words* input, uint8_t* valid) {
+    if (language == nullptr || input == nullptr || valid == nullptr
+        || invalid_batch(input->offsets, input->count, input->ids)) {
+        return LING_INVALID;
+    }
+
+    if (!language->has_phonotactics) {
+        return LING_UNAVAILABLE;
+    }
+
+    try {
+        for (uint32_t w = 0; w < input->count; w++) {
+            valid[w] = language->phonotactics.validate(input->ids + input->offsets[w],
+                                                       input->offsets[w + 1] - input->offsets[w]);
+        }
+
+        return LING_OK;
+    } catch (...) {
+        return LING_INTERNAL;
+    }
+}
+
+ling_status ling_render(const ling_language* language, const ling_words* input, ling_text_buffer* output) {
+    if (language == nullptr || input == nullptr || output == nullptr || output->offsets == nullptr
+        || invalid_buffer(output->data, output->capacity)
+        || invalid_batch(input->offsets, input->count, input->ids)) {
+        return LING_INVALID;
+    }
+
+    try {
+        // Stores through data may alias anything, so nothing is read through pointers in the loop
+        const Inventory& inventory = language->inventory;
+        const uint32_t* ids = input->ids;
+        const uint32_t* offsets = input->offsets;
+        uint32_t* output_offsets = output->offsets;
+        char* data = output->data;
+        uint32_t capacity = output->capacity;
+        uint32_t count = input->count;
+        uint32_t used = 0;
+
+        output_offsets[0] = 0;
+        output->written = 0;
+
+        for (uint32_t w = 0; w < count; w++) {
+            for (uint32_t i = offsets[w], end = offsets[w + 1]; i < end; i++) {
+                int index = inventory.index_of(ids[i]);
+
+                if (index < 0) {
+                    continue;
+                }
+
+                const std::string& symbol = inventory.get_symbol(index);
+                size_t len = symbol.size();
+
+                // Only whole words count as written
+                if (capacity - used < len) {
+                    return LING_BUFFER_FULL;
+                }
+
+                std::memcpy(data + used, symbol.data(), len);
+                used += len;
+            }
+
+            output_offsets[w + 1] = used;
+            output->written = w + 1;
+        }
+
+        return LING_OK;
+    } catch (...) {
+        return LING_INTERNAL;
+    }
+}
+
+}
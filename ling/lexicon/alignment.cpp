@@ -0,0 +1,444 @@
+#include "alignment.h"
+#include "distance.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <climits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Substitution score of padding past the end of a target word, low enough
+// that no local alignment ever runs into it
+#define ALIGN_PADDING (SHRT_MIN / 2)
+
+void Correspondences::add(const Alignment& alignment, const unsigned short* a, const unsigned short* b) {
+    for (auto const& pair: alignment.pairs) {
+        int row = pair.first < 0 ? get_gap_a() : a[pair.first];
+        int column = pair.second < 0 ? get_gap_b() : b[pair.second];
+
+        counts[row * columns + column]++;
+    }
+}
+
+void Correspondences::merge(const Correspondences& other) {
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+}
+
+Aligner::Aligner(const Inventory& a, const Inventory& b, AlignMode mode)
+    : inventory_a(a), inventory_b(b), mode(mode) {
+
+    CostMatrix costs(a, b);
+    scores.resize(a.size() * b.size());
+
+    for (int i = 0; i < a.size(); i++) {
+        for (int j = 0; j < b.size(); j++) {
+            scores[i * b.size() + j] = ALIGN_MATCH - costs.get_cost(i, j);
+        }
+    }
+}
+
+bool Aligner::to_dense(const Inventory& inventory, const WordList& words, std::vector<unsigned short>& dense,
+                       std::vector<unsigned int>& offsets) const {
+    dense.clear();
+    offsets.assign(1, 0);
+
+    for (unsigned int w = 0; w < words.size(); w++) {
+        const unsigned int* word = words.get(w);
+
+        for (int i = 0; i < words.length(w); i++) {
+            int index = inventory.index_of(word[i]);
+
+            if (index < 0) {
+                return true;
+            }
+
+            dense.push_back(index);
+        }
+
+        offsets.push_back(dense.size());
+    }
+
+    return false;
+}
+
+int Aligner::score(const unsigned short* a, int len_a, const unsigned short* b, int len_b) const {
+    // One column of the matrix, reused between calls
+    static thread_local std::vector<int> column;
+    column.resize(len_b + 1);
+
+    bool local = mode == AlignMode::local;
+    int size_b = inventory_b.size();
+    int best = 0;
+
+    for (int j = 0; j <= len_b; j++) {
+        column[j] = local ? 0 : -j * ALIGN_GAP;
+    }
+
+    for (int i = 1; i <= len_a; i++) {
+        const short* row = scores.data() + a[i - 1] * size_b;
+        int diag = column[0];
+        column[0] = local ? 0 : -i * ALIGN_GAP;
+
+        for (int j = 1; j <= len_b; j++) {
+            int h = std::max(diag + row[b[j - 1]], std::max(column[j], column[j - 1]) - ALIGN_GAP);
+
+            if (local) {
+                h = std::max(h, 0);
+                best = std::max(best, h);
+            }
+
+            diag = column[j];
+            column[j] = h;
+        }
+    }
+
+    return local ? best : column[len_b];
+}
+
+Alignment Aligner::align(const unsigned short* a, int len_a, const unsigned short* b, int len_b) const {
+    bool local = mode == AlignMode::local;
+    int size_b = inventory_b.size();
+    int width = len_b + 1;
+    std::vector<int> matrix((len_a + 1) * width);
+
+    int end_i = len_a, end_j = len_b;
+    Alignment output;
+
+    for (int i = 0; i <= len_a; i++) {
+        for (int j = 0; j <= len_b; j++) {
+            int h;
+
+            if (i == 0 || j == 0) {
+                h = local ? 0 : -(i + j) * ALIGN_GAP;
+            } else {
+                h = std::max(matrix[(i - 1) * width + j - 1] + scores[a[i - 1] * size_b + b[j - 1]],
+                             std::max(matrix[(i - 1) * width + j], matrix[i * width + j - 1]) - ALIGN_GAP);
+
+                if (local) {
+                    h = std::max(h, 0);
+                }
+            }
+
+            matrix[i * width + j] = h;
+
+            // A local alignment ends at the first cell with the best score
+            if (local && h > output.score) {
+                output.score = h;
+                end_i = i;
+                end_j = j;
+            }
+        }
+    }
+
+    if (!local) {
+        output.score = matrix[len_a * width + len_b];
+    } else if (output.score == 0) {
+        return output;
+    }
+
+    int i = end_i, j = end_j;
+
+    while (i > 0 || j > 0) {
+        int h = matrix[i * width + j];
+
+        if (local && h == 0) {
+            break;
+        }
+
+        if (i > 0 && j > 0 && h == matrix[(i - 1) * width + j - 1] + scores[a[i - 1] * size_b + b[j - 1]]) {
+            output.pairs.push_back(std::make_pair(--i, --j));
+        } else if (i > 0 && h == matrix[(i - 1) * width + j] - ALIGN_GAP) {
+            output.pairs.push_back(std::make_pair(--i, -1));
+        } else {
+            output.pairs.push_back(std::make_pair(-1, --j));
+        }
+    }
+
+    std::reverse(output.pairs.begin(), output.pairs.end());
+    return output;
+}
+
+bool Aligner::align(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b, Alignment& output) const {
+    std::vector<unsigned short> dense_a, dense_b;
+
+    for (auto const& id: a) {
+        int index = inventory_a.index_of(id);
+
+        if (index < 0) {
+            return true;
+        }
+
+        dense_a.push_back(index);
+    }
+
+    for (auto const& id: b) {
+        int index = inventory_b.index_of(id);
+
+        if (index < 0) {
+            return true;
+        }
+
+        dense_b.push_back(index);
+    }
+
+    output = align(dense_a.data(), dense_a.size(), dense_b.data(), dense_b.size());
+    return false;
+}
+
+#ifdef __SSE2__
+/*
+ * Score one word against the ALIGN_LANES target words of a profile, a
+ * column of the matrix at a time. profile[(j * size_a + a) * ALIGN_LANES + l]
+ * is the score of phoneme a against position j of target l and ends marks
+ * the lanes whose target ends at each position.
+ */
+template<bool Local>
+static void align_lanes(const short* profile, const short* ends, int size_a, const unsigned short* word, int len,
+                        int longest, const short* initial, std::vector<short>& cells, short* results) {
+    const __m128i gap = _mm_set1_epi16(ALIGN_GAP);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i best = zero;
+    __m128i result = _mm_loadu_si128(reinterpret_cast<const __m128i*>(initial));
+
+    // One column of the matrix, ALIGN_LANES cells per row
+    cells.resize((len + 1) * ALIGN_LANES);
+    __m128i* column = reinterpret_cast<__m128i*>(cells.data());
+
+    for (int i = 0; i <= len; i++) {
+        _mm_storeu_si128(column + i, _mm_set1_epi16(Local ? 0 : -i * ALIGN_GAP));
+    }
+
+    for (int j = 0; j < longest; j++) {
+        const short* scores = profile + j * size_a * ALIGN_LANES;
+        __m128i diag = _mm_loadu_si128(column);
+        __m128i up = Local ? zero : _mm_set1_epi16(-(j + 1) * ALIGN_GAP);
+        _mm_storeu_si128(column, up);
+
+        for (int i = 1; i <= len; i++) {
+            __m128i left = _mm_loadu_si128(column + i);
+            __m128i score = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + word[i - 1] * ALIGN_LANES));
+            __m128i h = _mm_adds_epi16(diag, score);
+            h = _mm_max_epi16(h, _mm_subs_epi16(_mm_max_epi16(left, up), gap));
+
+            if (Local) {
+                h = _mm_max_epi16(h, zero);
+                best = _mm_max_epi16(best, h);
+            }
+
+            diag = left;
+            _mm_storeu_si128(column + i, h);
+            up = h;
+        }
+
+        if (!Local) {
+            // Keep the last row of every target that ends here
+            __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ends + j * ALIGN_LANES));
+            result = _mm_or_si128(_mm_and_si128(mask, up), _mm_andnot_si128(mask, result));
+        }
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(results), Local ? best : result);
+}
+#endif
+
+template<typename Visitor>
+void Aligner::sweep(const std::vector<unsigned short>& dense_a, const std::vector<unsigned int>& offsets_a,
+                    const std::vector<unsigned short>& dense_b, const std::vector<unsigned int>& offsets_b,
+                    int threads, Visitor visit) const {
+
+    unsigned int count_a = offsets_a.size() - 1;
+    unsigned int count_b = offsets_b.size() - 1;
+    size_t batches = (count_b + ALIGN_LANES - 1) / ALIGN_LANES;
+
+    parallel_batches(batches, threads, [&](size_t begin, size_t end, int thread) {
+        int size_a = inventory_a.size();
+        int size_b = inventory_b.size();
+        short results[ALIGN_LANES];
+
+#ifdef __SSE2__
+        std::vector<short> profile, ends;
+        std::vector<short> column;
+        short initial[ALIGN_LANES] = {0};
+#endif
+
+        for (size_t batch = begin; batch < end; batch++) {
+            unsigned int first = batch * ALIGN_LANES;
+            int count = std::min<unsigned int>(ALIGN_LANES, count_b - first);
+            int lengths[ALIGN_LANES] = {0};
+            int longest = 0;
+
+            for (int l = 0; l < count; l++) {
+                lengths[l] = offsets_b[first + l + 1] - offsets_b[first + l];
+                longest = std::max(longest, lengths[l]);
+            }
+
+#ifdef __SSE2__
+            // Scores of every phoneme of a against each position of the targets
+            profile.resize(longest * size_a * ALIGN_LANES);
+            ends.assign(longest * ALIGN_LANES, 0);
+
+            for (int l = 0; l < count; l++) {
+                if (lengths[l] > 0) {
+                    ends[(lengths[l] - 1) * ALIGN_LANES + l] = -1;
+                }
+            }
+
+            for (int j = 0; j < longest; j++) {
+                for (int a = 0; a < size_a; a++) {
+                    short* out = profile.data() + (j * size_a + a) * ALIGN_LANES;
+
+                    for (int l = 0; l < ALIGN_LANES; l++) {
+                        out[l] = l < count && j < lengths[l]
+                               ? scores[a * size_b + dense_b[offsets_b[first + l] + j]]
+                               : ALIGN_PADDING;
+                    }
+                }
+            }
+#endif
+
+            for (unsigned int w = 0; w < count_a; w++) {
+                const unsigned short* word = dense_a.data() + offsets_a[w];
+                int len = offsets_a[w + 1] - offsets_a[w];
+
+#ifdef __SSE2__
+                if (len <= ALIGN_MAX_LENGTH && longest <= ALIGN_MAX_LENGTH) {
+                    if (mode == AlignMode::local) {
+                        align_lanes<true>(profile.data(), ends.data(), size_a, word, len, longest,
+                                          initial, column, results);
+                    } else {
+                        // Targets without phonemes end before the first column
+                        for (int l = 0; l < ALIGN_LANES; l++) {
+                            initial[l] = -len * ALIGN_GAP;
+                        }
+
+                        align_lanes<false>(profile.data(), ends.data(), size_a, word, len, longest,
+                                           initial, column, results);
+                    }
+
+                    visit(w, first, results, count, thread);
+                    continue;
+                }
+#endif
+
+                for (int l = 0; l < count; l++) {
+                    int s = score(word, len, dense_b.data() + offsets_b[first + l], lengths[l]);
+                    results[l] = std::max(SHRT_MIN, std::min(SHRT_MAX, s));
+                }
+
+                visit(w, first, results, count, thread);
+            }
+        }
+    });
+}
+
+bool Aligner::align_all(const WordList& a, const WordList& b, std::vector<short>& output, int threads) const {
+    std::vector<unsigned short> dense_a, dense_b;
+    std::vector<unsigned int> offsets_a, offsets_b;
+
+    if (to_dense(inventory_a, a, dense_a, offsets_a) || to_dense(inventory_b, b, dense_b, offsets_b)) {
+        return true;
+    }
+
+    size_t count_b = b.size();
+    output.resize(a.size() * count_b);
+
+    sweep(dense_a, offsets_a, dense_b, offsets_b, threads,
+        [&](unsigned int w, unsigned int first, const short* results, int count, int) {
+            std::copy(results, results + count, output.begin() + w * count_b + first);
+        });
+
+    return false;
+}
+
+bool Aligner::best_matches(const WordList& a, const WordList& b, std::vector<std::pair<unsigned int, int>>& output,
+                           int threads) const {
+    std::vector<unsigned short> dense_a, dense_b;
+    std::vector<unsigned int> offsets_a, offsets_b;
+
+    if (to_dense(inventory_a, a, dense_a, offsets_a) || to_dense(inventory_b, b, dense_b, offsets_b)) {
+        return true;
+    }
+
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    // Every thread covers later words of b than the one before it, so
+    // merging in order keeps the first word on ties
+    std::vector<std::vector<std::pair<unsigned int, int>>> found(threads,
+        std::vector<std::pair<unsigned int, int>>(a.size(), std::make_pair(0u, INT_MIN)));
+
+    sweep(dense_a, offsets_a, dense_b, offsets_b, threads,
+        [&](unsigned int w, unsigned int first, const short* results, int count, int thread) {
+            std::pair<unsigned int, int>& best = found[thread][w];
+
+            for (int l = 0; l < count; l++) {
+                if (results[l] > best.second) {
+                    best = std::make_pair(first + l, results[l]);
+                }
+            }
+        });
+
+    output = found[0];
+
+    for (int t = 1; t < threads; t++) {
+        for (unsigned int w = 0; w < a.size(); w++) {
+            if (found[t][w].second > output[w].second) {
+                output[w] = found[t][w];
+            }
+        }
+    }
+
+    return false;
+}
+
+bool Aligner::correspondences(const WordList& a, const WordList& b, int min_score, Correspondences& output,
+                              std::vector<std::pair<unsigned int, unsigned int>>& matches, int threads) const {
+    std::vector<std::pair<unsigned int, int>> forward, backward;
+    Aligner reverse(inventory_b, inventory_a, mode);
+
+    if (best_matches(a, b, forward, threads) || reverse.best_matches(b, a, backward, threads)) {
+        return true;
+    }
+
+    matches.clear();
+
+    for (unsigned int w = 0; w < forward.size(); w++) {
+        // Every score is INT_MIN when b is empty
+        if (forward[w].second != INT_MIN && forward[w].second >= min_score && backward[forward[w].first].first == w) {
+            matches.push_back(std::make_pair(w, forward[w].first));
+        }
+    }
+
+    std::vector<unsigned short> dense_a, dense_b;
+    std::vector<unsigned int> offsets_a, offsets_b;
+    to_dense(inventory_a, a, dense_a, offsets_a);
+    to_dense(inventory_b, b, dense_b, offsets_b);
+
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    std::vector<Correspondences> counts(threads, Correspondences(inventory_a.size(), inventory_b.size()));
+
+    parallel_batches(matches.size(), threads, [&](size_t begin, size_t end, int thread) {
+        for (size_t m = begin; m < end; m++) {
+            const unsigned short* word_a = dense_a.data() + offsets_a[matches[m].first];
+            const unsigned short* word_b = dense_b.data() + offsets_b[matches[m].second];
+
+            Alignment alignment = align(word_a, offsets_a[matches[m].first + 1] - offsets_a[matches[m].first],
+                                        word_b, offsets_b[matches[m].second + 1] - offsets_b[matches[m].second]);
+            counts[thread].add(alignment, word_a, word_b);
+        }
+    });
+
+    for (auto const& table: counts) {
+        output.merge(table);
+    }
+
+    return false;
+}
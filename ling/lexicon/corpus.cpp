@@ -0,0 +1,67 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <string>
+
+bool CorpusReader::next(std::vector<unsigned int>& chunk, size_t max_ids) {
+    chunk.clear();
+
+    if (inventory != nullptr) {
+        std::string line;
+        std::vector<unsigned int> word;
+
+        while (chunk.size() < max_ids && getline(input, line)) {
+            if (inventory->parse(line, word)) {
+                failed++;
+            } else if (!word.empty()) {
+                chunk.insert(chunk.end(), word.begin(), word.end());
+                chunk.push_back(WORD_BOUNDARY);
+            }
+        }
+
+        return !chunk.empty();
+    }
+
+    chunk.swap(carry);
+    carry.clear();
+
+    // The carried partial word has no boundary, so only what is read after it is searched
+    size_t searched = chunk.size();
+
+    while (true) {
+        size_t start = chunk.size();
+
+        // A word longer than a chunk doubles it until the word ends
+        chunk.resize(std::max(std::max(max_ids, 2 * start), start + 1));
+
+        input.read(reinterpret_cast<char*>(chunk.data() + start), (chunk.size() - start) * sizeof(unsigned int));
+        chunk.resize(start + input.gcount() / sizeof(unsigned int));
+
+        if (!input) {
+            break;
+        }
+
+        // Keep the trailing partial word for the next chunk
+        auto last = std::find(chunk.rbegin(), chunk.rend() - searched, static_cast<unsigned int>(WORD_BOUNDARY));
+
+        if (last != chunk.rend() - searched) {
+            size_t end = chunk.rend() - last;
+            carry.assign(chunk.begin() + end, chunk.end());
+            chunk.resize(end);
+            break;
+        }
+
+        searched = chunk.size();
+    }
+
+    if (chunk.empty()) {
+        return false;
+    }
+
+    // The last word of a corpus may have no boundary
+    if (chunk.back() != WORD_BOUNDARY) {
+        chunk.push_back(WORD_BOUNDARY);
+    }
+
+    return true;
+}
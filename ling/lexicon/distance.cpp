@@ -0,0 +1,301 @@
+#include "distance.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <queue>
+
+int feature_distance(unsigned int a, unsigned int b) {
+    unsigned int diff = a ^ b;
+    int count = 0;
+
+    for (int i = 0; i < 32; i += 4) {
+        if ((diff >> i) & 0xF) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+CostMatrix::CostMatrix(const Inventory& rows, const Inventory& columns) {
+    size = rows.size();
+    this->columns = columns.size();
+    costs.resize(size * this->columns);
+
+    for (int a = 0; a < size; a++) {
+        for (int b = 0; b < this->columns; b++) {
+            costs[a * this->columns + b] = feature_distance(rows.get_id(a), columns.get_id(b));
+        }
+    }
+}
+
+int weighted_distance(const CostMatrix& costs, const unsigned short* a, int len_a,
+                      const unsigned short* b, int len_b, int bound) {
+
+    if (std::abs(len_a - len_b) * INDEL_COST > bound) {
+        return bound + 1;
+    }
+
+    // Reused between calls to avoid allocating per comparison
+    static thread_local std::vector<int> rows;
+    rows.resize(2 * (len_b + 1));
+
+    int* prev = rows.data();
+    int* cur = prev + len_b + 1;
+
+    for (int j = 0; j <= len_b; j++) {
+        prev[j] = j * INDEL_COST;
+    }
+
+    for (int i = 1; i <= len_a; i++) {
+        int row_min = cur[0] = i * INDEL_COST;
+
+        for (int j = 1; j <= len_b; j++) {
+            int cost = std::min(prev[j], cur[j - 1]) + INDEL_COST;
+            cost = std::min(cost, prev[j - 1] + costs.get_cost(a[i - 1], b[j - 1]));
+
+            cur[j] = cost;
+            row_min = std::min(row_min, cost);
+        }
+
+        // Every later row is at least the minimum of this one
+        if (row_min > bound) {
+            return bound + 1;
+        }
+
+        std::swap(prev, cur);
+    }
+
+    return prev[len_b] > bound ? bound + 1 : prev[len_b];
+}
+
+bool Pattern::set(const unsigned short* pattern, int pattern_len) {
+    for (auto const& symbol: symbols) {
+        peq[symbol] = 0;
+    }
+
+    symbols.clear();
+    len = 0;
+
+    if (pattern_len > 64) {
+        return true;
+    }
+
+    for (int i = 0; i < pattern_len; i++) {
+        peq[pattern[i]] |= static_cast<uint64_t>(1) << i;
+        symbols.push_back(pattern[i]);
+    }
+
+    len = pattern_len;
+    return false;
+}
+
+int Pattern::distance(const unsigned short* text, int text_len) const {
+    if (len == 0) {
+        return text_len;
+    }
+
+    uint64_t pv = ~static_cast<uint64_t>(0), mv = 0;
+    uint64_t last = static_cast<uint64_t>(1) << (len - 1);
+    int score = len;
+
+    for (int j = 0; j < text_len; j++) {
+        uint64_t eq = peq[text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) {
+            score++;
+        } else if (mh & last) {
+            score--;
+        }
+
+        // The first row of the matrix grows by one per column
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return score;
+}
+
+SimilarityIndex::SimilarityIndex(const Inventory& inventory) : inventory(inventory), costs(inventory) {
+    offsets.push_back(0);
+}
+
+bool SimilarityIndex::to_dense(const std::vector<unsigned int>& word, std::vector<unsigned short>& output) const {
+    output.clear();
+
+    for (auto const& id: word) {
+        int index = inventory.index_of(id);
+
+        if (index < 0) {
+            return true;
+        }
+
+        output.push_back(index);
+    }
+
+    return false;
+}
+
+long SimilarityIndex::insert(const std::vector<unsigned int>& word) {
+    std::vector<unsigned short> dense;
+
+    if (to_dense(word, dense)) {
+        return -1;
+    }
+
+    unsigned int index = get_word_count();
+    Node node = {index, 0, 0, 0, 0};
+
+    if (!nodes.empty()) {
+        unsigned int cur = 0;
+
+        while (true) {
+            Node& parent = nodes[cur];
+            const unsigned short* other = words.data() + offsets[parent.word];
+            int d = weighted_distance(costs, dense.data(), dense.size(), other,
+                                      offsets[parent.word + 1] - offsets[parent.word], INT_MAX - 1);
+
+            if (d == 0) {
+                return parent.word;
+            }
+
+            unsigned int child = parent.first_child;
+
+            while (child != 0 && nodes[child].distance != d) {
+                child = nodes[child].next_sibling;
+            }
+
+            if (child == 0) {
+                // Node 0 is the root, so 0 also marks the end of a list
+                node.distance = d;
+                node.next_sibling = parent.first_child;
+                parent.first_child = nodes.size();
+                parent.max_child = std::max<int>(parent.max_child, d);
+                break;
+            }
+
+            cur = child;
+        }
+    }
+
+    nodes.push_back(node);
+    words.insert(words.end(), dense.begin(), dense.end());
+    offsets.push_back(words.size());
+
+    return index;
+}
+
+template<typename Visitor>
+void SimilarityIndex::search(const std::vector<unsigned short>& query, int radius, Visitor visit) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    Pattern pattern(costs.get_size());
+    bool use_pattern = !pattern.set(query.data(), query.size());
+
+    std::vector<unsigned int> stack(1, 0);
+
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        const unsigned short* word = words.data() + offsets[node.word];
+        int len = offsets[node.word + 1] - offsets[node.word];
+
+        // Children can only be in range if the distance is at most max_child + radius
+        int bound = node.max_child + radius;
+        int d;
+
+        if (use_pattern && pattern.distance(word, len) > bound) {
+            d = bound + 1;
+        } else {
+            d = weighted_distance(costs, query.data(), query.size(), word, len, bound);
+        }
+
+        if (d <= radius) {
+            radius = visit(node.word, d);
+        }
+
+        for (unsigned int child = node.first_child; child != 0; child = nodes[child].next_sibling) {
+            if (std::abs(nodes[child].distance - d) <= radius) {
+                stack.push_back(child);
+            }
+        }
+    }
+}
+
+std::vector<std::pair<unsigned int, int>> SimilarityIndex::within(const std::vector<unsigned int>& word, int radius) const {
+    std::vector<std::pair<unsigned int, int>> output;
+    std::vector<unsigned short> query;
+
+    if (to_dense(word, query)) {
+        return output;
+    }
+
+    search(query, radius, [&](unsigned int match, int d) {
+        output.push_back(std::make_pair(match, d));
+        return radius;
+    });
+
+    std::sort(output.begin(), output.end(),
+        [](const std::pair<unsigned int, int>& a, const std::pair<unsigned int, int>& b) {
+            return a.second < b.second || (a.second == b.second && a.first < b.first);
+        });
+
+    return output;
+}
+
+std::vector<std::pair<unsigned int, int>> SimilarityIndex::nearest(const std::vector<unsigned int>& word, int k) const {
+    std::vector<std::pair<unsigned int, int>> output;
+    std::vector<unsigned short> query;
+
+    if (k <= 0 || to_dense(word, query)) {
+        return output;
+    }
+
+    // Max-heap on distance holding the k best matches so far
+    auto further = [](const std::pair<unsigned int, int>& a, const std::pair<unsigned int, int>& b) {
+        return a.second < b.second;
+    };
+    std::priority_queue<std::pair<unsigned int, int>, std::vector<std::pair<unsigned int, int>>,
+                        decltype(further)> best(further);
+
+    // Large enough to never prune before k matches are found
+    int unbounded = INT_MAX / 4;
+
+    search(query, unbounded, [&](unsigned int match, int d) {
+        best.push(std::make_pair(match, d));
+
+        if (static_cast<int>(best.size()) > k) {
+            best.pop();
+        }
+
+        return static_cast<int>(best.size()) < k ? unbounded : best.top().second;
+    });
+
+    while (!best.empty()) {
+        output.push_back(best.top());
+        best.pop();
+    }
+
+    std::reverse(output.begin(), output.end());
+    return output;
+}
+
+std::vector<unsigned int> SimilarityIndex::get_word(unsigned int index) const {
+    std::vector<unsigned int> output;
+
+    for (unsigned int i = offsets[index]; i < offsets[index + 1]; i++) {
+        output.push_back(inventory.get_id(words[i]));
+    }
+
+    return output;
+}
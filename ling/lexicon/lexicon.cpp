@@ -0,0 +1,525 @@
+#include "lexicon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+// Most buckets for the first radix pass, which uses two IDs if they fit
+#define MAX_BUCKETS (1 << 16)
+
+static void write_varint(std::string& output, uint32_t value) {
+    while (value >= 0x80) {
+        output += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    output += static_cast<char>(value);
+}
+
+/*
+ * Decode a varint of at most 5 bytes that ends before end
+ *
+ * Returns true if it runs past end or is longer than 5 bytes
+ * Returns false otherwise
+ */
+static bool read_varint(const uint8_t*& position, const uint8_t* end, uint32_t& value) {
+    value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (position >= end) {
+            return true;
+        }
+
+        uint8_t byte = *position++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Compares the first word of a block to a word without decoding it into a buffer
+ *
+ * Returns true if the block is corrupt
+ * Returns false otherwise
+ */
+static bool compare_first(const uint8_t* position, const uint8_t* end, const unsigned int* word, int len, int& order) {
+    uint32_t shared, first_len;
+
+    // The first word shares nothing
+    if (read_varint(position, end, shared) || shared != 0 || read_varint(position, end, first_len)) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < first_len && i < static_cast<uint32_t>(len); i++) {
+        uint32_t id;
+
+        if (read_varint(position, end, id)) {
+            return true;
+        }
+
+        if (id != word[i]) {
+            order = id < word[i] ? -1 : 1;
+            return false;
+        }
+    }
+
+    order = first_len < static_cast<uint32_t>(len) ? -1 : (first_len > static_cast<uint32_t>(len) ? 1 : 0);
+    return false;
+}
+
+Lexicon::Cursor::Cursor(const Lexicon* lexicon, long begin, long end)
+    : lexicon(lexicon), end(std::min(end, lexicon->get_word_count())), position(nullptr), limit(nullptr), corrupt(false) {
+
+    begin = std::max(0L, std::min(begin, this->end));
+
+    // Front coding restarts at every block, so decode from the start of the block
+    ordinal = begin / LEXICON_BLOCK * LEXICON_BLOCK;
+
+    while (ordinal < begin && next()) {}
+}
+
+bool Lexicon::Cursor::next() {
+    if (ordinal >= end) {
+        return false;
+    }
+
+    if (ordinal % LEXICON_BLOCK == 0) {
+        long block = ordinal / LEXICON_BLOCK;
+        position = lexicon->block_start(block);
+        limit = lexicon->block_end(block);
+        word.clear();
+    }
+
+    // Every ID takes at least a byte, so a longer suffix cannot be in the block
+    uint32_t shared, suffix;
+
+    if (read_varint(position, limit, shared) || read_varint(position, limit, suffix)
+        || shared > word.size() || suffix > static_cast<size_t>(limit - position)) {
+
+        corrupt = true;
+        ordinal = end;
+        return false;
+    }
+
+    word.resize(shared);
+
+    for (uint32_t i = 0; i < suffix; i++) {
+        uint32_t id;
+
+        if (read_varint(position, limit, id)) {
+            corrupt = true;
+            ordinal = end;
+            return false;
+        }
+
+        word.push_back(id);
+    }
+
+    ordinal++;
+    return true;
+}
+
+/* Returns true if size bytes from offset are inside a file of file_size bytes, without overflowing */
+static bool in_file(uint64_t offset, uint64_t size, uint64_t file_size) {
+    return offset <= file_size && size <= file_size - offset;
+}
+
+bool Lexicon::open(std::string path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return true;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return true;
+    }
+
+    void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (address == MAP_FAILED) {
+        return true;
+    }
+
+    map = static_cast<const uint8_t*>(address);
+    map_size = info.st_size;
+    memcpy(&header, map, sizeof(Header));
+
+    // Every section must lie inside the file, aligned for its type. The
+    // writer never stores more than 32 bit many words, so the sizes below
+    // cannot overflow.
+    if (header.magic != LEXICON_MAGIC || header.version != LEXICON_VERSION
+        || header.block_size != LEXICON_BLOCK || header.word_count > UINT32_MAX
+        || header.block_count != (header.word_count + LEXICON_BLOCK - 1) / LEXICON_BLOCK
+        || !in_file(header.index_offset, header.block_count * sizeof(uint64_t), map_size)
+        || header.index_offset % alignof(uint64_t) != 0
+        || (header.has_payloads && (!in_file(header.payload_offset, header.word_count * sizeof(uint32_t), map_size)
+                                    || header.payload_offset % alignof(uint32_t) != 0))
+        || !in_file(header.data_offset, header.data_size, map_size)) {
+
+        close();
+        return true;
+    }
+
+    index = reinterpret_cast<const uint64_t*>(map + header.index_offset);
+    payloads = header.has_payloads ? reinterpret_cast<const uint32_t*>(map + header.payload_offset) : nullptr;
+    data = map + header.data_offset;
+
+    // Blocks are in order, so each one ends where the next starts
+    for (uint64_t b = 0; b < header.block_count; b++) {
+        if (index[b] >= header.data_size || (b > 0 && index[b] < index[b - 1])) {
+            close();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Lexicon::close() {
+    if (map != nullptr) {
+        munmap(const_cast<uint8_t*>(map), map_size);
+    }
+
+    map = nullptr;
+    map_size = 0;
+    index = nullptr;
+    payloads = nullptr;
+    data = nullptr;
+}
+
+long Lexicon::lower_bound(const unsigned int* word, int len) const {
+    long count = get_word_count();
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // Last block whose first word is not greater than the word
+    long low = 0, high = header.block_count;
+
+    // A corrupt block sorts after every word, its words are never found
+    while (low < high) {
+        long mid = (low + high) / 2;
+        int order;
+
+        if (!compare_first(block_start(mid), block_end(mid), word, len, order) && order <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low == 0) {
+        return 0;
+    }
+
+    long block = low - 1;
+    Cursor cursor(this, block * LEXICON_BLOCK, (block + 1) * LEXICON_BLOCK);
+
+    while (cursor.next()) {
+        const std::vector<unsigned int>& current = cursor.get_word();
+
+        if (!std::lexicographical_compare(current.begin(), current.end(), word, word + len)) {
+            return cursor.get_ordinal();
+        }
+    }
+
+    return std::min(count, (block + 1) * LEXICON_BLOCK);
+}
+
+long Lexicon::find(const unsigned int* word, int len) const {
+    long ordinal = lower_bound(word, len);
+
+    if (ordinal >= get_word_count()) {
+        return -1;
+    }
+
+    Cursor cursor = iterate(ordinal, ordinal + 1);
+
+    // A corrupt block leaves no word, which would match an empty one
+    if (!cursor.next()) {
+        return -1;
+    }
+
+    const std::vector<unsigned int>& found = cursor.get_word();
+
+    if (found.size() == static_cast<size_t>(len) && std::equal(found.begin(), found.end(), word)) {
+        return ordinal;
+    }
+
+    return -1;
+}
+
+std::pair<long, long> Lexicon::prefix_range(const unsigned int* prefix, int len) const {
+    long first = lower_bound(prefix, len);
+
+    // The first word after the prefix's range starts with the prefix incremented
+    std::vector<unsigned int> next(prefix, prefix + len);
+
+    while (!next.empty() && next.back() == UINT_MAX) {
+        next.pop_back();
+    }
+
+    if (next.empty()) {
+        return std::make_pair(first, get_word_count());
+    }
+
+    next.back()++;
+
+    return std::make_pair(first, lower_bound(next.data(), next.size()));
+}
+
+/* Order of the words in a list, sorted and without duplicates */
+static std::vector<unsigned int> sort_words(const WordList& words, int threads) {
+    size_t n = words.size();
+    const std::vector<unsigned int>& ids = words.get_ids();
+
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    // Dense ranks keep the order of the IDs, 0 marks the end of a word
+    std::vector<std::unordered_set<unsigned int>> distinct(threads);
+
+    int batches = parallel_batches(ids.size(), threads, [&](size_t begin, size_t end, int batch) {
+        for (size_t i = begin; i < end; i++) {
+            distinct[batch].insert(ids[i]);
+        }
+    });
+
+    std::vector<unsigned int> alphabet;
+
+    for (int b = 0; b < batches; b++) {
+        alphabet.insert(alphabet.end(), distinct[b].begin(), distinct[b].end());
+    }
+
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+
+    std::unordered_map<unsigned int, unsigned int> ranks;
+
+    for (size_t i = 0; i < alphabet.size(); i++) {
+        ranks[alphabet[i]] = i + 1;
+    }
+
+    // Radix pass over the first one or two IDs
+    size_t radix = alphabet.size() + 1;
+    int depth = radix * radix <= MAX_BUCKETS ? 2 : 1;
+    size_t num_buckets = depth == 2 ? radix * radix : radix;
+
+    std::vector<unsigned int> keys(n);
+    std::vector<std::vector<size_t>> counts(threads, std::vector<size_t>(num_buckets, 0));
+
+    batches = parallel_batches(n, threads, [&](size_t begin, size_t end, int batch) {
+        for (size_t w = begin; w < end; w++) {
+            const unsigned int* word = words.get(w);
+            int len = words.length(w);
+            unsigned int key = len > 0 ? ranks.find(word[0])->second : 0;
+
+            if (depth == 2) {
+                key = key * radix + (len > 1 ? ranks.find(word[1])->second : 0);
+            }
+
+            keys[w] = key;
+            counts[batch][key]++;
+        }
+    });
+
+    // Each batch scatters into its own slice of every bucket, keeping the order stable
+    std::vector<size_t> bucket_starts(num_buckets + 1, 0);
+    size_t total = 0;
+
+    for (size_t k = 0; k < num_buckets; k++) {
+        bucket_starts[k] = total;
+
+        for (int b = 0; b < batches; b++) {
+            size_t count = counts[b][k];
+            counts[b][k] = total;
+            total += count;
+        }
+    }
+
+    bucket_starts[num_buckets] = total;
+
+    std::vector<unsigned int> order(n);
+
+    parallel_batches(n, batches, [&](size_t begin, size_t end, int batch) {
+        std::vector<size_t>& next = counts[batch];
+
+        for (size_t w = begin; w < end; w++) {
+            order[next[keys[w]]++] = w;
+        }
+    });
+
+    // Buckets are sorted independently, each thread taking the next unsorted bucket
+    std::atomic<size_t> next_bucket(0);
+
+    parallel_batches(num_buckets, threads, [&](size_t, size_t, int) {
+        size_t k;
+
+        while ((k = next_bucket++) < num_buckets) {
+            if (bucket_starts[k + 1] - bucket_starts[k] < 2) {
+                continue;
+            }
+
+            // Words in a bucket share their first IDs. Ties keep the first occurrence first.
+            std::sort(order.begin() + bucket_starts[k], order.begin() + bucket_starts[k + 1],
+                [&](unsigned int a, unsigned int b) {
+                    const unsigned int* word_a = words.get(a);
+                    const unsigned int* word_b = words.get(b);
+                    int len_a = words.length(a), len_b = words.length(b);
+                    int start = std::min(depth, std::min(len_a, len_b));
+
+                    if (std::lexicographical_compare(word_a + start, word_a + len_a, word_b + start, word_b + len_b)) {
+                        return true;
+                    }
+
+                    if (std::lexicographical_compare(word_b + start, word_b + len_b, word_a + start, word_a + len_a)) {
+                        return false;
+                    }
+
+                    return a < b;
+                });
+        }
+    });
+
+    // Remove duplicates, which are now next to each other
+    size_t kept = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (kept > 0) {
+            unsigned int prev = order[kept - 1];
+            int len = words.length(order[i]);
+
+            if (len == words.length(prev) && std::equal(words.get(order[i]), words.get(order[i]) + len, words.get(prev))) {
+                continue;
+            }
+        }
+
+        order[kept++] = order[i];
+    }
+
+    order.resize(kept);
+    return order;
+}
+
+bool write_lexicon(std::string path, const WordList& words,
+                   const std::vector<uint32_t>* payloads, int threads) {
+
+    // Words are sorted by 32 bit indices, and each needs its payload
+    if (words.size() > UINT_MAX || (payloads != nullptr && payloads->size() < words.size())) {
+        return true;
+    }
+
+    std::vector<unsigned int> order = sort_words(words, threads);
+    uint64_t num_blocks = (order.size() + LEXICON_BLOCK - 1) / LEXICON_BLOCK;
+
+    // Blocks are independent, so they are encoded in parallel and joined in order
+    std::vector<std::string> encoded(threads > 0 ? threads : default_threads());
+    std::vector<std::vector<uint64_t>> block_sizes(encoded.size());
+
+    int batches = parallel_batches(num_blocks, encoded.size(), [&](size_t begin, size_t end, int batch) {
+        std::string& output = encoded[batch];
+
+        for (size_t block = begin; block < end; block++) {
+            size_t start = output.size();
+            size_t last = std::min<size_t>(order.size(), (block + 1) * LEXICON_BLOCK);
+
+            for (size_t i = block * LEXICON_BLOCK; i < last; i++) {
+                const unsigned int* word = words.get(order[i]);
+                int len = words.length(order[i]);
+                int shared = 0;
+
+                if (i % LEXICON_BLOCK != 0) {
+                    const unsigned int* prev = words.get(order[i - 1]);
+                    int prev_len = words.length(order[i - 1]);
+
+                    while (shared < len && shared < prev_len && word[shared] == prev[shared]) {
+                        shared++;
+                    }
+                }
+
+                write_varint(output, shared);
+                write_varint(output, len - shared);
+
+                for (int j = shared; j < len; j++) {
+                    write_varint(output, word[j]);
+                }
+            }
+
+            block_sizes[batch].push_back(output.size() - start);
+        }
+    });
+
+    std::vector<uint64_t> index;
+    uint64_t data_size = 0;
+
+    for (int b = 0; b < batches; b++) {
+        for (auto const& size: block_sizes[b]) {
+            index.push_back(data_size);
+            data_size += size;
+        }
+    }
+
+    Lexicon::Header header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic = LEXICON_MAGIC;
+    header.version = LEXICON_VERSION;
+    header.block_size = LEXICON_BLOCK;
+    header.has_payloads = payloads != nullptr;
+    header.word_count = order.size();
+    header.block_count = num_blocks;
+    header.index_offset = sizeof(header);
+    header.payload_offset = header.index_offset + num_blocks * sizeof(uint64_t);
+    header.data_offset = header.payload_offset + (payloads != nullptr ? order.size() * sizeof(uint32_t) : 0);
+    header.data_size = data_size;
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+
+    if (payloads != nullptr) {
+        std::vector<uint32_t> sorted_payloads(order.size());
+
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted_payloads[i] = (*payloads)[order[i]];
+        }
+
+        file.write(reinterpret_cast<const char*>(sorted_payloads.data()), sorted_payloads.size() * sizeof(uint32_t));
+    }
+
+    for (int b = 0; b < batches; b++) {
+        file.write(encoded[b].data(), encoded[b].size());
+    }
+
+    return !file;
+}
@@ -0,0 +1,176 @@
+#include "minimalpairs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "parallel.h"
+
+namespace {
+
+struct Entry {
+    uint64_t key;
+    unsigned int word;
+    unsigned int position;
+
+    bool operator<(const Entry& entry) const {
+        return key < entry.key || (key == entry.key
+            && (position < entry.position || (position == entry.position && word < entry.word)));
+    }
+};
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Hash of a phoneme at a position, summed over a word
+uint64_t segment_hash(unsigned int id, int position) {
+    return mix((static_cast<uint64_t>(id) << 16) ^ position);
+}
+
+// Distinguishes the wildcard position and the length of the word
+uint64_t wildcard_hash(int position, int len) {
+    return mix(0x9e3779b97f4a7c15ULL ^ (static_cast<uint64_t>(len) << 32) ^ position);
+}
+
+}
+
+bool MinimalPairs::find(const WordList& words, bool keep_pairs, int threads) {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    int size = inventory.size();
+    int num_shards = threads * 4;
+    std::atomic<bool> failed(false);
+
+    contrasts.clear();
+    pairs.clear();
+
+    // Hash every word once per position, split into shards by hash
+    std::vector<std::vector<std::vector<Entry>>> entries(threads, std::vector<std::vector<Entry>>(num_shards));
+
+    int batches = parallel_batches(words.size(), threads, [&](size_t begin, size_t end, int batch) {
+        std::vector<std::vector<Entry>>& shards = entries[batch];
+
+        for (size_t w = begin; w < end; w++) {
+            const unsigned int* word = words.get(w);
+            int len = words.length(w);
+            uint64_t total = 0;
+
+            for (int i = 0; i < len; i++) {
+                if (!inventory.contains(word[i])) {
+                    failed = true;
+                    return;
+                }
+
+                total += segment_hash(word[i], i);
+            }
+
+            for (int i = 0; i < len; i++) {
+                uint64_t key = total - segment_hash(word[i], i) + wildcard_hash(i, len);
+                Entry entry = {key, static_cast<unsigned int>(w), static_cast<unsigned int>(i)};
+
+                shards[key % num_shards].push_back(entry);
+            }
+        }
+    });
+
+    if (failed) {
+        return true;
+    }
+
+    // Group each shard by sorting, and count contrasts per thread
+    std::vector<std::vector<unsigned long>> counts(threads);
+    std::vector<std::vector<Pair>> shard_pairs(threads);
+
+    int workers = parallel_batches(num_shards, threads, [&](size_t begin, size_t end, int batch) {
+        std::vector<unsigned long>& local = counts[batch];
+        std::vector<Entry> shard;
+
+        local.assign(size * size, 0);
+
+        for (size_t s = begin; s < end; s++) {
+            shard.clear();
+
+            for (int b = 0; b < batches; b++) {
+                shard.insert(shard.end(), entries[b][s].begin(), entries[b][s].end());
+                std::vector<Entry>().swap(entries[b][s]);
+            }
+
+            std::sort(shard.begin(), shard.end());
+
+            size_t len = shard.size();
+
+            for (size_t first = 0; first < len;) {
+                size_t last = first + 1;
+
+                while (last < len && shard[last].key == shard[first].key
+                       && shard[last].position == shard[first].position) {
+                    last++;
+                }
+
+                for (size_t a = first; a < last; a++) {
+                    for (size_t b = a + 1; b < last; b++) {
+                        unsigned int wa = shard[a].word, wb = shard[b].word;
+                        unsigned int position = shard[a].position;
+                        int word_len = words.length(wa);
+
+                        const unsigned int* word_a = words.get(wa);
+                        const unsigned int* word_b = words.get(wb);
+
+                        // Rule out hash collisions and duplicate words
+                        if (word_len != words.length(wb) || word_a[position] == word_b[position]
+                            || !std::equal(word_a, word_a + position, word_b)
+                            || !std::equal(word_a + position + 1, word_a + word_len, word_b + position + 1)) {
+                            continue;
+                        }
+
+                        int x = inventory.index_of(word_a[position]);
+                        int y = inventory.index_of(word_b[position]);
+
+                        local[std::min(x, y) * size + std::max(x, y)]++;
+
+                        if (keep_pairs) {
+                            Pair pair = {wa, wb, position};
+                            shard_pairs[batch].push_back(pair);
+                        }
+                    }
+                }
+
+                first = last;
+            }
+        }
+    });
+
+    // Merge per thread tables
+    for (int x = 0; x < size; x++) {
+        for (int y = x + 1; y < size; y++) {
+            unsigned long total = 0;
+
+            for (int t = 0; t < workers; t++) {
+                total += counts[t][x * size + y];
+            }
+
+            if (total > 0) {
+                Contrast contrast = {inventory.get_id(x), inventory.get_id(y), total};
+                contrasts.push_back(contrast);
+            }
+        }
+    }
+
+    std::stable_sort(contrasts.begin(), contrasts.end(), [](const Contrast& a, const Contrast& b) {
+        return a.count > b.count;
+    });
+
+    for (int t = 0; t < workers; t++) {
+        pairs.insert(pairs.end(), shard_pairs[t].begin(), shard_pairs[t].end());
+    }
+
+    return false;
+}
@@ -0,0 +1,358 @@
+#include "ngram.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <utility>
+
+#include "parallel.h"
+
+#define EMPTY_KEY (~static_cast<uint64_t>(0))
+#define MODEL_MAGIC 0x4d474e4c     // "LNGM"
+#define MODEL_VERSION 1
+#define MODEL_MAX_PHONEMES 1024    // Bigram tables grow with its square, trigram keys with its cube
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+NgramModel::NgramModel(const Inventory& inventory, float discount) {
+    ids = inventory.get_ids();
+    this->discount = discount;
+    reset_counts();
+    finalize();
+}
+
+void NgramModel::reset_counts() {
+    vocab = ids.size() + 1;
+    unigrams.assign(vocab, 0);
+    bigrams.assign(vocab * vocab, 0);
+    contexts.assign(vocab * vocab, 0);
+    trigram_keys.assign(1024, EMPTY_KEY);
+    trigram_counts.assign(1024, 0);
+    trigram_size = 0;
+    tokens = 0;
+}
+
+int NgramModel::index_of(unsigned int id) const {
+    auto it = std::lower_bound(ids.begin(), ids.end(), id);
+
+    // Unknown phonemes are treated as the word boundary
+    if (it == ids.end() || *it != id) {
+        return vocab - 1;
+    }
+
+    return it - ids.begin();
+}
+
+size_t NgramModel::find_slot(uint64_t key) const {
+    size_t mask = trigram_keys.size() - 1;
+    size_t slot = mix(key) & mask;
+
+    while (trigram_keys[slot] != key && trigram_keys[slot] != EMPTY_KEY) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+void NgramModel::add_trigram(uint64_t key, uint32_t count) {
+    // Keep the table at most half full
+    if ((trigram_size + 1) * 2 > trigram_keys.size()) {
+        std::vector<uint64_t> old_keys(trigram_keys.size() * 2, EMPTY_KEY);
+        std::vector<uint32_t> old_counts(trigram_counts.size() * 2, 0);
+
+        old_keys.swap(trigram_keys);
+        old_counts.swap(trigram_counts);
+
+        for (size_t i = 0; i < old_keys.size(); i++) {
+            if (old_keys[i] != EMPTY_KEY) {
+                size_t slot = find_slot(old_keys[i]);
+                trigram_keys[slot] = old_keys[i];
+                trigram_counts[slot] = old_counts[i];
+            }
+        }
+    }
+
+    size_t slot = find_slot(key);
+
+    if (trigram_keys[slot] == EMPTY_KEY) {
+        trigram_keys[slot] = key;
+        trigram_size++;
+    }
+
+    trigram_counts[slot] += count;
+}
+
+uint32_t NgramModel::get_trigram(uint64_t key) const {
+    size_t slot = find_slot(key);
+    return trigram_keys[slot] == key ? trigram_counts[slot] : 0;
+}
+
+void NgramModel::count_word(const unsigned int* word, int len) {
+    int boundary = vocab - 1;
+    int a = boundary, b = boundary;
+
+    for (int i = 0; i <= len; i++) {
+        int c = i < len ? index_of(word[i]) : boundary;
+        uint64_t key = (static_cast<uint64_t>(a) * vocab + b) * vocab + c;
+
+        unigrams[c]++;
+        bigrams[b * vocab + c]++;
+        contexts[a * vocab + b]++;
+        add_trigram(key, 1);
+        tokens++;
+
+        a = b;
+        b = c;
+    }
+}
+
+void NgramModel::count(const unsigned int* begin, const unsigned int* end) {
+    const unsigned int* word = begin;
+
+    for (const unsigned int* it = begin; it != end; it++) {
+        if (*it == WORD_BOUNDARY) {
+            count_word(word, it - word);
+            word = it + 1;
+        }
+    }
+}
+
+void NgramModel::merge(const NgramModel& model) {
+    for (int i = 0; i < vocab; i++) {
+        unigrams[i] += model.unigrams[i];
+    }
+
+    for (int i = 0; i < vocab * vocab; i++) {
+        bigrams[i] += model.bigrams[i];
+        contexts[i] += model.contexts[i];
+    }
+
+    for (size_t i = 0; i < model.trigram_keys.size(); i++) {
+        if (model.trigram_keys[i] != EMPTY_KEY) {
+            add_trigram(model.trigram_keys[i], model.trigram_counts[i]);
+        }
+    }
+
+    tokens += model.tokens;
+}
+
+void NgramModel::finalize() {
+    std::vector<double> unigram_probs(vocab);
+    std::vector<uint32_t> distinct(vocab * vocab, 0);
+
+    for (int c = 0; c < vocab; c++) {
+        unigram_probs[c] = (unigrams[c] + 1.0) / (tokens + vocab);
+    }
+
+    bigram_probs.assign(vocab * vocab, 0.0f);
+
+    for (int b = 0; b < vocab; b++) {
+        double total = 0;
+        int types = 0;
+
+        for (int c = 0; c < vocab; c++) {
+            total += bigrams[b * vocab + c];
+            types += bigrams[b * vocab + c] > 0;
+        }
+
+        for (int c = 0; c < vocab; c++) {
+            double prob = unigram_probs[c];
+
+            if (total > 0) {
+                prob = std::max(bigrams[b * vocab + c] - discount, 0.0f) / total
+                     + discount * types / total * unigram_probs[c];
+            }
+
+            bigram_probs[b * vocab + c] = prob;
+        }
+    }
+
+    // Number of distinct phonemes seen after each context
+    for (size_t i = 0; i < trigram_keys.size(); i++) {
+        if (trigram_keys[i] != EMPTY_KEY) {
+            distinct[trigram_keys[i] / vocab]++;
+        }
+    }
+
+    inv_contexts.assign(vocab * vocab, 0.0f);
+    backoff.assign(vocab * vocab, 1.0f);
+
+    for (int i = 0; i < vocab * vocab; i++) {
+        if (contexts[i] > 0) {
+            inv_contexts[i] = 1.0f / contexts[i];
+            backoff[i] = discount * distinct[i] / contexts[i];
+        }
+    }
+}
+
+float NgramModel::log_prob(int a, int b, int c) const {
+    int context = a * vocab + b;
+    float prob = backoff[context] * bigram_probs[b * vocab + c];
+
+    if (contexts[context] > 0) {
+        uint32_t count = get_trigram(static_cast<uint64_t>(context) * vocab + c);
+        prob += std::max(count - discount, 0.0f) * inv_contexts[context];
+    }
+
+    return std::log(prob);
+}
+
+void NgramModel::train(CorpusReader& reader, size_t chunk_size, int threads) {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    std::vector<NgramModel> partials(threads);
+    std::vector<unsigned int> chunk;
+
+    for (auto& partial: partials) {
+        partial.ids = ids;
+        partial.reset_counts();
+    }
+
+    while (reader.next(chunk, chunk_size)) {
+        parallel_words(chunk, threads, [&](const unsigned int* begin, const unsigned int* end, int batch) {
+            partials[batch].count(begin, end);
+        });
+    }
+
+    for (auto const& partial: partials) {
+        merge(partial);
+    }
+
+    finalize();
+}
+
+void NgramModel::train(const WordList& words) {
+    for (unsigned int w = 0; w < words.size(); w++) {
+        count_word(words.get(w), words.length(w));
+    }
+
+    finalize();
+}
+
+double NgramModel::score(const unsigned int* word, int len) const {
+    int boundary = vocab - 1;
+    int a = boundary, b = boundary;
+    double total = 0;
+
+    for (int i = 0; i < len; i++) {
+        int c = index_of(word[i]);
+
+        total += log_prob(a, b, c);
+        a = b;
+        b = c;
+    }
+
+    return total + log_prob(a, b, boundary);
+}
+
+void NgramModel::score_all(const WordList& words, std::vector<float>& scores, int threads) const {
+    scores.resize(words.size());
+
+    parallel_batches(words.size(), threads, [&](size_t begin, size_t end, int) {
+        for (size_t w = begin; w < end; w++) {
+            scores[w] = average(words.get(w), words.length(w));
+        }
+    });
+}
+
+bool NgramModel::save(std::string path) const {
+    LING_TIME(write_output);
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    uint32_t header[3] = {MODEL_MAGIC, MODEL_VERSION, static_cast<uint32_t>(ids.size())};
+    uint64_t counts[2] = {tokens, trigram_size};
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(unsigned int));
+    file.write(reinterpret_cast<const char*>(&discount), sizeof(discount));
+    file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+    file.write(reinterpret_cast<const char*>(unigrams.data()), unigrams.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(bigrams.data()), bigrams.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(contexts.data()), contexts.size() * sizeof(uint32_t));
+
+    for (size_t i = 0; i < trigram_keys.size(); i++) {
+        if (trigram_keys[i] != EMPTY_KEY) {
+            file.write(reinterpret_cast<const char*>(&trigram_keys[i]), sizeof(uint64_t));
+            file.write(reinterpret_cast<const char*>(&trigram_counts[i]), sizeof(uint32_t));
+        }
+    }
+
+    LING_COUNT(bytes_written, metrics::stream_bytes(file));
+
+    return !file;
+}
+
+bool NgramModel::load(std::string path) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    uint32_t header[3];
+    uint64_t counts[2];
+
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))
+        || header[0] != MODEL_MAGIC || header[1] != MODEL_VERSION || header[2] > MODEL_MAX_PHONEMES) {
+        return true;
+    }
+
+    // Read into a new model, so a file that turns out to be broken leaves this one as it was
+    NgramModel model;
+    model.ids.resize(header[2]);
+
+    if (!file.read(reinterpret_cast<char*>(model.ids.data()), model.ids.size() * sizeof(unsigned int))
+        || !file.read(reinterpret_cast<char*>(&model.discount), sizeof(model.discount))
+        || !file.read(reinterpret_cast<char*>(counts), sizeof(counts))) {
+        return true;
+    }
+
+    // index_of() searches the IDs
+    for (size_t i = 1; i < model.ids.size(); i++) {
+        if (model.ids[i - 1] >= model.ids[i]) {
+            return true;
+        }
+    }
+
+    model.reset_counts();
+
+    uint64_t keys = static_cast<uint64_t>(model.vocab) * model.vocab * model.vocab;
+
+    if (counts[1] > keys
+        || !file.read(reinterpret_cast<char*>(model.unigrams.data()), model.unigrams.size() * sizeof(uint32_t))
+        || !file.read(reinterpret_cast<char*>(model.bigrams.data()), model.bigrams.size() * sizeof(uint32_t))
+        || !file.read(reinterpret_cast<char*>(model.contexts.data()), model.contexts.size() * sizeof(uint32_t))) {
+        return true;
+    }
+
+    model.tokens = counts[0];
+
+    for (uint64_t i = 0; i < counts[1]; i++) {
+        uint64_t key;
+        uint32_t count;
+
+        if (!file.read(reinterpret_cast<char*>(&key), sizeof(key))
+            || !file.read(reinterpret_cast<char*>(&count), sizeof(count)) || key >= keys) {
+            return true;
+        }
+
+        model.add_trigram(key, count);
+    }
+
+    model.finalize();
+    *this = std::move(model);
+    return false;
+}
@@ -0,0 +1,231 @@
+#include "statistics.h"
+#include "metrics.h"
+
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static const char* part_names[3] = {"onset", "nucleus", "coda"};
+
+Statistics::Statistics(const Inventory& inventory, const std::vector<unsigned int>& classes,
+                       const Phonotactics* phonotactics)
+    : inventory(inventory), phonotactics(phonotactics), classes(classes) {
+
+    reset(totals);
+}
+
+void Statistics::reset(Tables& tables) const {
+    int size = inventory.size();
+
+    tables.words = 0;
+    tables.unknown = 0;
+    tables.unigrams.assign(size, 0);
+    tables.bigrams.assign((size + 1) * (size + 1), 0);
+
+    for (auto& part: tables.constituents) {
+        part.clear();
+    }
+}
+
+void Statistics::count_words(const unsigned int* begin, const unsigned int* end, Tables& tables) const {
+    int size = inventory.size();
+    int stride = size + 1;
+    int prev = size;                    // Start of a word
+    const unsigned int* word = begin;
+    std::vector<Syllable> syllables;
+
+    for (const unsigned int* it = begin; it != end; it++) {
+        if (*it == WORD_BOUNDARY) {
+            tables.bigrams[prev * stride + size]++;
+            tables.words++;
+
+            if (phonotactics != nullptr) {
+                phonotactics->syllabify(word, it - word, syllables);
+
+                const unsigned int* pos = word;
+
+                for (auto const& syllable: syllables) {
+                    int lengths[3] = {syllable.onset, syllable.nucleus, syllable.coda};
+
+                    for (int part = 0; part < 3; part++) {
+                        if (lengths[part] > 0) {
+                            tables.constituents[part][std::string(reinterpret_cast<const char*>(pos),
+                                                                  lengths[part] * sizeof(unsigned int))]++;
+                        }
+
+                        pos += lengths[part];
+                    }
+                }
+            }
+
+            prev = size;
+            word = it + 1;
+            continue;
+        }
+
+        int index = inventory.index_of(*it);
+
+        if (index < 0) {
+            tables.unknown++;
+            continue;
+        }
+
+        tables.unigrams[index]++;
+        tables.bigrams[prev * stride + index]++;
+        prev = index;
+    }
+}
+
+void Statistics::merge(const Tables& tables) {
+    totals.words += tables.words;
+    totals.unknown += tables.unknown;
+
+    for (size_t i = 0; i < tables.unigrams.size(); i++) {
+        totals.unigrams[i] += tables.unigrams[i];
+    }
+
+    for (size_t i = 0; i < tables.bigrams.size(); i++) {
+        totals.bigrams[i] += tables.bigrams[i];
+    }
+
+    for (int part = 0; part < 3; part++) {
+        for (auto const& entry: tables.constituents[part]) {
+            totals.constituents[part][entry.first] += entry.second;
+        }
+    }
+}
+
+void Statistics::count(CorpusReader& reader, size_t chunk_size, int threads) {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    std::vector<Tables> tables(threads);
+    std::vector<unsigned int> chunk;
+
+    for (auto& table: tables) {
+        reset(table);
+    }
+
+    while (reader.next(chunk, chunk_size)) {
+        parallel_words(chunk, threads, [&](const unsigned int* begin, const unsigned int* end, int batch) {
+            count_words(begin, end, tables[batch]);
+        });
+    }
+
+    for (auto const& table: tables) {
+        merge(table);
+    }
+}
+
+unsigned long Statistics::get_count(unsigned int id) const {
+    int index = inventory.index_of(id);
+    return index < 0 ? 0 : totals.unigrams[index];
+}
+
+unsigned long Statistics::get_count(unsigned int first, unsigned int second) const {
+    int size = inventory.size();
+    int a = first == WORD_BOUNDARY ? size : inventory.index_of(first);
+    int b = second == WORD_BOUNDARY ? size : inventory.index_of(second);
+
+    return a < 0 || b < 0 ? 0 : totals.bigrams[a * (size + 1) + b];
+}
+
+unsigned long Statistics::get_class_count(unsigned int phon_class) const {
+    unsigned long total = 0;
+
+    // Every segment was counted once in the unigrams
+    for (int i = 0; i < inventory.size(); i++) {
+        if (in_class(inventory.get_id(i), phon_class)) {
+            total += totals.unigrams[i];
+        }
+    }
+
+    return total;
+}
+
+std::string Statistics::render_key(const std::string& key) const {
+    const unsigned int* ids = reinterpret_cast<const unsigned int*>(key.data());
+    return inventory.render(std::vector<unsigned int>(ids, ids + key.size() / sizeof(unsigned int)));
+}
+
+void Statistics::write_csv(std::ostream& output) const {
+    LING_TIME(write_output);
+
+    int size = inventory.size();
+
+    output << "statistic,sequence,count\n"
+           << "words,," << totals.words << "\n"
+           << "unknown,," << totals.unknown << "\n";
+
+    for (int i = 0; i < size; i++) {
+        output << "phoneme," << inventory.get_symbol(i) << "," << totals.unigrams[i] << "\n";
+    }
+
+    // The word boundary is written as #
+    for (int a = 0; a <= size; a++) {
+        for (int b = 0; b <= size; b++) {
+            unsigned long count = totals.bigrams[a * (size + 1) + b];
+
+            if (count > 0) {
+                output << "bigram," << (a == size ? "#" : inventory.get_symbol(a)) << " "
+                       << (b == size ? "#" : inventory.get_symbol(b)) << "," << count << "\n";
+            }
+        }
+    }
+
+    for (auto const& phon_class: classes) {
+        output << "class," << std::hex << phon_class << std::dec << "," << get_class_count(phon_class) << "\n";
+    }
+
+    for (int part = 0; part < 3; part++) {
+        for (auto const& entry: totals.constituents[part]) {
+            output << part_names[part] << "," << render_key(entry.first) << "," << entry.second << "\n";
+        }
+    }
+}
+
+void Statistics::write_json(std::ostream& output) const {
+    LING_TIME(write_output);
+
+    int size = inventory.size();
+    json data;
+
+    data["words"] = totals.words;
+    data["unknown"] = totals.unknown;
+    data["phonemes"] = json::object();
+    data["bigrams"] = json::object();
+    data["classes"] = json::object();
+
+    for (int i = 0; i < size; i++) {
+        data["phonemes"][inventory.get_symbol(i)] = totals.unigrams[i];
+    }
+
+    for (int a = 0; a <= size; a++) {
+        for (int b = 0; b <= size; b++) {
+            unsigned long count = totals.bigrams[a * (size + 1) + b];
+
+            if (count > 0) {
+                data["bigrams"][(a == size ? "#" : inventory.get_symbol(a)) + " "
+                                + (b == size ? "#" : inventory.get_symbol(b))] = count;
+            }
+        }
+    }
+
+    for (auto const& phon_class: classes) {
+        char key[16];
+        snprintf(key, sizeof(key), "%x", phon_class);
+        data["classes"][key] = get_class_count(phon_class);
+    }
+
+    for (int part = 0; part < 3; part++) {
+        data[part_names[part]] = json::object();
+
+        for (auto const& entry: totals.constituents[part]) {
+            data[part_names[part]][render_key(entry.first)] = entry.second;
+        }
+    }
+
+    output << data.dump(4) << "\n";
+}
@@ -0,0 +1,210 @@
+#include "derivation.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+
+Derivation::Derivation(SoundSystem& sound_system, const std::vector<Rule>& rules)
+    : sound_system(sound_system), inventory(sound_system), rules(rules) {
+
+    offsets.push_back(0);
+    stages.resize(rules.size() + 1);
+    occurrences.resize(rules.size());
+    blocked.resize(rules.size());
+    epoch = 0;
+}
+
+unsigned int Derivation::add_word(const std::vector<unsigned int>& word) {
+    unsigned int index = offsets.size() - 1;
+
+    for (auto& stage: stages) {
+        stage.insert(stage.end(), word.begin(), word.end());
+    }
+
+    offsets.push_back(offsets.back() + word.size());
+    marks.push_back(0);
+
+    int len = rules.size();
+    for (int r = 0; r < len; r++) {
+        index_word(r, index);
+        derive_word(r, index);
+    }
+
+    return index;
+}
+
+void Derivation::index_word(int rule, unsigned int word) {
+    const unsigned int* form = stages[rule].data() + offsets[word];
+    int len = offsets[word + 1] - offsets[word];
+
+    for (int i = 0; i < len; i++) {
+        // Only record the first occurrence of a phoneme in the word
+        if (std::find(form, form + i, form[i]) != form + i) {
+            continue;
+        }
+
+        std::vector<unsigned int>& words = occurrences[rule][form[i]];
+
+        if (words.empty() || words.back() != word) {
+            words.push_back(word);
+        }
+    }
+}
+
+bool Derivation::derive_word(int rule, unsigned int word) {
+    unsigned int start = offsets[word];
+    int len = offsets[word + 1] - start;
+
+    scratch.resize(len);
+    missing.clear();
+
+    // Words are traced by their index
+    bool traced = trace::begin_word(word, stages[rule].data() + start, len, rule);
+    rules[rule].apply(inventory, stages[rule].data() + start, scratch.data(), len, &missing);
+
+    if (traced) {
+        trace::end_word();
+    }
+
+    for (auto const& id: missing) {
+        std::vector<unsigned int>& words = blocked[rule][id];
+
+        if (words.empty() || words.back() != word) {
+            words.push_back(word);
+        }
+    }
+
+    unsigned int* output = stages[rule + 1].data() + start;
+
+    if (std::equal(scratch.begin(), scratch.end(), output)) {
+        return false;
+    }
+
+    std::copy(scratch.begin(), scratch.end(), output);
+
+    // The changed output is the input of the next rule
+    if (rule + 1 < static_cast<int>(rules.size())) {
+        index_word(rule + 1, word);
+    }
+
+    return true;
+}
+
+bool Derivation::mark(unsigned int word) {
+    if (marks[word] == epoch) {
+        return false;
+    }
+
+    marks[word] = epoch;
+    return true;
+}
+
+long Derivation::propagate(int from, std::vector<unsigned int>& dirty, unsigned int added_id) {
+    LING_TIME(apply_rules);
+
+    long applications = 0;
+    int len = rules.size();
+
+    for (int r = from; r < len; r++) {
+        std::vector<unsigned int> work;
+        epoch++;
+
+        for (auto const& word: dirty) {
+            if (mark(word)) {
+                work.push_back(word);
+            }
+        }
+
+        if (added_id != 0x0) {
+            auto it = blocked[r].find(added_id);
+
+            if (it != blocked[r].end()) {
+                for (auto const& word: it->second) {
+                    if (mark(word)) {
+                        work.push_back(word);
+                    }
+                }
+
+                // The phoneme now exists, so no word can be blocked on it
+                blocked[r].erase(it);
+            }
+        }
+
+        dirty.clear();
+
+        // Every word outside the work list keeps its stored form for this stage
+        LING_COUNT(cache_hits, get_word_count() - work.size());
+        LING_COUNT(cache_misses, work.size());
+
+        for (auto const& word: work) {
+            applications++;
+
+            if (derive_word(r, word)) {
+                dirty.push_back(word);
+            }
+        }
+    }
+
+    return applications;
+}
+
+long Derivation::set_rule(int index, const Rule& rule) {
+    if (index < 0 || index >= static_cast<int>(rules.size())) {
+        return 0;
+    }
+
+    Rule old_rule = rules[index];
+    rules[index] = rule;
+
+    if (old_rule == rule) {
+        return 0;
+    }
+
+    // Only positions in the old or new cur_class can change
+    unsigned int old_class = old_rule.get_cur_class();
+    unsigned int new_class = rule.get_cur_class();
+
+    std::vector<unsigned int> dirty;
+
+    for (auto const& posting: occurrences[index]) {
+        if ((posting.first & old_class) == old_class || (posting.first & new_class) == new_class) {
+            dirty.insert(dirty.end(), posting.second.begin(), posting.second.end());
+        }
+    }
+
+    // Blocked results of the old rule no longer apply
+    blocked[index].clear();
+
+    return propagate(index, dirty, 0x0);
+}
+
+long Derivation::insert_consonant(std::string symbol, unsigned int id) {
+    if (sound_system.insert_consonant(symbol, id)) {
+        return -1;
+    }
+
+    inventory = Inventory(sound_system);
+
+    std::vector<unsigned int> dirty;
+    return propagate(0, dirty, id);
+}
+
+long Derivation::insert_vowel(std::string symbol, unsigned int id) {
+    if (sound_system.insert_vowel(symbol, id)) {
+        return -1;
+    }
+
+    inventory = Inventory(sound_system);
+
+    std::vector<unsigned int> dirty;
+    return propagate(0, dirty, id);
+}
+
+std::vector<unsigned int> Derivation::get_form(unsigned int word, int stage) const {
+    if (word >= get_word_count() || stage < 0 || stage >= get_stage_count()) {
+        return std::vector<unsigned int>();
+    }
+
+    return std::vector<unsigned int>(stages[stage].begin() + offsets[word],
+                                     stages[stage].begin() + offsets[word + 1]);
+}
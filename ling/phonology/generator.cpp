@@ -0,0 +1,94 @@
+#include "generator.h"
+
+Generator::Generator(const Phonotactics& phonotactics, unsigned int seed)
+    : phonotactics(phonotactics), rng(seed) {
+
+    for (int part = 0; part < 3; part++) {
+        for (auto const& sequence: phonotactics.get_sequences(static_cast<Constituent>(part))) {
+            if (by_length[part].size() <= sequence.size()) {
+                by_length[part].resize(sequence.size() + 1);
+            }
+
+            by_length[part][sequence.size()].push_back(sequence);
+        }
+    }
+
+    std::vector<std::string> types = phonotactics.get_types();
+
+    if (types.empty()) {
+        types.push_back("CV");
+    }
+
+    for (auto const& type: types) {
+        Shape shape = {{0, 0, 0}};
+        size_t i = 0;
+
+        while (i < type.size() && type[i] == 'C') {
+            shape.lengths[0]++;
+            i++;
+        }
+
+        while (i < type.size() && type[i] == 'V') {
+            shape.lengths[1]++;
+            i++;
+        }
+
+        while (i < type.size() && type[i] == 'C') {
+            shape.lengths[2]++;
+            i++;
+        }
+
+        // Skip malformed types and types no sequences can fill
+        bool usable = i == type.size() && shape.lengths[1] > 0;
+
+        for (int part = 0; part < 3 && usable; part++) {
+            int len = shape.lengths[part];
+            usable = len == 0 || (len < static_cast<int>(by_length[part].size()) && !by_length[part][len].empty());
+        }
+
+        if (usable) {
+            shapes.push_back(shape);
+        }
+    }
+}
+
+const std::vector<unsigned int>* Generator::pick(int part, int len) {
+    const std::vector<std::vector<unsigned int>>& options = by_length[part][len];
+    return &options[std::uniform_int_distribution<size_t>(0, options.size() - 1)(rng)];
+}
+
+bool Generator::generate(std::vector<unsigned int>& word, const WordFilter& filter, int max_attempts) {
+    if (shapes.empty()) {
+        return true;
+    }
+
+    std::vector<std::pair<int, int>> ranges = phonotactics.get_num();
+
+    if (ranges.empty()) {
+        ranges.push_back(std::make_pair(1, 1));
+    }
+
+    for (int attempt = 0; attempt < max_attempts; attempt++) {
+        std::pair<int, int> range = ranges[std::uniform_int_distribution<size_t>(0, ranges.size() - 1)(rng)];
+        int syllables = std::uniform_int_distribution<int>(range.first, std::max(range.first, range.second))(rng);
+
+        word.clear();
+
+        for (int s = 0; s < syllables; s++) {
+            const Shape& shape = shapes[std::uniform_int_distribution<size_t>(0, shapes.size() - 1)(rng)];
+
+            for (int part = 0; part < 3; part++) {
+                if (shape.lengths[part] > 0) {
+                    const std::vector<unsigned int>* sequence = pick(part, shape.lengths[part]);
+                    word.insert(word.end(), sequence->begin(), sequence->end());
+                }
+            }
+        }
+
+        if (!filter || filter(word)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,178 @@
+#include "history.h"
+#include "metrics.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+History::History(const Inventory& inventory, const std::vector<Rule>& rules, int checkpoint_interval)
+    : inventory(inventory), rules(rules) {
+
+    this->checkpoint_interval = checkpoint_interval;
+    offsets.push_back(0);
+    changes.resize(rules.size());
+}
+
+unsigned int History::add_word(const std::vector<unsigned int>& word) {
+    underlying.insert(underlying.end(), word.begin(), word.end());
+    offsets.push_back(underlying.size());
+
+    return offsets.size() - 2;
+}
+
+void History::run(int threads) {
+    LING_TIME(apply_rules);
+
+    int num_rules = rules.size();
+    int num_checkpoints = checkpoint_interval > 0 ? num_rules / checkpoint_interval : 0;
+
+    checkpoints.assign(num_checkpoints, std::vector<unsigned int>(underlying.size()));
+
+    std::vector<std::vector<std::vector<Change>>> batch_changes(threads > 0 ? threads : default_threads());
+
+    int batches = parallel_batches(get_word_count(), batch_changes.size(),
+        [&](size_t begin, size_t end, int batch) {
+
+        std::vector<std::vector<Change>>& local = batch_changes[batch];
+        std::vector<unsigned int> form, output;
+
+        local.resize(num_rules);
+
+        // Run each word through every stage while it is in cache
+        for (size_t w = begin; w < end; w++) {
+            unsigned int start = offsets[w];
+            int len = offsets[w + 1] - start;
+
+            form.assign(underlying.begin() + start, underlying.begin() + start + len);
+            output.resize(len);
+
+            for (int r = 0; r < num_rules; r++) {
+                if (len > 0 && rules[r].apply(inventory, form.data(), output.data(), len) > 0) {
+                    for (int i = 0; i < len; i++) {
+                        if (output[i] != form[i]) {
+                            Change change = {static_cast<unsigned int>(w), static_cast<unsigned int>(i), output[i]};
+                            local[r].push_back(change);
+                        }
+                    }
+
+                    form.swap(output);
+                }
+
+                if (checkpoint_interval > 0 && (r + 1) % checkpoint_interval == 0) {
+                    std::copy(form.begin(), form.end(), checkpoints[(r + 1) / checkpoint_interval - 1].begin() + start);
+                }
+            }
+        }
+    });
+
+    // Batches cover increasing word ranges, so concatenating them keeps each stage sorted by word
+    for (int r = 0; r < num_rules; r++) {
+        size_t total = 0;
+
+        for (int b = 0; b < batches; b++) {
+            total += batch_changes[b][r].size();
+        }
+
+        changes[r].clear();
+        changes[r].reserve(total);
+
+        for (int b = 0; b < batches; b++) {
+            changes[r].insert(changes[r].end(), batch_changes[b][r].begin(), batch_changes[b][r].end());
+            std::vector<Change>().swap(batch_changes[b][r]);
+        }
+    }
+}
+
+std::pair<const History::Change*, const History::Change*> History::find_changes(int rule, unsigned int word) const {
+    const std::vector<Change>& stage = changes[rule];
+
+    const Change* first = std::lower_bound(stage.data(), stage.data() + stage.size(), word,
+        [](const Change& change, unsigned int w) { return change.word < w; });
+
+    const Change* last = first;
+
+    while (last != stage.data() + stage.size() && last->word == word) {
+        last++;
+    }
+
+    return std::make_pair(first, last);
+}
+
+std::vector<unsigned int> History::get_form(unsigned int word, int stage) const {
+    std::vector<unsigned int> form;
+
+    if (word >= get_word_count() || stage < 0 || stage >= get_stage_count()) {
+        return form;
+    }
+
+    unsigned int start = offsets[word], end = offsets[word + 1];
+    int checkpoint = checkpoint_interval > 0 ? stage / checkpoint_interval : 0;
+    int from = 0;
+
+    // Start from the closest snapshot at or before the stage, unless the word was added after it was taken
+    if (checkpoint > 0 && checkpoint <= static_cast<int>(checkpoints.size()) && end <= checkpoints[checkpoint - 1].size()) {
+        form.assign(checkpoints[checkpoint - 1].begin() + start, checkpoints[checkpoint - 1].begin() + end);
+        from = checkpoint * checkpoint_interval;
+    } else {
+        form.assign(underlying.begin() + start, underlying.begin() + end);
+    }
+
+    for (int r = from; r < stage; r++) {
+        auto range = find_changes(r, word);
+
+        for (const Change* change = range.first; change != range.second; change++) {
+            form[change->position] = change->id;
+        }
+    }
+
+    return form;
+}
+
+int History::changed_by(unsigned int word, unsigned int position, int stage) const {
+    if (word >= get_word_count() || position >= offsets[word + 1] - offsets[word]
+        || stage < 0 || stage >= get_stage_count()) {
+
+        return -1;
+    }
+
+    for (int r = stage - 1; r >= 0; r--) {
+        auto range = find_changes(r, word);
+
+        for (const Change* change = range.first; change != range.second; change++) {
+            if (change->position == position) {
+                return r;
+            }
+        }
+    }
+
+    return -1;
+}
+
+std::vector<std::pair<int, History::Change>> History::trace(unsigned int word) const {
+    std::vector<std::pair<int, Change>> output;
+    int num_rules = rules.size();
+
+    for (int r = 0; r < num_rules; r++) {
+        auto range = find_changes(r, word);
+
+        for (const Change* change = range.first; change != range.second; change++) {
+            output.push_back(std::make_pair(r + 1, *change));
+        }
+    }
+
+    return output;
+}
+
+size_t History::get_memory() const {
+    size_t bytes = (offsets.capacity() + underlying.capacity()) * sizeof(unsigned int);
+
+    for (auto const& stage: changes) {
+        bytes += stage.capacity() * sizeof(Change);
+    }
+
+    for (auto const& checkpoint: checkpoints) {
+        bytes += checkpoint.capacity() * sizeof(unsigned int);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,307 @@
+#include "interaction.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+
+// A change a rule can make, from a phoneme to its result
+struct Change {
+    unsigned int from;
+    unsigned int to;
+};
+
+// A class a rule reads, and whether a phoneme entering it can make the rule apply more
+struct ReadClass {
+    unsigned int phon_class;
+    bool feeds;
+};
+
+static bool in(unsigned int id, unsigned int phon_class) {
+    return (id & phon_class) == phon_class;
+}
+
+/* Returns true if the rule changes a phoneme wherever its environment matches */
+static bool changes(const Inventory& inventory, const Rule& rule, unsigned int id) {
+    if (rule.is_projected() ? !rule.is_visible(id) || !rule.is_target(id) : !in(id, rule.get_cur_class())) {
+        return false;
+    }
+
+    unsigned int result = rule.get_result(id);
+    return result != id && inventory.contains(result);
+}
+
+static std::vector<ReadClass> read_classes(const Rule& rule) {
+    std::vector<ReadClass> classes;
+
+    // Boundaries never change, so requiring one reads nothing a rule can change
+    for (unsigned int phon_class: {rule.get_prev_class(), rule.get_next_class()}) {
+        if (phon_class != 0 && phon_class != MORPHEME_BOUNDARY) {
+            classes.push_back(ReadClass{phon_class, true});
+        }
+    }
+
+    if (rule.is_projected()) {
+        classes.push_back(ReadClass{rule.get_projection(), true});
+
+        if (rule.get_transparent() != 0) {
+            classes.push_back(ReadClass{rule.get_transparent(), false});
+        }
+
+        if (rule.get_opaque() != 0) {
+            classes.push_back(ReadClass{rule.get_opaque(), false});
+        }
+    }
+
+    return classes;
+}
+
+Interactions::Interactions(const Inventory& inventory, const std::vector<Rule>& rules)
+    : count(rules.size()), effects(rules.size() * rules.size(), 0), passes(rules.size(), 0) {
+
+    std::vector<std::vector<Change>> all_changes(count);
+
+    for (int r = 0; r < count; r++) {
+        for (auto const& id: inventory.get_ids()) {
+            if (changes(inventory, rules[r], id)) {
+                all_changes[r].push_back(Change{id, rules[r].get_result(id)});
+            }
+        }
+    }
+
+    for (int b = 0; b < count; b++) {
+        std::vector<ReadClass> classes = read_classes(rules[b]);
+
+        for (int a = 0; a < count; a++) {
+            if (a == b) {
+                continue;
+            }
+
+            unsigned char& effect = effects[a * count + b];
+
+            for (auto const& change: all_changes[a]) {
+                bool before = changes(inventory, rules[b], change.from);
+                bool after = changes(inventory, rules[b], change.to);
+
+                if (before && after) {
+                    effect |= INTERACTION_TARGETS;
+                } else if (before != after) {
+                    effect |= after ? INTERACTION_FEEDS : INTERACTION_BLEEDS;
+                }
+
+                for (auto const& read: classes) {
+                    bool was_in = in(change.from, read.phon_class);
+                    bool is_in = in(change.to, read.phon_class);
+
+                    if (was_in != is_in) {
+                        effect |= is_in == read.feeds ? INTERACTION_FEEDS : INTERACTION_BLEEDS;
+                    }
+                }
+            }
+        }
+    }
+
+    // Each rule goes in the earliest pass its dependencies allow
+    for (int b = 0; b < count; b++) {
+        int pass = 0;
+
+        for (int a = 0; a < b; a++) {
+            if (effects[a * count + b] != 0) {
+                pass = std::max(pass, passes[a] + 1);
+            } else if (effects[b * count + a] != 0) {
+                pass = std::max(pass, passes[a]);
+            }
+        }
+
+        passes[b] = pass;
+        pass_count = std::max(pass_count, pass + 1);
+    }
+}
+
+std::vector<std::vector<int>> Interactions::get_passes() const {
+    std::vector<std::vector<int>> rules(pass_count);
+
+    for (int r = 0; r < count; r++) {
+        rules[passes[r]].push_back(r);
+    }
+
+    return rules;
+}
+
+std::string interaction_names(unsigned int effects) {
+    static const char* names[] = {"feeds", "bleeds", "targets"};
+    std::string output = "";
+
+    for (int bit = 0; bit < 3; bit++) {
+        if (effects & (1u << bit)) {
+            output += (output.empty() ? "" : ", ") + std::string(names[bit]);
+        }
+    }
+
+    return output;
+}
+
+Cascade::Cascade(const Inventory& inventory, const std::vector<Rule>& rules)
+    : inventory(inventory), rules(rules), interactions(inventory, rules) {
+
+    int size = inventory.size();
+    int passes = interactions.get_pass_count();
+
+    targets.assign(passes * size, -1);
+    first.push_back(0);
+
+    // At most half full
+    size_t capacity = 16;
+    shift = 28;
+
+    while (capacity < static_cast<size_t>(2 * size)) {
+        capacity *= 2;
+        shift--;
+    }
+
+    slots.assign(capacity, 0);
+    slot_indices.assign(capacity, -1);
+
+    for (int i = 0; i < size; i++) {
+        unsigned int id = inventory.get_id(i);
+        size_t s = (id * 0x9e3779b1u) >> shift;
+
+        while (slots[s] != 0) {
+            s = (s + 1) & (capacity - 1);
+        }
+
+        slots[s] = id;
+        slot_indices[s] = i;
+    }
+
+    for (auto const& pass: interactions.get_passes()) {
+        int p = first.size() - 1;
+
+        for (auto const& r: pass) {
+            order.push_back(r);
+
+            // Without tiers a condition only holds for the unmarked value
+            if (rules[r].is_projected() || (rules[r].has_condition() && rules[r].get_tier_value() != 0)) {
+                continue;
+            }
+
+            for (int i = 0; i < size; i++) {
+                if (changes(inventory, rules[r], inventory.get_id(i))) {
+                    targets[p * size + i] = r;
+                }
+            }
+        }
+
+        first.push_back(order.size());
+    }
+}
+
+int Cascade::apply_pass(int pass, const unsigned int* word, unsigned int* output, int len) const {
+    // Changes of projected rules, merged into output
+    static thread_local std::vector<unsigned int> projected;
+
+    const int* table = targets.data() + pass * inventory.size();
+    bool tracing = trace::enabled() && trace::traced();
+    int changed = 0;
+
+    for (int i = 0; i < len; i++) {
+        unsigned int cur_id = word[i];
+        int index = find(cur_id);
+        output[i] = cur_id;
+
+        if (index < 0 || table[index] < 0) {
+            continue;
+        }
+
+        const Rule& rule = rules[table[index]];
+
+        if (rule.matches(word, len, i)) {
+            output[i] = rule.get_result(cur_id);
+            changed++;
+
+            if (tracing) {
+                trace::set_rule(table[index]);
+                trace::change(i, cur_id, output[i]);
+            }
+        }
+    }
+
+    // Positions a rule would leave alone are never looked at, so matches are not known here
+    LING_COUNT(rule_applications, changed);
+
+    for (int k = first[pass]; k < first[pass + 1]; k++) {
+        const Rule& rule = rules[order[k]];
+
+        if (!rule.is_projected()) {
+            continue;
+        }
+
+        if (projected.size() < static_cast<size_t>(len)) {
+            projected.resize(len);
+        }
+
+        if (tracing) {
+            trace::set_rule(order[k]);
+        }
+
+        changed += rule.apply(inventory, word, projected.data(), len);
+
+        for (int i = 0; i < len; i++) {
+            if (projected[i] != word[i]) {
+                output[i] = projected[i];
+            }
+        }
+    }
+
+    return changed;
+}
+
+int Cascade::apply(const unsigned int* word, unsigned int* output, int len) const {
+    // Every step but the last writes here, reused between calls
+    static thread_local std::vector<unsigned int> scratch;
+
+    // The analysis only covers the inventory, so a word with other IDs gets every rule in order
+    bool known = true;
+
+    for (int i = 0; i < len && known; i++) {
+        known = word[i] == MORPHEME_BOUNDARY || find(word[i]) >= 0;
+    }
+
+    int steps = known ? interactions.get_pass_count() : rules.size();
+
+    if (steps == 0) {
+        std::copy(word, word + len, output);
+        return 0;
+    }
+
+    if (scratch.size() < static_cast<size_t>(len)) {
+        scratch.resize(len);
+    }
+
+    // Alternate between the buffers so the last step writes output
+    const unsigned int* from = word;
+    bool tracing = trace::enabled() && trace::traced();
+    int changed = 0;
+
+    for (int s = 0; s < steps; s++) {
+        unsigned int* to = (steps - 1 - s) % 2 == 0 ? output : scratch.data();
+
+        if (tracing && !known) {
+            trace::set_rule(s);
+        }
+
+        changed += known ? apply_pass(s, from, to, len) : rules[s].apply(inventory, from, to, len);
+        from = to;
+    }
+
+    return changed;
+}
+
+std::vector<unsigned int> Cascade::apply(const std::vector<unsigned int>& word) const {
+    std::vector<unsigned int> output(word.size());
+
+    if (!word.empty()) {
+        apply(word.data(), output.data(), word.size());
+    }
+
+    return output;
+}
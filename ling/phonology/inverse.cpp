@@ -0,0 +1,325 @@
+#include "inverse.h"
+#include "parallel.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Source of Inverse stamps, so a cache can tell which settings its results are for
+static std::atomic<unsigned long> last_stamp(0);
+
+/* Raw bytes of a sequence of IDs, used as a hash key */
+static std::string to_key(const unsigned int* ids, int len) {
+    return std::string(reinterpret_cast<const char*>(ids), len * sizeof(unsigned int));
+}
+
+/* Returns true if a rule changes a phoneme wherever its environment matches */
+static bool changes(const Inventory& inventory, const Rule& rule, unsigned int id) {
+    unsigned int cur_class = rule.get_cur_class();
+
+    if (rule.is_projected() ? !rule.is_visible(id) || !rule.is_target(id) : (id & cur_class) != cur_class) {
+        return false;
+    }
+
+    unsigned int result = rule.get_result(id);
+    return result != id && inventory.contains(result);
+}
+
+static std::vector<unsigned int> strip_boundaries(const std::vector<unsigned int>& form) {
+    std::vector<unsigned int> stripped;
+
+    for (auto const& id: form) {
+        if (id != MORPHEME_BOUNDARY) {
+            stripped.push_back(id);
+        }
+    }
+
+    return stripped;
+}
+
+Inverse::Inverse(const Inventory& inventory, const std::vector<Rule>& rules)
+    : inventory(inventory), rules(rules), sources(rules.size()), stamp(++last_stamp) {
+
+    for (size_t r = 0; r < rules.size(); r++) {
+        sources[r].resize(inventory.size());
+        has_optional |= rules[r].is_optional();
+
+        // Without tiers a condition only holds for the unmarked value
+        if (rules[r].has_condition() && rules[r].get_tier_value() != 0) {
+            continue;
+        }
+
+        // IDs are sorted, so the sources of every phoneme are as well
+        for (auto const& id: inventory.get_ids()) {
+            if (changes(inventory, rules[r], id)) {
+                sources[r][inventory.index_of(rules[r].get_result(id))].push_back(id);
+            }
+        }
+    }
+}
+
+void Inverse::restamp() {
+    stamp = ++last_stamp;
+}
+
+bool Inverse::accepts(const std::vector<unsigned int>& form) const {
+    if (phonotactics == nullptr && lexicon == nullptr) {
+        return true;
+    }
+
+    std::vector<unsigned int> word = strip_boundaries(form);
+
+    return (phonotactics == nullptr || phonotactics->validate(word))
+        && (lexicon == nullptr || lexicon->find(word.data(), word.size()) >= 0);
+}
+
+bool Inverse::starts_word(const std::vector<unsigned int>& prefix, Cache& cache) const {
+    std::string key = to_key(prefix.data(), prefix.size());
+    auto it = cache.prefixes.find(key);
+
+    if (it != cache.prefixes.end()) {
+        return it->second;
+    }
+
+    if (cache.prefixes.size() >= INVERSE_CACHE) {
+        cache.prefixes.clear();
+    }
+
+    std::pair<long, long> range = lexicon->prefix_range(prefix.data(), prefix.size());
+    bool starts = range.first < range.second;
+
+    cache.prefixes.emplace(key, starts);
+    return starts;
+}
+
+template<typename Visit>
+bool Inverse::undo(int r, const std::vector<unsigned int>& form, Cache& cache, Visit visit) const {
+    const Rule& rule = rules[r];
+    Cache::Workspace& work = cache.workspaces[r];
+    int len = form.size();
+
+    // Phonemes each position can have had before the rule, in order of their IDs
+    std::vector<unsigned int>& choices = work.choices;
+    std::vector<int>& first = work.first;
+
+    choices.clear();
+    first.assign(1, 0);
+
+    for (int i = 0; i < len; i++) {
+        unsigned int id = form[i];
+        int index = id == MORPHEME_BOUNDARY ? -1 : inventory.index_of(id);
+
+        // Results outside the inventory are never used, so such a phoneme was always there
+        if (index >= 0) {
+            const std::vector<unsigned int>& from = sources[r][index];
+            auto middle = std::lower_bound(from.begin(), from.end(), id);
+
+            choices.insert(choices.end(), from.begin(), middle);
+            choices.push_back(id);
+            choices.insert(choices.end(), middle, from.end());
+        } else {
+            choices.push_back(id);
+        }
+
+        first.push_back(choices.size());
+    }
+
+    // A local rule at position p can be checked once the segment after it is
+    // chosen. That position never decreases with p, so the positions checked
+    // once position i is chosen are [checked[i], checked[i + 1]).
+    std::vector<int>& checked = work.checked;
+    bool fires = !rule.has_condition() || rule.get_tier_value() == 0;
+
+    checked.assign(len + 1, 0);
+
+    if (!rule.is_projected() && fires) {
+        unsigned int next_class = rule.get_next_class();
+
+        for (int p = 0; p < len; p++) {
+            int last = p;
+
+            if (next_class == MORPHEME_BOUNDARY) {
+                last = p + 1;
+            } else if (next_class != 0) {
+                for (last = p + 1; last < len && form[last] == MORPHEME_BOUNDARY; last++) {}
+            }
+
+            checked[std::min(last, len - 1) + 1]++;
+        }
+
+        for (int i = 0; i < len; i++) {
+            checked[i + 1] += checked[i];
+        }
+    }
+
+    // An optional rule can be left out wherever it matches
+    bool skippable = optional && rule.is_optional();
+
+    // Only the first rule is undone into underlying forms, which the phonotactics and the lexicon can prune
+    bool prune = r == 0 && (phonotactics != nullptr || lexicon != nullptr);
+
+    std::vector<unsigned int>& input = work.input;
+    std::vector<unsigned int>& output = work.output;
+    std::vector<unsigned int>& prefix = work.prefix;    // Chosen phonemes without boundaries, when pruning
+    std::vector<int>& depth = work.depth;               // Length of prefix before each position
+    std::vector<int>& chosen = work.chosen;             // Index of the choice at each position
+
+    input = form;                                       // Unchosen positions keep their surface phoneme
+    output.resize(len);
+    prefix.clear();
+    depth.assign(len + 1, 0);
+    chosen.assign(len, -1);
+
+    int i = 0;
+
+    while (i >= 0) {
+        if (i == len) {
+            // Every choice was already checked for a local rule
+            bool valid = !rule.is_projected() || (skippable && input == form)
+                      || (rule.apply(inventory, input.data(), output.data(), len), output == form);
+
+            if (valid && visit(input)) {
+                return true;
+            }
+
+            i--;
+            continue;
+        }
+
+        int choice = chosen[i] < 0 ? first[i] : chosen[i] + 1;
+
+        if (choice == first[i + 1]) {
+            chosen[i] = -1;
+            input[i] = form[i];
+            i--;
+            continue;
+        }
+
+        chosen[i] = choice;
+        input[i] = choices[choice];
+        bool valid = true;
+
+        for (int p = checked[i]; p < checked[i + 1] && valid; p++) {
+            unsigned int result = rule.get_result(input[p]);
+            bool applies = rule.matches(input.data(), len, p) && inventory.contains(result);
+
+            valid = (applies && result == form[p]) || ((!applies || skippable) && input[p] == form[p]);
+        }
+
+        if (!valid) {
+            continue;
+        }
+
+        if (prune) {
+            prefix.resize(depth[i]);
+
+            if (form[i] != MORPHEME_BOUNDARY) {
+                prefix.push_back(input[i]);
+
+                // accepts() checks the whole form anyway, so only prune where there is a choice
+                if (first[i + 1] - first[i] > 1
+                    && ((phonotactics != nullptr && !phonotactics->allows_prefix(prefix.data(), prefix.size()))
+                        || (lexicon != nullptr && !starts_word(prefix, cache)))) {
+                    continue;
+                }
+            }
+
+            depth[i + 1] = prefix.size();
+        }
+
+        i++;
+    }
+
+    return false;
+}
+
+bool Inverse::search(int stage, const std::vector<unsigned int>& form, Cache& cache, size_t limit,
+                     std::set<std::vector<unsigned int>>& found, std::unordered_set<std::string>& seen) const {
+
+    if (stage == 0) {
+        if (accepts(form)) {
+            found.insert(form);
+        }
+
+        return found.size() >= limit;
+    }
+
+    // Reached again through an optional rule, its forms are already in found
+    if (has_optional && stage < static_cast<int>(rules.size())) {
+        std::string key = to_key(form.data(), form.size());
+        key.push_back(static_cast<char>(stage));
+        key.push_back(static_cast<char>(stage >> 8));
+
+        if (!seen.insert(key).second) {
+            return false;
+        }
+    }
+
+    return undo(stage - 1, form, cache, [&](const std::vector<unsigned int>& input) {
+        return search(stage - 1, input, cache, limit, found, seen);
+    });
+}
+
+bool Inverse::invert(const std::vector<unsigned int>& surface, std::vector<std::vector<unsigned int>>& forms,
+                     size_t limit, Cache& cache) const {
+
+    forms.clear();
+
+    // Results of other rules or settings do not hold
+    if (cache.stamp != stamp) {
+        cache.clear();
+        cache.stamp = stamp;
+    }
+
+    std::string key = to_key(surface.data(), surface.size());
+    auto it = cache.results.find(key);
+
+    // A search that stopped early still answers a query with a lower limit
+    if (it == cache.results.end() || (it->second.cut && it->second.forms.size() <= limit)) {
+        LING_COUNT(cache_misses, 1);
+
+        std::set<std::vector<unsigned int>> found;
+        std::unordered_set<std::string> seen;
+
+        // One more than the limit tells whether there are more
+        cache.workspaces.resize(rules.size());
+        bool cut = search(rules.size(), surface, cache, limit + 1, found, seen);
+
+        if (cache.results.size() >= INVERSE_CACHE) {
+            cache.results.clear();
+        }
+
+        Cache::Entry& entry = cache.results[key];
+        entry.forms.assign(found.begin(), found.end());
+        entry.cut = cut;
+        it = cache.results.find(key);
+    } else {
+        LING_COUNT(cache_hits, 1);
+    }
+
+    const std::vector<std::vector<unsigned int>>& cached = it->second.forms;
+    forms.assign(cached.begin(), cached.begin() + std::min(limit, cached.size()));
+
+    return cached.size() > limit;
+}
+
+std::vector<std::vector<std::vector<unsigned int>>> Inverse::invert_all(
+    const std::vector<std::vector<unsigned int>>& surfaces, size_t limit, int threads, std::vector<bool>* cut) const {
+
+    std::vector<std::vector<std::vector<unsigned int>>> forms(surfaces.size());
+    std::vector<char> cuts(surfaces.size(), 0);    // Not vector<bool>, threads write neighbouring elements
+
+    parallel_batches(surfaces.size(), threads, [&](size_t begin, size_t end, int) {
+        Cache batch_cache;
+
+        for (size_t w = begin; w < end; w++) {
+            cuts[w] = invert(surfaces[w], forms[w], limit, batch_cache);
+        }
+    });
+
+    if (cut != nullptr) {
+        cut->assign(cuts.begin(), cuts.end());
+    }
+
+    return forms;
+}
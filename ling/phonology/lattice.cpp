@@ -0,0 +1,597 @@
+#include "lattice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <tuple>
+
+// Marks a missing neighbour at either end of a word (never a valid phoneme ID)
+#define NO_NEIGHBOUR 0xffffffff
+
+// Costs are compared after rounding, so sums in a different order still match
+static long long quantize(double cost) {
+    return std::llround(cost * 1e9);
+}
+
+/*
+ * Move a node to the end so it can be the final node. Every other node keeps
+ * its relative order, which stays topological since the final node has no edges.
+ */
+static void move_to_end(std::vector<std::vector<Lattice::Edge>>& nodes, unsigned int node) {
+    unsigned int last = nodes.size() - 1;
+
+    if (node == last) {
+        return;
+    }
+
+    for (auto& node_edges: nodes) {
+        for (auto& edge: node_edges) {
+            if (edge.to == node) {
+                edge.to = last;
+            } else if (edge.to > node) {
+                edge.to--;
+            }
+        }
+    }
+
+    std::vector<Lattice::Edge> moved = nodes[node];
+    nodes.erase(nodes.begin() + node);
+    nodes.push_back(moved);
+}
+
+Lattice::Lattice(std::vector<std::vector<Edge>>& nodes) {
+    first.push_back(0);
+
+    for (auto& node_edges: nodes) {
+        std::sort(node_edges.begin(), node_edges.end(), [](const Edge& a, const Edge& b) {
+            return std::tie(a.id, a.to, a.cost) < std::tie(b.id, b.to, b.cost);
+        });
+
+        edges.insert(edges.end(), node_edges.begin(), node_edges.end());
+        first.push_back(edges.size());
+    }
+}
+
+Lattice::Lattice(const unsigned int* word, int len) {
+    first.push_back(0);
+
+    for (int i = 0; i < len; i++) {
+        edges.push_back(Edge{static_cast<unsigned int>(i + 1), word[i], 0.0});
+        first.push_back(edges.size());
+    }
+
+    first.push_back(edges.size());
+}
+
+Lattice Lattice::apply(const Inventory& inventory, const Rule& rule) const {
+    unsigned int final = get_final();
+
+    if (final == 0) {
+        return *this;
+    }
+
+    if (rule.is_projected()) {
+        return apply_projected(inventory, rule);
+    }
+
+    // Without tiers every segment is unmarked
+    bool can_match = !rule.has_condition() || rule.get_tier_value() == 0;
+    double apply_cost = rule.is_optional() ? -std::log(rule.get_probability()) : 0.0;
+    double skip_cost = rule.is_optional() ? -std::log(1.0 - rule.get_probability()) : 0.0;
+
+    /*
+     * The output at a position depends on the input before, at and after it.
+     * A state (node, prev, next) is at a node of this lattice, having read
+     * prev and committed to reading next from it. Reading next gives its
+     * output and commits to one of the IDs that can follow.
+     */
+    typedef std::tuple<unsigned int, unsigned int, unsigned int> Key;
+
+    std::map<Key, unsigned int> states;
+    std::vector<Key> keys(1);
+    std::vector<std::vector<Edge>> nodes(1);
+    long final_state = -1;
+
+    auto state = [&](unsigned int node, unsigned int prev, unsigned int next) -> unsigned int {
+        if (node == final) {
+            if (final_state < 0) {
+                final_state = nodes.size();
+                nodes.push_back(std::vector<Edge>());
+                keys.push_back(Key());
+            }
+
+            return final_state;
+        }
+
+        auto it = states.find(Key(node, prev, next));
+
+        if (it != states.end()) {
+            return it->second;
+        }
+
+        unsigned int index = nodes.size();
+
+        states.insert(std::make_pair(Key(node, prev, next), index));
+        nodes.push_back(std::vector<Edge>());
+        keys.push_back(Key(node, prev, next));
+
+        return index;
+    };
+
+    // IDs that can follow a node
+    std::vector<unsigned int> following;
+
+    auto find_following = [&](unsigned int node) {
+        following.clear();
+
+        if (node == final) {
+            following.push_back(NO_NEIGHBOUR);
+            return;
+        }
+
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            if (following.empty() || following.back() != edge->id) {
+                following.push_back(edge->id);
+            }
+        }
+    };
+
+    auto emit = [&](unsigned int from, unsigned int prev, unsigned int cur, unsigned int next,
+                    unsigned int to, double cost) {
+        unsigned int window[3];
+        int len = 0;
+
+        if (prev != NO_NEIGHBOUR) {
+            window[len++] = prev;
+        }
+
+        int position = len;
+        window[len++] = cur;
+
+        if (next != NO_NEIGHBOUR) {
+            window[len++] = next;
+        }
+
+        unsigned int result = rule.get_result(cur);
+
+        if (can_match && result != cur && rule.matches(window, len, position) && inventory.contains(result)) {
+            if (rule.is_optional()) {
+                nodes[from].push_back(Edge{to, cur, cost + skip_cost});
+            }
+
+            nodes[from].push_back(Edge{to, result, cost + apply_cost});
+        } else {
+            nodes[from].push_back(Edge{to, cur, cost});
+        }
+    };
+
+    for (const Edge* edge = edges_begin(0); edge != edges_end(0); edge++) {
+        find_following(edge->to);
+
+        for (auto const& next: std::vector<unsigned int>(following)) {
+            emit(0, NO_NEIGHBOUR, edge->id, next, state(edge->to, edge->id, next), edge->cost);
+        }
+    }
+
+    // States are created a position at a time, so this visits them in topological order
+    for (unsigned int s = 1; s < nodes.size(); s++) {
+        if (static_cast<long>(s) == final_state) {
+            continue;
+        }
+
+        unsigned int node = std::get<0>(keys[s]);
+        unsigned int prev = std::get<1>(keys[s]);
+        unsigned int cur = std::get<2>(keys[s]);
+
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            if (edge->id != cur) {
+                continue;
+            }
+
+            find_following(edge->to);
+
+            for (auto const& next: std::vector<unsigned int>(following)) {
+                emit(s, prev, cur, next, state(edge->to, cur, next), edge->cost);
+            }
+        }
+    }
+
+    move_to_end(nodes, final_state);
+
+    return Lattice(nodes).determinize().minimize();
+}
+
+Lattice Lattice::apply_projected(const Inventory& inventory, const Rule& rule) const {
+    unsigned int final = get_final();
+    bool can_match = !rule.has_condition() || rule.get_tier_value() == 0;
+    double apply_cost = rule.is_optional() ? -std::log(rule.get_probability()) : 0.0;
+    double skip_cost = rule.is_optional() ? -std::log(1.0 - rule.get_probability()) : 0.0;
+
+    unsigned int prev_class = rule.get_prev_class();
+    unsigned int next_class = rule.get_next_class();
+
+    // Which segments the environment reads, as in Rule::apply
+    bool prev_output = rule.is_spreading();
+    bool next_output = rule.is_spreading() && prev_class == 0;
+    bool guess = next_class != 0;
+
+    /*
+     * The segments on the tier around a position can be any distance away,
+     * so a window of IDs does not work. A state (node, behind, ahead) instead
+     * remembers if the last segment on the tier was in prev_class (1) or not
+     * (0), and guesses if the next one is in next_class (1), is not (2) or
+     * does not exist (0). Reading the next segment on the tier checks the
+     * guess and makes a new one, and paths with a wrong guess are dropped.
+     */
+    typedef std::tuple<unsigned int, unsigned int, unsigned int> Key;
+
+    std::map<Key, unsigned int> states;
+    std::vector<Key> keys(1);
+    std::vector<std::vector<Edge>> nodes(1);
+    long final_state = -1;
+
+    auto state = [&](unsigned int node, unsigned int behind, unsigned int ahead) -> unsigned int {
+        if (node == final) {
+            if (final_state < 0) {
+                final_state = nodes.size();
+                nodes.push_back(std::vector<Edge>());
+                keys.push_back(Key());
+            }
+
+            return final_state;
+        }
+
+        auto it = states.find(Key(node, behind, ahead));
+
+        if (it != states.end()) {
+            return it->second;
+        }
+
+        unsigned int index = nodes.size();
+
+        states.insert(std::make_pair(Key(node, behind, ahead), index));
+        nodes.push_back(std::vector<Edge>());
+        keys.push_back(Key(node, behind, ahead));
+
+        return index;
+    };
+
+    auto expand = [&](unsigned int from, unsigned int node, unsigned int behind, unsigned int ahead) {
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            unsigned int cur = edge->id;
+
+            if (!rule.is_visible(cur)) {
+                if (edge->to != final || ahead == 0) {
+                    unsigned int to = state(edge->to, behind, ahead);
+                    nodes[from].push_back(Edge{to, cur, edge->cost});
+                }
+
+                continue;
+            }
+
+            if (guess && ahead == 0) {
+                continue;
+            }
+
+            unsigned int result = rule.get_result(cur);
+
+            for (unsigned int next = 0; next <= (guess ? 2u : 0u); next++) {
+                if (edge->to == final && next != 0) {
+                    continue;
+                }
+
+                bool match = can_match && rule.is_target(cur)
+                    && (prev_class == 0 || behind == 1)
+                    && (next_class == 0 || next == 1)
+                    && result != cur && inventory.contains(result);
+
+                // Outputs of this segment, with their costs
+                std::pair<unsigned int, double> outputs[2];
+                int count = 0;
+
+                if (match && rule.is_optional()) {
+                    outputs[count++] = std::make_pair(cur, edge->cost + skip_cost);
+                }
+
+                outputs[count++] = match ? std::make_pair(result, edge->cost + apply_cost)
+                                         : std::make_pair(cur, edge->cost);
+
+                for (int k = 0; k < count; k++) {
+                    unsigned int id = outputs[k].first;
+                    unsigned int read = next_output ? id : cur;
+
+                    if (guess && ahead != ((read & next_class) == next_class ? 1u : 2u)) {
+                        continue;
+                    }
+
+                    unsigned int seen = prev_output ? id : cur;
+                    unsigned int to = state(edge->to, (seen & prev_class) == prev_class, next);
+
+                    nodes[from].push_back(Edge{to, id, outputs[k].second});
+                }
+            }
+        }
+    };
+
+    for (unsigned int ahead = 0; ahead <= (guess ? 2u : 0u); ahead++) {
+        expand(0, 0, 0, ahead);
+    }
+
+    // States are created a position at a time, so this visits them in topological order
+    for (unsigned int s = 1; s < nodes.size(); s++) {
+        if (static_cast<long>(s) != final_state) {
+            expand(s, std::get<0>(keys[s]), std::get<1>(keys[s]), std::get<2>(keys[s]));
+        }
+    }
+
+    // Drop the paths of wrong guesses, which never reach the final node
+    std::vector<char> alive(nodes.size(), 0);
+    alive[final_state] = 1;
+
+    for (long s = nodes.size() - 1; s >= 0; s--) {
+        for (auto const& edge: nodes[s]) {
+            alive[s] |= alive[edge.to];
+        }
+    }
+
+    for (auto& node_edges: nodes) {
+        node_edges.erase(std::remove_if(node_edges.begin(), node_edges.end(), [&](const Edge& edge) {
+            return !alive[edge.to];
+        }), node_edges.end());
+    }
+
+    move_to_end(nodes, final_state);
+
+    return Lattice(nodes).determinize().minimize();
+}
+
+Lattice Lattice::determinize() const {
+    // Each new node is a set of old nodes with the cost they still owe
+    typedef std::vector<std::pair<unsigned int, double>> Subset;
+    typedef std::vector<std::pair<unsigned int, long long>> Key;
+
+    std::vector<Subset> subsets(1, Subset(1, std::make_pair(0u, 0.0)));
+    std::map<Key, unsigned int> indices;
+    std::vector<std::vector<Edge>> nodes(1);
+    unsigned int final = get_final();
+    long final_subset = final == 0 ? 0 : -1;
+
+    indices.insert(std::make_pair(Key(1, std::make_pair(0u, 0LL)), 0u));
+
+    for (unsigned int s = 0; s < subsets.size(); s++) {
+        // Lowest cost of reaching each old node by each ID
+        std::map<unsigned int, std::map<unsigned int, double>> moves;
+
+        for (auto const& member: subsets[s]) {
+            for (const Edge* edge = edges_begin(member.first); edge != edges_end(member.first); edge++) {
+                std::map<unsigned int, double>& targets = moves[edge->id];
+                double cost = member.second + edge->cost;
+                auto it = targets.find(edge->to);
+
+                if (it == targets.end() || cost < it->second) {
+                    targets[edge->to] = cost;
+                }
+            }
+        }
+
+        for (auto const& move: moves) {
+            double cost = std::numeric_limits<double>::infinity();
+
+            for (auto const& target: move.second) {
+                cost = std::min(cost, target.second);
+            }
+
+            Subset subset;
+            Key key;
+
+            for (auto const& target: move.second) {
+                subset.push_back(std::make_pair(target.first, target.second - cost));
+                key.push_back(std::make_pair(target.first, quantize(target.second - cost)));
+            }
+
+            auto it = indices.find(key);
+            unsigned int index;
+
+            if (it != indices.end()) {
+                index = it->second;
+            } else {
+                index = subsets.size();
+                indices.insert(std::make_pair(key, index));
+                subsets.push_back(subset);
+                nodes.push_back(std::vector<Edge>());
+
+                // Only the final node is left at the end of every path
+                if (subset[0].first == final) {
+                    final_subset = index;
+                }
+            }
+
+            nodes[s].push_back(Edge{index, move.first, cost});
+        }
+    }
+
+    move_to_end(nodes, final_subset);
+
+    return Lattice(nodes);
+}
+
+Lattice Lattice::minimize() const {
+    typedef std::vector<std::tuple<unsigned int, long long, unsigned int>> Signature;
+
+    unsigned int count = get_node_count();
+    std::vector<unsigned int> canonical(count);
+    std::map<Signature, unsigned int> signatures;
+
+    // Every node's edges lead to later nodes, so visit from the end
+    for (unsigned int node = count; node-- > 0;) {
+        Signature signature;
+
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            signature.push_back(std::make_tuple(edge->id, quantize(edge->cost), canonical[edge->to]));
+        }
+
+        auto it = signatures.find(signature);
+
+        if (it != signatures.end()) {
+            canonical[node] = it->second;
+        } else {
+            canonical[node] = node;
+            signatures.insert(std::make_pair(signature, node));
+        }
+    }
+
+    // Number the kept nodes in their old order
+    std::vector<unsigned int> renumbered(count);
+    std::vector<std::vector<Edge>> nodes;
+
+    for (unsigned int node = 0; node < count; node++) {
+        if (canonical[node] == node) {
+            renumbered[node] = nodes.size();
+            nodes.push_back(std::vector<Edge>(edges_begin(node), edges_end(node)));
+        }
+    }
+
+    for (auto& node_edges: nodes) {
+        for (auto& edge: node_edges) {
+            edge.to = renumbered[canonical[edge.to]];
+        }
+    }
+
+    return Lattice(nodes);
+}
+
+std::vector<double> Lattice::get_distances() const {
+    unsigned int count = get_node_count();
+    std::vector<double> distances(count, std::numeric_limits<double>::infinity());
+
+    distances[get_final()] = 0.0;
+
+    for (unsigned int node = count; node-- > 0;) {
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            distances[node] = std::min(distances[node], edge->cost + distances[edge->to]);
+        }
+    }
+
+    return distances;
+}
+
+unsigned long long Lattice::count() const {
+    unsigned int nodes = get_node_count();
+    std::vector<unsigned long long> paths(nodes, 0);
+    const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+
+    paths[get_final()] = 1;
+
+    for (unsigned int node = nodes; node-- > 0;) {
+        for (const Edge* edge = edges_begin(node); edge != edges_end(node); edge++) {
+            paths[node] = paths[edge->to] > max - paths[node] ? max : paths[node] + paths[edge->to];
+        }
+    }
+
+    return paths[0];
+}
+
+std::vector<std::pair<double, std::vector<unsigned int>>> Lattice::best(int k) const {
+    struct Partial {
+        double cost;
+        unsigned int node;
+        long parent;
+        unsigned int id;
+    };
+
+    // The exact cost to the final node guides the search, so complete paths
+    // come out cheapest first
+    std::vector<double> distances = get_distances();
+    std::vector<Partial> partials(1, Partial{0.0, 0, -1, 0});
+    std::priority_queue<std::pair<double, unsigned int>, std::vector<std::pair<double, unsigned int>>,
+                        std::greater<std::pair<double, unsigned int>>> queue;
+
+    std::vector<std::pair<double, std::vector<unsigned int>>> words;
+    unsigned int final = get_final();
+
+    queue.push(std::make_pair(distances[0], 0u));
+
+    while (!queue.empty() && static_cast<int>(words.size()) < k) {
+        unsigned int index = queue.top().second;
+        queue.pop();
+
+        Partial partial = partials[index];
+
+        if (partial.node == final) {
+            std::vector<unsigned int> word;
+
+            for (long p = index; partials[p].parent >= 0; p = partials[p].parent) {
+                word.push_back(partials[p].id);
+            }
+
+            std::reverse(word.begin(), word.end());
+            words.push_back(std::make_pair(partial.cost, word));
+            continue;
+        }
+
+        for (const Edge* edge = edges_begin(partial.node); edge != edges_end(partial.node); edge++) {
+            double cost = partial.cost + edge->cost;
+
+            partials.push_back(Partial{cost, edge->to, static_cast<long>(index), edge->id});
+            queue.push(std::make_pair(cost + distances[edge->to], partials.size() - 1));
+        }
+    }
+
+    return words;
+}
+
+void Lattice::Cursor::descend(unsigned int node) {
+    while (node != lattice->get_final()) {
+        unsigned int edge = lattice->first[node];
+
+        path.push_back(edge);
+        word.push_back(lattice->edges[edge].id);
+        costs.push_back(get_cost() + lattice->edges[edge].cost);
+
+        node = lattice->edges[edge].to;
+    }
+}
+
+bool Lattice::Cursor::next() {
+    if (!started) {
+        started = true;
+        descend(0);
+        return true;
+    }
+
+    // Backtrack to the last position with an edge left to take
+    while (!path.empty()) {
+        unsigned int edge = path.back();
+
+        path.pop_back();
+        word.pop_back();
+        costs.pop_back();
+
+        unsigned int node = path.empty() ? 0 : lattice->edges[path.back()].to;
+
+        if (edge + 1 < lattice->first[node + 1]) {
+            path.push_back(edge + 1);
+            word.push_back(lattice->edges[edge + 1].id);
+            costs.push_back(get_cost() + lattice->edges[edge + 1].cost);
+
+            descend(lattice->edges[edge + 1].to);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Lattice derive_lattice(const Inventory& inventory, const std::vector<Rule>& rules,
+                       const std::vector<unsigned int>& word) {
+    Lattice lattice(word);
+
+    for (auto const& rule: rules) {
+        lattice = lattice.apply(inventory, rule);
+    }
+
+    return lattice;
+}
@@ -0,0 +1,287 @@
+#include "morphology.h"
+#include "parallel.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+// Split a csv line into its values
+static std::vector<std::string> split_line(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::stringstream ss(line);
+    std::string token;
+
+    while (getline(ss, token, ',')) {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+bool Morphology::load(std::string name, const Inventory& inventory) {
+    std::ifstream f_affixes("langs/" + name + "/morphology/affixes.csv");
+    std::ifstream f_paradigm("langs/" + name + "/morphology/paradigm.csv");
+
+    if (!f_affixes.is_open() || !f_paradigm.is_open()) {
+        return true;
+    }
+
+    std::string line;
+    getline(f_affixes, line); // Ignore header
+
+    while (getline(f_affixes, line)) {
+        std::vector<std::string> tokens = split_line(line);
+
+        if (tokens.size() < 3) {
+            std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            continue;
+        }
+
+        AffixType type;
+
+        if (tokens[1] == "prefix") {
+            type = AffixType::prefix;
+        } else if (tokens[1] == "suffix") {
+            type = AffixType::suffix;
+        } else {
+            std::cerr << "Unknown affix type '" << tokens[1] << "'\n";
+            continue;
+        }
+
+        std::vector<unsigned int> form;
+
+        if (inventory.tokenize(tokens[2], form)) {
+            std::cerr << "The affix " << tokens[0] << " /" << tokens[2] << "/ is not in the inventory\n";
+            continue;
+        }
+
+        if (add_affix(tokens[0], type, form) < 0) {
+            std::cerr << "The affix " << tokens[0] << " already exists\n";
+        }
+    }
+
+    getline(f_paradigm, line); // Ignore header
+
+    while (getline(f_paradigm, line)) {
+        std::vector<std::string> tokens = split_line(line);
+
+        if (tokens.empty() || tokens[0].empty()) {
+            std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            continue;
+        }
+
+        std::vector<std::string> names;
+
+        if (tokens.size() > 1) {
+            std::stringstream ss(tokens[1]);
+            std::string affix;
+
+            while (ss >> affix) {
+                names.push_back(affix);
+            }
+        }
+
+        if (add_slot(tokens[0], names)) {
+            std::cerr << "The slot " << tokens[0] << " uses an unknown affix\n";
+        }
+    }
+
+    return false;
+}
+
+int Morphology::add_affix(std::string name, AffixType type, const std::vector<unsigned int>& form) {
+    if (affix_indices.count(name) > 0) {
+        return -1;
+    }
+
+    int index = affixes.size();
+
+    affix_indices.insert(std::make_pair(name, index));
+    affixes.push_back(Affix{name, type, form});
+
+    return index;
+}
+
+bool Morphology::add_slot(std::string name, const std::vector<std::string>& affix_names) {
+    std::vector<int> slot;
+
+    for (auto const& affix: affix_names) {
+        auto it = affix_indices.find(affix);
+
+        if (it == affix_indices.end()) {
+            return true;
+        }
+
+        slot.push_back(it->second);
+    }
+
+    slot_names.push_back(name);
+    slots.push_back(slot);
+
+    return false;
+}
+
+int Morphology::build(const unsigned int* stem, int len, int slot, unsigned int* output) const {
+    int length = 0;
+
+    for (auto const& index: slots[slot]) {
+        const Affix& affix = affixes[index];
+
+        if (affix.type == AffixType::prefix) {
+            output = std::copy(affix.form.begin(), affix.form.end(), output);
+            *output++ = MORPHEME_BOUNDARY;
+            length += affix.form.size() + 1;
+        }
+    }
+
+    output = std::copy(stem, stem + len, output);
+    length += len;
+
+    for (auto const& index: slots[slot]) {
+        const Affix& affix = affixes[index];
+
+        if (affix.type == AffixType::suffix) {
+            *output++ = MORPHEME_BOUNDARY;
+            output = std::copy(affix.form.begin(), affix.form.end(), output);
+            length += affix.form.size() + 1;
+        }
+    }
+
+    return length;
+}
+
+int Morphology::get_length(int len, int slot) const {
+    for (auto const& index: slots[slot]) {
+        len += affixes[index].form.size() + 1;
+    }
+
+    return len;
+}
+
+bool Paradigms::generate(const Morphology& morphology, const Inventory& inventory,
+                         const std::vector<Rule>& rules, const WordList& stems, int threads) {
+    LING_TIME(apply_rules);
+
+    slot_count = morphology.get_slot_count();
+    segments.clear();
+    offsets.assign(1, 0);
+    ids = inventory.get_ids();
+
+    if (inventory.size() > std::numeric_limits<uint16_t>::max() + 1) {
+        std::cerr << "Inventory is too large to store paradigms\n";
+        return true;
+    }
+
+    // Segments every slot adds to a stem, there is one boundary per affix
+    std::vector<int> added(slot_count);
+    int longest_added = 0;
+
+    for (int k = 0; k < slot_count; k++) {
+        int len = morphology.get_length(0, k);
+
+        added[k] = len - morphology.get_affix_count(k);
+        longest_added = std::max(longest_added, len);
+    }
+
+    unsigned int stem_count = stems.size();
+    uint64_t total = 0;
+    int longest_stem = 0;
+
+    offsets.reserve(static_cast<size_t>(stem_count) * slot_count + 1);
+
+    for (unsigned int s = 0; s < stem_count; s++) {
+        longest_stem = std::max(longest_stem, stems.length(s));
+
+        for (int k = 0; k < slot_count; k++) {
+            total += stems.length(s) + added[k];
+
+            if (total > std::numeric_limits<uint32_t>::max()) {
+                std::cerr << "Paradigms are too large to index\n";
+                offsets.assign(1, 0);
+                return true;
+            }
+
+            offsets.push_back(total);
+        }
+    }
+
+    segments.resize(total);
+
+    std::atomic<bool> failed(false);
+    std::atomic<bool> bounded(false);      // A stem has a boundary in it
+
+    parallel_batches(stem_count, threads, [&](size_t begin, size_t end, int) {
+        // Reused buffers large enough for any form with its boundaries
+        std::vector<unsigned int> form(longest_stem + longest_added);
+        std::vector<unsigned int> output(form.size());
+
+        for (size_t s = begin; s < end; s++) {
+            const unsigned int* stem = stems.get(s);
+            int len = stems.length(s);
+
+            // A boundary inside a stem would shift every offset after it
+            if (std::find(stem, stem + len, MORPHEME_BOUNDARY) != stem + len) {
+                bounded = true;
+                continue;
+            }
+
+            for (int k = 0; k < slot_count; k++) {
+                int form_len = morphology.build(stem, len, k, form.data());
+
+                for (auto const& rule: rules) {
+                    rule.apply(inventory, form.data(), output.data(), form_len);
+                    form.swap(output);
+                }
+
+                uint16_t* out = segments.data() + offsets[s * slot_count + k];
+
+                for (int i = 0; i < form_len; i++) {
+                    if (form[i] == MORPHEME_BOUNDARY) {
+                        continue;
+                    }
+
+                    int index = inventory.index_of(form[i]);
+
+                    if (index < 0) {
+                        failed = true;
+                        index = 0;
+                    }
+
+                    *out++ = index;
+                }
+            }
+        }
+    });
+
+    if (bounded) {
+        std::cerr << "A stem has a morpheme boundary in it, stems are single morphemes\n";
+    }
+
+    if (failed) {
+        std::cerr << "A stem or affix has a phoneme missing from the inventory\n";
+    }
+
+    return bounded || failed;
+}
+
+std::vector<unsigned int> Paradigms::get_form(unsigned int stem, int slot) const {
+    size_t form = static_cast<size_t>(stem) * slot_count + slot;
+    std::vector<unsigned int> word;
+
+    word.reserve(offsets[form + 1] - offsets[form]);
+
+    for (uint32_t i = offsets[form]; i < offsets[form + 1]; i++) {
+        word.push_back(ids[segments[i]]);
+    }
+
+    return word;
+}
+
+int Paradigms::length(unsigned int stem, int slot) const {
+    size_t form = static_cast<size_t>(stem) * slot_count + slot;
+    return offsets[form + 1] - offsets[form];
+}
@@ -0,0 +1,436 @@
+#include "optimality.h"
+#include "phoneme.h"
+#include "parallel.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+// Context of the machine before a symbol, packed into 64 bits
+#define CONTEXT_MEMBERS(c) ((c) & 0xffff)          // Last segment is in prev_class, per constraint
+#define CONTEXT_PENDING(c) (((c) >> 16) & 0xffff)  // Last segment still needs next_class, per constraint
+#define CONTEXT_START (1ull << 32)                 // No segment yet
+#define CONTEXT_BOUNDARY (1ull << 33)              // Last symbol was a boundary
+
+// Whether a neighbour class is an actual class of phonemes
+static bool is_phoneme_class(unsigned int cls) {
+    return cls != 0 && cls != WORD_EDGE && cls != MORPHEME_BOUNDARY;
+}
+
+Grammar::Grammar(const Inventory& inventory) : inventory(inventory) {
+    compile();
+}
+
+bool Grammar::load(std::string path) {
+    std::ifstream file(path);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    std::string line;
+    getline(file, line); // Ignore header
+
+    while (getline(file, line)) {
+        std::vector<std::string> tokens;
+        std::stringstream ss(line);
+        std::string token;
+
+        while (getline(ss, token, ',')) {
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() < 3) {
+            std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            continue;
+        }
+
+        Constraint constraint = {tokens[0], ConstraintType::markedness, 0, 0, 0, 0};
+
+        if (tokens[1] == "faithfulness") {
+            constraint.type = ConstraintType::faithfulness;
+        } else if (tokens[1] != "markedness") {
+            std::cerr << "Unknown constraint type '" << tokens[1] << "'\n";
+            continue;
+        }
+
+        unsigned int* values[4] = {&constraint.cur_class, &constraint.prev_class,
+                                   &constraint.next_class, &constraint.features};
+
+        try {
+            for (size_t i = 2; i < tokens.size() && i < 6; i++) {
+                if (!tokens[i].empty()) {
+                    *values[i - 2] = std::stoul(tokens[i], nullptr, 16);
+                }
+            }
+        } catch (...) {
+            std::cerr << "Failed to convert '" << line << "' into a constraint\n";
+            continue;
+        }
+
+        if (add(constraint)) {
+            std::cerr << "More than " << OT_MAX_CONSTRAINTS << " constraints, ignoring " << constraint.name << "\n";
+        }
+    }
+
+    return false;
+}
+
+bool Grammar::add(const Constraint& constraint) {
+    if (constraints.size() >= OT_MAX_CONSTRAINTS) {
+        return true;
+    }
+
+    constraints.push_back(constraint);
+    compile();
+
+    return false;
+}
+
+void Grammar::compile() {
+    int size = inventory.size();
+    int symbols = size + 1;
+    int count = constraints.size();
+
+    // Faithfulness of every pair of input and output phonemes
+    candidates.assign(size, std::vector<uint16_t>());
+    faithfulness.assign(size * size, Violations());
+
+    for (int x = 0; x < size; x++) {
+        unsigned int input = inventory.get_id(x);
+        candidates[x].push_back(x);
+
+        for (int y = 0; y < size; y++) {
+            unsigned int output = inventory.get_id(y);
+
+            for (int k = 0; k < count; k++) {
+                const Constraint& c = constraints[k];
+                unsigned int features = c.features != 0 ? c.features : ~0u;
+
+                if (c.type == ConstraintType::faithfulness && in_class(input, c.cur_class)
+                    && ((input ^ output) & features) != 0) {
+                    faithfulness[x * size + y].counts[k] = 1;
+                }
+            }
+
+            // Candidates keep the type nibble of the input
+            if (y != x && ((input ^ output) & 0xf) == 0) {
+                candidates[x].push_back(y);
+            }
+        }
+    }
+
+    // Every context reachable from the start, in the order they are found
+    std::vector<uint64_t> contexts(1, CONTEXT_START);
+    std::unordered_map<uint64_t, uint32_t> found = {{CONTEXT_START, 0}};
+    std::vector<uint32_t> raw_targets;
+    std::vector<Violations> raw_weights;
+    std::vector<Violations> raw_finals;
+
+    for (size_t s = 0; s < contexts.size(); s++) {
+        uint64_t context = contexts[s];
+        uint64_t members = CONTEXT_MEMBERS(context);
+        uint64_t pending = CONTEXT_PENDING(context);
+        Violations final;
+
+        for (int k = 0; k < count; k++) {
+            if (((pending >> k) & 1) && constraints[k].next_class == WORD_EDGE) {
+                final.counts[k] = 1;
+            }
+        }
+
+        raw_finals.push_back(final);
+
+        for (int symbol = 0; symbol < symbols; symbol++) {
+            Violations weight;
+            uint64_t next;
+
+            if (symbol == size) {
+                // Boundaries only resolve constraints waiting for one
+                uint64_t left = pending;
+
+                for (int k = 0; k < count; k++) {
+                    if (((pending >> k) & 1) && constraints[k].next_class == MORPHEME_BOUNDARY) {
+                        weight.counts[k] = 1;
+                        left &= ~(1ull << k);
+                    }
+                }
+
+                next = members | (left << 16) | (context & CONTEXT_START) | CONTEXT_BOUNDARY;
+            } else {
+                unsigned int id = inventory.get_id(symbol);
+                uint64_t next_members = 0, next_pending = 0;
+
+                for (int k = 0; k < count; k++) {
+                    const Constraint& c = constraints[k];
+
+                    if (c.type != ConstraintType::markedness) {
+                        continue;
+                    }
+
+                    if (((pending >> k) & 1) && is_phoneme_class(c.next_class) && in_class(id, c.next_class)) {
+                        weight.counts[k]++;
+                    }
+
+                    bool prev_holds;
+
+                    if (c.prev_class == 0) {
+                        prev_holds = true;
+                    } else if (c.prev_class == WORD_EDGE) {
+                        prev_holds = context & CONTEXT_START;
+                    } else if (c.prev_class == MORPHEME_BOUNDARY) {
+                        prev_holds = context & CONTEXT_BOUNDARY;
+                    } else {
+                        prev_holds = !(context & CONTEXT_START) && ((members >> k) & 1);
+                    }
+
+                    if (prev_holds && in_class(id, c.cur_class)) {
+                        if (c.next_class == 0) {
+                            weight.counts[k]++;
+                        } else {
+                            next_pending |= 1ull << k;
+                        }
+                    }
+
+                    if (is_phoneme_class(c.prev_class) && in_class(id, c.prev_class)) {
+                        next_members |= 1ull << k;
+                    }
+                }
+
+                next = next_members | (next_pending << 16);
+            }
+
+            auto it = found.find(next);
+
+            if (it == found.end()) {
+                it = found.insert(std::make_pair(next, static_cast<uint32_t>(contexts.size()))).first;
+                contexts.push_back(next);
+            }
+
+            raw_targets.push_back(it->second);
+            raw_weights.push_back(weight);
+        }
+    }
+
+    // Minimize by splitting blocks of contexts until every context of a
+    // block has the same final weight and the same transitions
+    size_t n = contexts.size();
+    std::vector<uint32_t> blocks(n);
+    std::map<Violations, uint32_t> weight_ids;
+    std::vector<uint32_t> weight_of(raw_weights.size());
+
+    for (size_t t = 0; t < raw_weights.size(); t++) {
+        weight_of[t] = weight_ids.insert(std::make_pair(raw_weights[t], weight_ids.size())).first->second;
+    }
+
+    std::map<Violations, uint32_t> final_blocks;
+
+    for (size_t s = 0; s < n; s++) {
+        blocks[s] = final_blocks.insert(std::make_pair(raw_finals[s], final_blocks.size())).first->second;
+    }
+
+    size_t block_count = final_blocks.size();
+
+    while (true) {
+        std::map<std::vector<uint32_t>, uint32_t> signatures;
+        std::vector<uint32_t> next_blocks(n);
+        std::vector<uint32_t> signature(1 + 2 * symbols);
+
+        for (size_t s = 0; s < n; s++) {
+            signature[0] = blocks[s];
+
+            for (int symbol = 0; symbol < symbols; symbol++) {
+                signature[1 + 2 * symbol] = blocks[raw_targets[s * symbols + symbol]];
+                signature[2 + 2 * symbol] = weight_of[s * symbols + symbol];
+            }
+
+            next_blocks[s] = signatures.insert(std::make_pair(signature, signatures.size())).first->second;
+        }
+
+        blocks.swap(next_blocks);
+
+        if (signatures.size() == block_count) {
+            break;
+        }
+
+        block_count = signatures.size();
+    }
+
+    // Blocks are numbered in order of their first context, so the start stays 0
+    states = block_count;
+    targets.assign(states * symbols, 0);
+    weights.assign(states * symbols, Violations());
+    finals.assign(states, Violations());
+
+    for (size_t s = 0; s < n; s++) {
+        uint32_t state = blocks[s];
+        finals[state] = raw_finals[s];
+
+        for (int symbol = 0; symbol < symbols; symbol++) {
+            targets[state * symbols + symbol] = blocks[raw_targets[s * symbols + symbol]];
+            weights[state * symbols + symbol] = raw_weights[s * symbols + symbol];
+        }
+    }
+}
+
+bool Grammar::evaluate(const unsigned int* word, int len, unsigned int* output, Violations* violations) const {
+    int size = inventory.size();
+    int symbols = size + 1;
+
+    // Reused between calls to avoid allocating per word
+    static thread_local std::vector<int> input;
+    static thread_local std::vector<Violations> costs;
+    static thread_local std::vector<char> reached;
+    static thread_local std::vector<uint32_t> back_states;
+    static thread_local std::vector<uint16_t> back_symbols;
+
+    input.resize(len);
+
+    for (int i = 0; i < len; i++) {
+        input[i] = word[i] == MORPHEME_BOUNDARY ? size : inventory.index_of(word[i]);
+
+        if (input[i] < 0) {
+            std::copy(word, word + len, output);
+            return true;
+        }
+    }
+
+    // Cost of the best path to every state after each position
+    costs.assign((len + 1) * states, Violations());
+    reached.assign((len + 1) * states, 0);
+    back_states.resize((len + 1) * states);
+    back_symbols.resize((len + 1) * states);
+    reached[0] = 1;
+
+    static const std::vector<uint16_t> boundary(1, 0);
+
+    for (int i = 0; i < len; i++) {
+        int x = input[i];
+        const Violations* from = costs.data() + i * states;
+        Violations* to = costs.data() + (i + 1) * states;
+        char* is_reached = reached.data() + (i + 1) * states;
+
+        const std::vector<uint16_t>& options = x == size ? boundary : candidates[x];
+
+        for (unsigned int s = 0; s < states; s++) {
+            if (!reached[i * states + s]) {
+                continue;
+            }
+
+            for (auto const& option: options) {
+                int y = x == size ? size : option;
+                uint32_t t = targets[s * symbols + y];
+                Violations cost = from[s];
+                cost += weights[s * symbols + y];
+
+                if (x != size) {
+                    cost += faithfulness[x * size + y];
+                }
+
+                if (!is_reached[t] || cost < to[t]) {
+                    to[t] = cost;
+                    is_reached[t] = 1;
+                    back_states[(i + 1) * states + t] = s;
+                    back_symbols[(i + 1) * states + t] = y;
+                }
+            }
+        }
+    }
+
+    unsigned int best_state = 0;
+    Violations best;
+    bool any = false;
+
+    for (unsigned int s = 0; s < states; s++) {
+        if (!reached[len * states + s]) {
+            continue;
+        }
+
+        Violations cost = costs[len * states + s];
+        cost += finals[s];
+
+        if (!any || cost < best) {
+            best = cost;
+            best_state = s;
+            any = true;
+        }
+    }
+
+    for (int i = len, s = best_state; i > 0; i--) {
+        int y = back_symbols[i * states + s];
+        output[i - 1] = y == size ? MORPHEME_BOUNDARY : inventory.get_id(y);
+        s = back_states[i * states + s];
+    }
+
+    if (violations != nullptr) {
+        *violations = best;
+    }
+
+    return false;
+}
+
+bool Grammar::evaluate(const WordList& inputs, WordList& outputs, int threads) const {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    std::vector<WordList> results(threads);
+    std::vector<char> failed(threads, 0);
+
+    int batches = parallel_batches(inputs.size(), threads, [&](size_t begin, size_t end, int batch) {
+        std::vector<unsigned int> output;
+
+        for (size_t w = begin; w < end; w++) {
+            output.resize(inputs.length(w));
+
+            if (evaluate(inputs.get(w), inputs.length(w), output.data())) {
+                failed[batch] = 1;
+            }
+
+            results[batch].add(output);
+        }
+    });
+
+    bool any_failed = false;
+
+    for (int b = 0; b < batches; b++) {
+        outputs.append(results[b]);
+        any_failed = any_failed || failed[b];
+    }
+
+    return any_failed;
+}
+
+bool Grammar::assess(const unsigned int* input, const unsigned int* output, int len, Violations& violations) const {
+    int size = inventory.size();
+    int symbols = size + 1;
+    unsigned int state = 0;
+
+    violations = Violations();
+
+    for (int i = 0; i < len; i++) {
+        if ((input[i] == MORPHEME_BOUNDARY) != (output[i] == MORPHEME_BOUNDARY)) {
+            return true;
+        }
+
+        int x = input[i] == MORPHEME_BOUNDARY ? size : inventory.index_of(input[i]);
+        int y = output[i] == MORPHEME_BOUNDARY ? size : inventory.index_of(output[i]);
+
+        if (x < 0 || y < 0) {
+            return true;
+        }
+
+        violations += weights[state * symbols + y];
+
+        if (x != size) {
+            violations += faithfulness[x * size + y];
+        }
+
+        state = targets[state * symbols + y];
+    }
+
+    violations += finals[state];
+    return false;
+}
@@ -0,0 +1,437 @@
+#include "phonotactics.h"
+
+#include "phoneme.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static const char* part_names[3] = {"onset", "nucleus", "coda"};
+
+std::string Phonotactics::to_key(const unsigned int* sequence, int len) {
+    return std::string(reinterpret_cast<const char*>(sequence), len * sizeof(unsigned int));
+}
+
+bool Phonotactics::load() {
+    LING_TIME(parse_json);
+
+    std::ifstream file("langs/" + name + "/phonology/phonotactics.json");
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    json data;
+
+    try {
+        data = json::parse(file);
+    } catch (...) {
+        std::cerr << "Failed to parse " << name << "'s phonotactics\n";
+        return true;
+    }
+
+    for (int part = 0; part < 3; part++) {
+        sequences[part].clear();
+        lists[part].clear();
+        max_length[part] = 0;
+
+        if (!data["inventory"].contains(part_names[part])) {
+            continue;
+        }
+
+        std::vector<std::vector<unsigned int>> list = data["inventory"][part_names[part]];
+
+        for (auto const& sequence: list) {
+            if (sequences[part].insert(to_key(sequence.data(), sequence.size())).second) {
+                lists[part].push_back(sequence);
+                max_length[part] = std::max<int>(max_length[part], sequence.size());
+            }
+        }
+    }
+
+    if (data.contains("syllable")) {
+        if (data["syllable"].contains("types")) {
+            types = data["syllable"]["types"].get<std::vector<std::string>>();
+        }
+
+        if (data["syllable"].contains("num")) {
+            for (auto const& range: data["syllable"]["num"]) {
+                num.push_back(std::make_pair(range[0].get<int>(), range[1].get<int>()));
+            }
+        }
+    }
+
+    return false;
+}
+
+bool Phonotactics::allows(Constituent part, const unsigned int* sequence, int len) const {
+    int index = static_cast<int>(part);
+
+    if (len > max_length[index]) {
+        return false;
+    }
+
+    // Reused so short lookups do not allocate
+    static thread_local std::string key;
+    key.assign(reinterpret_cast<const char*>(sequence), len * sizeof(unsigned int));
+
+    return sequences[index].count(key) > 0;
+}
+
+void Phonotactics::syllabify(const unsigned int* word, int len, std::vector<Syllable>& syllables) const {
+    syllables.clear();
+
+    int i = 0;
+
+    while (i < len) {
+        Syllable syllable = {0, 0, 0};
+
+        // Consonants before the first nucleus (or the whole word if there is none)
+        int start = i;
+        while (i < len && word[i] % 0x10 != 0x2) {
+            i++;
+        }
+
+        syllable.onset = i - start;
+
+        if (!syllables.empty() && i < len) {
+            // Give the previous coda what the longest allowed onset leaves over
+            int cluster = syllable.onset;
+            int onset = lists[static_cast<int>(Constituent::onset)].empty() ? std::min(cluster, 1) : 0;
+
+            for (int k = std::min(cluster, max_length[static_cast<int>(Constituent::onset)]); k > 0; k--) {
+                if (allows(Constituent::onset, word + i - k, k)) {
+                    onset = k;
+                    break;
+                }
+            }
+
+            syllables.back().coda = cluster - onset;
+            syllable.onset = onset;
+        } else if (!syllables.empty()) {
+            // Word final consonants
+            syllables.back().coda = syllable.onset;
+            break;
+        }
+
+        // Longest allowed vowel run, or a single vowel
+        int run = 0;
+        while (i + run < len && word[i + run] % 0x10 == 0x2) {
+            run++;
+        }
+
+        int nucleus = std::min(run, 1);
+
+        for (int k = std::min(run, max_length[static_cast<int>(Constituent::nucleus)]); k > 1; k--) {
+            if (allows(Constituent::nucleus, word + i, k)) {
+                nucleus = k;
+                break;
+            }
+        }
+
+        syllable.nucleus = nucleus;
+        i += nucleus;
+        syllables.push_back(syllable);
+    }
+}
+
+bool Phonotactics::validate(const unsigned int* word, int len) const {
+    static thread_local std::vector<Syllable> syllables;
+    syllabify(word, len, syllables);
+
+    if (!num.empty()) {
+        bool in_range = false;
+
+        for (auto const& range: num) {
+            in_range |= static_cast<int>(syllables.size()) >= range.first
+                        && static_cast<int>(syllables.size()) <= range.second;
+        }
+
+        if (!in_range) {
+            return false;
+        }
+    }
+
+    const unsigned int* pos = word;
+
+    for (auto const& syllable: syllables) {
+        if (syllable.nucleus == 0
+            || (syllable.onset > 0 && !allows(Constituent::onset, pos, syllable.onset))
+            || !allows(Constituent::nucleus, pos + syllable.onset, syllable.nucleus)
+            || (syllable.coda > 0 && !allows(Constituent::coda, pos + syllable.onset + syllable.nucleus, syllable.coda))) {
+
+            return false;
+        }
+
+        if (!types.empty()) {
+            std::string type = std::string(syllable.onset, 'C') + std::string(syllable.nucleus, 'V')
+                             + std::string(syllable.coda, 'C');
+
+            if (std::find(types.begin(), types.end(), type) == types.end()) {
+                return false;
+            }
+        }
+
+        pos += syllable.onset + syllable.nucleus + syllable.coda;
+    }
+
+    return true;
+}
+
+bool Phonotactics::allows_prefix(const unsigned int* word, int len) const {
+    int max_onset = max_length[static_cast<int>(Constituent::onset)];
+    int max_nucleus = max_length[static_cast<int>(Constituent::nucleus)];
+    int max_coda = max_length[static_cast<int>(Constituent::coda)];
+
+    // Returns true if a syllable whose parts are all known has a listed type, without building its name
+    auto has_type = [&](int onset, int nucleus, int coda) {
+        if (types.empty()) {
+            return true;
+        }
+
+        for (auto const& type: types) {
+            int length = type.size();
+            bool same = length == onset + nucleus + coda;
+
+            for (int k = 0; k < length && same; k++) {
+                same = type[k] == (k >= onset && k < onset + nucleus ? 'V' : 'C');
+            }
+
+            if (same) {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    // Returns true if a word can have at least count syllables
+    auto fits = [&](int count) {
+        if (num.empty()) {
+            return true;
+        }
+
+        for (auto const& range: num) {
+            if (count <= range.second) {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    // Consonants before the first vowel are its onset, as in syllabify()
+    int i = 0;
+
+    while (i < len && word[i] % 0x10 != 0x2) {
+        i++;
+    }
+
+    int onset = i;
+
+    if (i == len) {
+        return onset <= max_onset;
+    }
+
+    if (onset > 0 && !allows(Constituent::onset, word, onset)) {
+        return false;
+    }
+
+    int syllables = 0;
+
+    while (true) {
+        // Vowels, which may go on if the prefix ends with them
+        int start = i;
+
+        while (i < len && word[i] % 0x10 == 0x2) {
+            i++;
+        }
+
+        if (i == len) {
+            return fits(syllables + 1);
+        }
+
+        // Split the run into nuclei as syllabify() does. Every syllable but the last has no coda.
+        int nucleus = 0;
+
+        for (int v = start; v < i; v += nucleus) {
+            int run = i - v;
+            nucleus = 1;
+
+            for (int k = std::min(run, max_nucleus); k > 1; k--) {
+                if (allows(Constituent::nucleus, word + v, k)) {
+                    nucleus = k;
+                    break;
+                }
+            }
+
+            if (!allows(Constituent::nucleus, word + v, nucleus)) {
+                return false;
+            }
+
+            syllables++;
+
+            if (v + nucleus < i) {
+                if (!has_type(onset, nucleus, 0)) {
+                    return false;
+                }
+
+                onset = 0;
+            }
+        }
+
+        // Consonants, which may go on if the prefix ends with them
+        start = i;
+
+        while (i < len && word[i] % 0x10 != 0x2) {
+            i++;
+        }
+
+        int cluster = i - start;
+
+        if (i == len) {
+            return cluster <= max_onset + max_coda && fits(syllables);
+        }
+
+        // The longest allowed onset, the rest is the coda of the syllable before
+        int next_onset = lists[static_cast<int>(Constituent::onset)].empty() ? std::min(cluster, 1) : 0;
+
+        for (int k = std::min(cluster, max_onset); k > 0; k--) {
+            if (allows(Constituent::onset, word + i - k, k)) {
+                next_onset = k;
+                break;
+            }
+        }
+
+        int coda = cluster - next_onset;
+
+        if ((coda > 0 && !allows(Constituent::coda, word + start, coda))
+            || (next_onset > 0 && !allows(Constituent::onset, word + i - next_onset, next_onset))
+            || !has_type(onset, nucleus, coda) || !fits(syllables + 1)) {
+
+            return false;
+        }
+
+        onset = next_onset;
+    }
+}
+
+bool insert_sequences(std::string part, std::string lang, std::vector<std::vector<unsigned int>> sequences) {
+
+    int num_added = 0;
+
+    // Read from file
+    json data;
+    {
+        LING_TIME(parse_json);
+
+        std::ifstream in_file("langs/" + lang + "/phonology/phonotactics.json");
+        data = json::parse(in_file);
+        in_file.close();
+    }
+
+    std::vector<std::vector<unsigned int>> old_sequences = data["inventory"][part];
+
+    // Add new sequences to vector
+    for (auto const& sequence: sequences) {
+        if (std::find(old_sequences.begin(), old_sequences.end(), sequence) == old_sequences.end()) {
+            old_sequences.push_back(sequence);
+            num_added++;
+        }
+    }
+
+    if (num_added == 0) {
+        return false;
+    }
+
+    data["inventory"][part] = old_sequences;
+
+    // Write to file
+    LING_TIME(write_output);
+
+    std::ofstream out_file("langs/" + lang + "/phonology/phonotactics.json");
+    out_file << data.dump(4) << "\n";
+    LING_COUNT(bytes_written, metrics::stream_bytes(out_file));
+    out_file.close();
+    return true;
+}
+
+Sequences::Sequences(const std::set<unsigned int>& ids, const std::vector<unsigned int>& classes)
+    : digits(classes.size(), 0), word(classes.size()) {
+
+    // Search for phonemes
+    for (auto const& phon_class: classes) {
+        std::vector<unsigned int> temp;
+
+        for (auto const& id: ids) {
+            if (in_class(id, phon_class)) {
+                temp.push_back(id);
+            }
+        }
+
+        if (temp.empty()) {
+            done = true;
+        }
+
+        phonemes.push_back(temp);
+    }
+}
+
+bool Sequences::next() {
+    if (done) {
+        return false;
+    }
+
+    int len = phonemes.size();
+
+    if (!started) {
+        started = true;
+
+        for (int i = 0; i < len; i++) {
+            word[i] = phonemes[i][0];
+        }
+
+        return true;
+    }
+
+    // Advance the last digit, carrying into the ones before it
+    for (int i = len - 1; i >= 0; i--) {
+        if (++digits[i] < phonemes[i].size()) {
+            word[i] = phonemes[i][digits[i]];
+            return true;
+        }
+
+        digits[i] = 0;
+        word[i] = phonemes[i][0];
+    }
+
+    done = true;
+    return false;
+}
+
+unsigned long long Sequences::get_count() const {
+    unsigned long long count = 1;
+
+    for (auto const& options: phonemes) {
+        count *= options.size();
+    }
+
+    return count;
+}
+
+std::vector<std::vector<unsigned int>> create_sequences(const std::set<unsigned int>& ids,
+                                                        const std::vector<unsigned int>& classes) {
+
+    std::vector<std::vector<unsigned int>> sequences;
+    Sequences enumerator(ids, classes);
+
+    while (enumerator.next()) {
+        sequences.push_back(enumerator.get_word());
+    }
+
+    return sequences;
+}
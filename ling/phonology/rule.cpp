@@ -0,0 +1,305 @@
+#include "rule.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+bool Rule::matches(const unsigned int* word, int len, int i) const {
+    if (word[i] == MORPHEME_BOUNDARY || (word[i] & cur_class) != cur_class) {
+        return false;
+    }
+
+    int prev = i - 1;
+    int next = i + 1;
+
+    // Boundaries are transparent unless the environment asks for one
+    if (prev_class != MORPHEME_BOUNDARY) {
+        while (prev >= 0 && word[prev] == MORPHEME_BOUNDARY) {
+            prev--;
+        }
+    }
+
+    if (next_class != MORPHEME_BOUNDARY) {
+        while (next < len && word[next] == MORPHEME_BOUNDARY) {
+            next++;
+        }
+    }
+
+    if (prev_class != 0 && next_class != 0) { // Environment: prev_class _ next_class
+        return prev >= 0
+            && next < len
+            && (word[prev] & prev_class) == prev_class
+            && (word[next] & next_class) == next_class;
+    } else if (prev_class != 0) { // Environment: prev_class _
+        return prev >= 0
+            && (word[prev] & prev_class) == prev_class;
+    } else { // Environment: _ next_class
+        return next < len
+            && (word[next] & next_class) == next_class;
+    }
+}
+
+int Rule::apply(const Inventory& inventory, const unsigned int* word, unsigned int* output, int len,
+                std::vector<unsigned int>* blocked) const {
+
+    return apply_tiers(inventory, word, output, len, nullptr, 0, blocked);
+}
+
+int Rule::apply(const Inventory& inventory, const unsigned int* word, unsigned int* output, int len,
+                const Tiers& tiers, size_t offset, std::vector<unsigned int>* blocked) const {
+
+    return apply_tiers(inventory, word, output, len, &tiers, offset, blocked);
+}
+
+int Rule::apply_tiers(const Inventory& inventory, const unsigned int* word, unsigned int* output, int len,
+                      const Tiers* tiers, size_t offset, std::vector<unsigned int>* blocked) const {
+
+    if (is_projected()) {
+        return apply_projected(inventory, word, output, len, tiers, offset, blocked);
+    }
+
+    // Tier values are only read when the rule has a condition
+    static const Tiers unmarked;
+    bool read_tiers = has_condition() && tiers != nullptr;
+    Tiers::Cursor cursor(read_tiers ? *tiers : unmarked, read_tiers ? get_tier() : Tier::tone, offset);
+
+    int changed = 0;
+    int matched = 0;
+    int missing = 0;
+
+    for (int i = 0; i < len; i++) {
+        unsigned int cur_id = word[i];
+        output[i] = cur_id;
+
+        if (has_condition()) {
+            unsigned int value = cursor.value();
+            cursor.advance();
+
+            if (value != tier_value) {
+                continue;
+            }
+        }
+
+        if (!matches(word, len, i)) {
+            continue;
+        }
+
+        matched++;
+        unsigned int new_id = get_result(cur_id);
+
+        // Only use the result if it exists in the current sound system
+        if (inventory.contains(new_id)) {
+            output[i] = new_id;
+            changed += new_id != cur_id;
+
+            // Only recorded if the word is traced
+            if (trace::active() && new_id != cur_id) {
+                trace::change(i, cur_id, new_id);
+            }
+        } else {
+            missing++;
+
+            if (blocked != nullptr) {
+                blocked->push_back(new_id);
+            }
+        }
+    }
+
+    LING_COUNT(rule_matches, matched);
+    LING_COUNT(rule_applications, changed);
+    LING_COUNT(rule_blocked, missing);
+
+    return changed;
+}
+
+int Rule::apply_projected(const Inventory& inventory, const unsigned int* word, unsigned int* output, int len,
+                          const Tiers* tiers, size_t offset, std::vector<unsigned int>* blocked) const {
+
+    // A spreading rule runs away from its trigger, so the segment behind a target is already final
+    bool forward = !spreading || prev_class != 0 || next_class == 0;
+    int step = forward ? 1 : -1;
+    int end = forward ? len : -1;
+    unsigned int behind_class = forward ? prev_class : next_class;
+    unsigned int ahead_class = forward ? next_class : prev_class;
+    const unsigned int* behind_word = spreading ? output : word;
+
+    int changed = 0;
+    int matched = 0;
+    int missing = 0;
+
+    for (int i = 0; i < len; i++) {
+        output[i] = word[i];
+    }
+
+    // Walk the tier only, keeping the segment on it before and after the current one
+    int behind = -1;
+    int ahead = forward ? 0 : len - 1;
+
+    while (ahead != end && !is_visible(word[ahead])) {
+        ahead += step;
+    }
+
+    while (ahead != end) {
+        int i = ahead;
+
+        do {
+            ahead += step;
+        } while (ahead != end && !is_visible(word[ahead]));
+
+        unsigned int cur_id = word[i];
+        bool condition = !has_condition() || (tiers != nullptr ? tiers->get(get_tier(), offset + i) : 0) == tier_value;
+
+        if (is_target(cur_id) && condition
+            && (behind_class == 0 || (behind >= 0 && (behind_word[behind] & behind_class) == behind_class))
+            && (ahead_class == 0 || (ahead != end && (word[ahead] & ahead_class) == ahead_class))) {
+
+            matched++;
+            unsigned int new_id = get_result(cur_id);
+
+            if (inventory.contains(new_id)) {
+                output[i] = new_id;
+                changed += new_id != cur_id;
+
+                if (trace::active() && new_id != cur_id) {
+                    trace::change(i, cur_id, new_id);
+                }
+            } else {
+                missing++;
+
+                if (blocked != nullptr) {
+                    blocked->push_back(new_id);
+                }
+            }
+        }
+
+        behind = i;
+    }
+
+    LING_COUNT(rule_matches, matched);
+    LING_COUNT(rule_applications, changed);
+    LING_COUNT(rule_blocked, missing);
+
+    return changed;
+}
+
+std::vector<unsigned int> Rule::apply(const Inventory& inventory, const std::vector<unsigned int>& word) const {
+    std::vector<unsigned int> output(word.size());
+
+    if (!word.empty()) {
+        apply(inventory, word.data(), output.data(), word.size());
+    }
+
+    return output;
+}
+
+bool load_rules(std::string path, std::vector<Rule>& rules) {
+    std::ifstream file(path);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    std::string line;
+    bool isFirstLine = true;
+
+    while (getline(file, line)) {
+        std::vector<std::string> tokens;
+        std::stringstream ss(line);
+        std::string token;
+
+        // Ignore header
+        if (isFirstLine) {
+            isFirstLine = false;
+            continue;
+        }
+
+        while (getline(ss, token, ',')) {
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() < 4) {
+            std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            continue;
+        }
+
+        unsigned int classes[4];
+
+        try {
+            for (int i = 0; i < 4; i++) {
+                classes[i] = std::stoul(tokens[i], nullptr, 16);
+            }
+        } catch (...) {
+            std::cerr << "Failed to convert '" << line << "' into a rule\n";
+            continue;
+        }
+
+        Rule rule(classes[0], classes[1], classes[2], classes[3]);
+
+        // Optional tier condition
+        if (tokens.size() >= 6 && !tokens[4].empty()) {
+            static const char* tier_names[NUM_TIERS] = {"tone", "stress", "length"};
+            int tier = 0;
+
+            for (int i = 0; i < NUM_TIERS; i++) {
+                if (tokens[4] == tier_names[i]) {
+                    tier = i + 1;
+                }
+            }
+
+            try {
+                if (tier == 0) {
+                    throw std::invalid_argument(tokens[4]);
+                }
+
+                rule.set_condition(static_cast<Tier>(tier), std::stoul(tokens[5]));
+            } catch (...) {
+                std::cerr << "Failed to convert '" << line << "' into a rule\n";
+                continue;
+            }
+        }
+
+        // Optional probability
+        if (tokens.size() >= 7 && !tokens[6].empty()) {
+            try {
+                double probability = std::stod(tokens[6]);
+
+                if (probability <= 0.0 || probability > 1.0) {
+                    throw std::out_of_range(tokens[6]);
+                }
+
+                rule.set_probability(probability);
+            } catch (...) {
+                std::cerr << "Failed to convert '" << line << "' into a rule\n";
+                continue;
+            }
+        }
+
+        // Optional projection
+        if (tokens.size() >= 8 && !tokens[7].empty()) {
+            try {
+                unsigned int classes[3] = {0, 0, 0};
+                std::string mode = tokens.size() >= 11 && !tokens[10].empty() ? tokens[10] : "spread";
+
+                for (size_t i = 7; i < tokens.size() && i < 10; i++) {
+                    classes[i - 7] = tokens[i].empty() ? 0 : std::stoul(tokens[i], nullptr, 16);
+                }
+
+                if (mode != "spread" && mode != "agree") {
+                    throw std::invalid_argument(mode);
+                }
+
+                rule.set_projection(classes[0], classes[1], classes[2], mode == "spread");
+            } catch (...) {
+                std::cerr << "Failed to convert '" << line << "' into a rule\n";
+                continue;
+            }
+        }
+
+        rules.push_back(rule);
+    }
+
+    return false;
+}
@@ -0,0 +1,374 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "generator.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Most words a single generate request can ask for
+#define MAX_GENERATE 10000
+
+Server::Connection::~Connection() {
+    if (owned) {
+        ::close(fd);
+    }
+}
+
+void Server::Connection::write(const std::string& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t written = 0;
+
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // The client went away, drop the rest
+        if (n <= 0) {
+            return;
+        }
+
+        written += n;
+    }
+}
+
+Server::Server(Registry& registry, int threads, int batch_size, int max_loads)
+    : registry(registry), threads(threads > 0 ? threads : default_threads()),
+      batch_size(batch_size > 0 ? batch_size : 1), max_loads(std::max(max_loads, 0)), handled(0) {}
+
+/* Returns true if a language name is safe to use as a directory of langs/ */
+static bool valid_name(const std::string& name) {
+    if (name.empty()) {
+        return false;
+    }
+
+    for (char c: name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<const Language> Server::find_language(const std::string& name) {
+    std::shared_ptr<const Language> language = registry.get(name);
+
+    if (language || !valid_name(name)) {
+        return language;
+    }
+
+    // Load on first use. Only one language is loaded at a time, so requests
+    // for the same new language load it once.
+    std::lock_guard<std::mutex> lock(load_mutex);
+    language = registry.get(name);
+
+    if (!language && loads < max_loads) {
+        loads++;
+
+        if (!registry.load(name)) {
+            language = registry.get(name);
+        }
+    }
+
+    return language;
+}
+
+/* Reads the word of a request from "ids" or "text" */
+static bool read_word(const json& request, const Inventory& inventory, std::vector<unsigned int>& word) {
+    if (request.contains("ids")) {
+        word = request["ids"].get<std::vector<unsigned int>>();
+        return false;
+    }
+
+    return inventory.tokenize(request.value("text", ""), word);
+}
+
+std::string Server::handle(const std::string& line) {
+    json response;
+    handled++;
+
+    try {
+        json request = json::parse(line);
+
+        if (request.contains("id")) {
+            response["id"] = request["id"];
+        }
+
+        std::string op = request.value("op", "");
+        std::string lang = request.value("lang", "");
+        std::shared_ptr<const Language> language = find_language(lang);
+
+        if (!language) {
+            response["error"] = "unknown language '" + lang + "'";
+            return response.dump();
+        }
+
+        const Inventory& inventory = language->get_inventory();
+        const Phonotactics* phonotactics = language->get_phonotactics();
+        std::vector<unsigned int> word;
+
+        if (op == "generate") {
+            if (phonotactics == nullptr) {
+                response["error"] = "no phonotactics for '" + lang + "'";
+                return response.dump();
+            }
+
+            int count = std::min(request.value("count", 1), MAX_GENERATE);
+            Generator generator(*phonotactics, request.value("seed", static_cast<unsigned int>(handled)));
+
+            response["words"] = json::array();
+            int failed = 0;
+
+            for (int i = 0; i < count; i++) {
+                if (generator.generate(word)) {
+                    failed++;
+                } else {
+                    response["words"].push_back(inventory.render(word));
+                }
+            }
+
+            response["failed"] = failed;
+        } else if (op != "tokenize" && op != "derive" && op != "validate" && op != "syllabify") {
+            response["error"] = "unknown op '" + op + "'";
+        } else if (read_word(request, inventory, word)) {
+            response["error"] = "unknown phoneme in '" + request.value("text", "") + "'";
+        } else if (op == "tokenize") {
+            response["ids"] = word;
+        } else if (op == "derive") {
+            word = language->get_cascade().apply(word);
+
+            response["surface"] = inventory.render(word);
+            response["ids"] = word;
+        } else if (phonotactics == nullptr) {
+            response["error"] = "no phonotactics for '" + lang + "'";
+        } else if (op == "validate") {
+            response["valid"] = phonotactics->validate(word);
+        } else {
+            std::vector<Syllable> syllables;
+            phonotactics->syllabify(word.data(), word.size(), syllables);
+
+            response["syllables"] = json::array();
+            size_t start = 0;
+
+            for (auto const& syllable: syllables) {
+                size_t len = syllable.onset + syllable.nucleus + syllable.coda;
+                std::vector<unsigned int> part(word.begin() + start, word.begin() + start + len);
+
+                response["syllables"].push_back(inventory.render(part));
+                start += len;
+            }
+        }
+    } catch (const std::exception& e) {
+        response["error"] = e.what();
+    }
+
+    return response.dump();
+}
+
+void Server::push(const std::shared_ptr<Connection>& connection, std::string request) {
+    {
+        // Wait for room, so a fast client is slowed down to what the workers answer
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_space.wait(lock, [this] { return closed || queue.size() < SERVER_MAX_QUEUE; });
+        queue.push_back(Job{connection, std::move(request)});
+    }
+
+    queue_ready.notify_one();
+}
+
+void Server::close() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closed = true;
+    }
+
+    queue_ready.notify_all();
+    queue_space.notify_all();
+}
+
+void Server::work() {
+    std::vector<Job> batch;
+
+    while (true) {
+        batch.clear();
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [this] { return closed || !queue.empty(); });
+
+            if (queue.empty()) {
+                return;
+            }
+
+            // Small requests are taken several at a time so the queue is locked once per batch
+            while (!queue.empty() && static_cast<int>(batch.size()) < batch_size) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        queue_space.notify_all();
+
+        // Responses to the same connection are written together
+        std::string output;
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            output += handle(batch[i].request);
+            output += '\n';
+
+            if (i + 1 == batch.size() || batch[i + 1].connection != batch[i].connection) {
+                batch[i].connection->write(output);
+                output.clear();
+            }
+        }
+    }
+}
+
+void Server::read_stream(int fd, const std::shared_ptr<Connection>& connection) {
+    char buffer[1 << 16];
+    std::string pending;
+    bool skipping = false;      // The rest of a line that was too long is dropped
+    ssize_t n;
+
+    json too_long;
+    too_long["error"] = "request longer than " + std::to_string(SERVER_MAX_LINE) + " bytes";
+
+    while ((n = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        pending.append(buffer, n);
+        size_t start = 0, end;
+
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            if (skipping) {
+                skipping = false;
+            } else if (end - start > SERVER_MAX_LINE) {
+                connection->write(too_long.dump() + "\n");
+            } else if (end > start) {
+                push(connection, pending.substr(start, end - start));
+            }
+
+            start = end + 1;
+        }
+
+        pending.erase(0, start);
+
+        if (pending.size() > SERVER_MAX_LINE) {
+            if (!skipping) {
+                connection->write(too_long.dump() + "\n");
+                skipping = true;
+            }
+
+            pending.clear();
+        }
+    }
+
+    // A last request without a newline
+    if (!pending.empty() && !skipping) {
+        push(connection, pending);
+    }
+}
+
+void Server::serve_stdin() {
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(&Server::work, this));
+    }
+
+    read_stream(STDIN_FILENO, std::make_shared<Connection>(STDOUT_FILENO, false));
+    close();
+
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+bool Server::serve_socket(const std::string& path) {
+    sockaddr_un address;
+
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << path << "\n";
+        return true;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0) {
+        std::cerr << "Failed to create a socket: " << strerror(errno) << "\n";
+        return true;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    // Replace the socket left by a previous run
+    unlink(path.c_str());
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listener, SOMAXCONN) < 0) {
+
+        std::cerr << "Failed to listen on " << path << ": " << strerror(errno) << "\n";
+        ::close(listener);
+        return true;
+    }
+
+    // Writing to a client that disconnected must not end the server
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(&Server::work, this));
+    }
+
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            std::cerr << "Failed to accept a connection: " << strerror(errno) << "\n";
+            break;
+        }
+
+        // One reader per connection, the workers are shared
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>(client, true);
+        std::thread(&Server::read_stream, this, client, connection).detach();
+    }
+
+    ::close(listener);
+    close();
+
+    for (auto& worker: workers) {
+        worker.join();
+    }
+
+    return false;
+}
@@ -0,0 +1,169 @@
+#include "inventory.h"
+#include "ipa.h"
+
+#include <algorithm>
+#include <sstream>
+
+Inventory::Inventory(const SoundSystem& sound_system) {
+    const std::map<unsigned int, Consonant>& consonants = sound_system.get_consonants();
+    const std::map<unsigned int, Vowel>& vowels = sound_system.get_vowels();
+
+    // Consonant IDs end in 1 and vowel IDs end in 2, so neither map is ordered
+    // relative to the other
+    std::vector<std::pair<unsigned int, std::string>> phonemes;
+
+    for (auto const& phon: consonants) {
+        phonemes.push_back(std::make_pair(phon.first, phon.second.get_symbol()));
+    }
+
+    for (auto const& phon: vowels) {
+        phonemes.push_back(std::make_pair(phon.first, phon.second.get_symbol()));
+    }
+
+    std::sort(phonemes.begin(), phonemes.end());
+
+    for (auto const& phon: phonemes) {
+        indices.insert(std::make_pair(phon.second, static_cast<int>(ids.size())));
+        ids.push_back(phon.first);
+        symbols.push_back(phon.second);
+        max_length = std::max(max_length, phon.second.length());
+    }
+
+    for (auto const& supra: sound_system.get_suprasegmentals()) {
+        std::vector<std::string>& tier_marks = marks[static_cast<int>(supra.second.get_tier()) - 1];
+
+        if (tier_marks.size() <= supra.second.get_value()) {
+            tier_marks.resize(supra.second.get_value() + 1);
+        }
+
+        tier_marks[supra.second.get_value()] = supra.second.get_symbol();
+    }
+}
+
+int Inventory::index_of(unsigned int id) const {
+    auto it = std::lower_bound(ids.begin(), ids.end(), id);
+
+    if (it == ids.end() || *it != id) {
+        return -1;
+    }
+
+    return it - ids.begin();
+}
+
+bool Inventory::parse(const std::string& line, std::vector<unsigned int>& word) const {
+    std::stringstream ss(line);
+    std::string symbol;
+
+    word.clear();
+
+    while (ss >> symbol) {
+        auto it = indices.find(symbol);
+
+        if (it == indices.end()) {
+            return true;
+        }
+
+        word.push_back(ids[it->second]);
+    }
+
+    return false;
+}
+
+bool Inventory::tokenize(const std::string& text, std::vector<unsigned int>& word, bool ipa_fallback) const {
+    size_t i = 0;
+
+    word.clear();
+
+    while (i < text.length()) {
+        if (text[i] == ' ') {
+            i++;
+            continue;
+        }
+
+        size_t len = std::min(max_length, text.length() - i);
+
+        for (; len > 0; len--) {
+            auto it = indices.find(text.substr(i, len));
+
+            if (it != indices.end()) {
+                word.push_back(ids[it->second]);
+                break;
+            }
+        }
+
+        if (len == 0 && ipa_fallback) {
+            unsigned int id;
+            len = Ipa::match(text.data() + i, text.length() - i, &id);
+
+            if (len > 0) {
+                word.push_back(id);
+            }
+        }
+
+        if (len == 0) {
+            return true;
+        }
+
+        i += len;
+    }
+
+    return false;
+}
+
+std::string Inventory::render(const std::vector<unsigned int>& word) const {
+    std::string output = "";
+
+    for (auto const& id: word) {
+        int index = index_of(id);
+
+        if (index >= 0) {
+            output += symbols[index];
+        }
+    }
+
+    return output;
+}
+
+std::string Inventory::render(const unsigned int* word, int len, const Tiers& tiers, size_t offset) const {
+    std::string output = "";
+    Tiers::Cursor tone(tiers, Tier::tone, offset);
+    Tiers::Cursor stress(tiers, Tier::stress, offset);
+    Tiers::Cursor length(tiers, Tier::length, offset);
+    unsigned int prev_stress = 0;
+
+    for (int i = 0; i < len; i++) {
+        unsigned int cur_tone = tone.value();
+        unsigned int cur_stress = stress.value();
+
+        tone.advance();
+        stress.advance();
+
+        if (cur_stress != prev_stress) {
+            output += get_mark(Tier::stress, cur_stress);
+            prev_stress = cur_stress;
+        }
+
+        int index = index_of(word[i]);
+
+        if (index >= 0) {
+            output += symbols[index];
+        }
+
+        output += get_mark(Tier::length, length.value());
+        length.advance();
+
+        // The cursor has moved to the next segment
+        if (i + 1 == len || tone.value() != cur_tone) {
+            output += get_mark(Tier::tone, cur_tone);
+        }
+    }
+
+    return output;
+}
+
+const std::string& Inventory::get_mark(Tier tier, unsigned int value) const {
+    static const std::string none = "";
+    const std::vector<std::string>& tier_marks = marks[static_cast<int>(tier) - 1];
+
+    return value < tier_marks.size() ? tier_marks[value] : none;
+}
@@ -0,0 +1,64 @@
+#include "ipa.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr IpaEntry Ipa::table[];
+
+/* Table indices sorted by symbol, built on first use */
+struct SymbolIndex {
+    unsigned char order[Ipa::size];
+
+    SymbolIndex() {
+        for (int i = 0; i < Ipa::size; i++) {
+            order[i] = i;
+        }
+
+        // Shared symbols sort the higher (alveolar) ID first so lookups find it
+        std::sort(order, order + Ipa::size, [](unsigned char a, unsigned char b) {
+            int diff = strcmp(Ipa::table[a].symbol, Ipa::table[b].symbol);
+            return diff != 0 ? diff < 0 : Ipa::table[a].id > Ipa::table[b].id;
+        });
+    }
+};
+
+static const SymbolIndex& symbol_index() {
+    static const SymbolIndex index;
+    return index;
+}
+
+const IpaEntry* Ipa::find(const std::string& symbol) {
+    const SymbolIndex& index = symbol_index();
+
+    const unsigned char* it = std::lower_bound(index.order, index.order + size, symbol,
+        [](unsigned char entry, const std::string& symbol) {
+            return strcmp(table[entry].symbol, symbol.c_str()) < 0;
+        });
+
+    if (it == index.order + size || symbol != table[*it].symbol) {
+        return nullptr;
+    }
+
+    return &table[*it];
+}
+
+size_t Ipa::match(const char* text, size_t len, unsigned int* id) {
+    size_t best = 0;
+    int best_index = -1;
+
+    for (int i = 0; i < size; i++) {
+        size_t symbol_len = strlen(table[i].symbol);
+
+        // Later duplicates are alveolar, so >= prefers them
+        if (symbol_len >= best && symbol_len <= len && memcmp(text, table[i].symbol, symbol_len) == 0) {
+            best = symbol_len;
+            best_index = i;
+        }
+    }
+
+    if (best_index >= 0) {
+        *id = table[best_index].id;
+    }
+
+    return best;
+}
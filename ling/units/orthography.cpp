@@ -0,0 +1,455 @@
+#include "orthography.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static std::vector<std::string> split_spaces(const std::string& str) {
+    std::vector<std::string> tokens;
+    std::stringstream ss(str);
+    std::string token;
+
+    while (ss >> token) {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+Orthography::Orthography(const Inventory& inventory) : ids(inventory.get_ids()) {
+    // Every phoneme is written as its symbol until it gets a spelling
+    spelling_offsets.push_back(0);
+
+    for (int i = 0; i < inventory.size(); i++) {
+        spellings += inventory.get_symbol(i);
+        spelling_offsets.push_back(spellings.size());
+    }
+
+    slot_shift = 32 - 2;
+
+    while ((1u << (32 - slot_shift)) < 4 * ids.size()) {
+        slot_shift--;
+    }
+
+    slot_ids.assign(1u << (32 - slot_shift), 0);
+    slot_indices.assign(slot_ids.size(), -1);
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        unsigned int slot = (ids[i] * 0x9e3779b1u) >> slot_shift;
+
+        while (slot_indices[slot] >= 0) {
+            slot = (slot + 1) & (slot_ids.size() - 1);
+        }
+
+        slot_ids[slot] = ids[i];
+        slot_indices[slot] = i;
+    }
+
+    add_node();
+}
+
+int Orthography::add_node() {
+    transitions.resize(transitions.size() + 256, 0);
+    accepts.push_back(std::vector<int>());
+    fixed.push_back(-1);
+
+    return accepts.size() - 1;
+}
+
+bool Orthography::load(std::string name, const Inventory& inventory) {
+    std::ifstream file("langs/" + name + "/orthography.csv");
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    std::string line;
+    getline(file, line); // Ignore header
+
+    while (getline(file, line)) {
+        std::vector<std::string> tokens;
+        std::stringstream ss(line);
+        std::string token;
+
+        while (getline(ss, token, ',')) {
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() < 2) {
+            std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            continue;
+        }
+
+        std::vector<unsigned int> word;
+
+        if (inventory.tokenize(tokens[1], word)) {
+            std::cerr << "The phonemes /" << tokens[1] << "/ are not in the inventory\n";
+            continue;
+        }
+
+        std::vector<std::string> before = tokens.size() > 2 ? split_spaces(tokens[2]) : std::vector<std::string>();
+        std::vector<std::string> after = tokens.size() > 3 ? split_spaces(tokens[3]) : std::vector<std::string>();
+
+        if (add(tokens[0], word, before, after)) {
+            std::cerr << "Could not add the spelling '" << tokens[0] << "'\n";
+        }
+    }
+
+    return false;
+}
+
+bool Orthography::add(const std::string& spelling, const std::vector<unsigned int>& word,
+                      const std::vector<std::string>& before, const std::vector<std::string>& after) {
+
+    if (spelling.empty() || word.empty()) {
+        return true;
+    }
+
+    for (auto const& id: word) {
+        if (!std::binary_search(ids.begin(), ids.end(), id)) {
+            return true;
+        }
+    }
+
+    int node = 0;
+
+    for (auto const& c: spelling) {
+        size_t transition = node * 256 + static_cast<unsigned char>(c);
+
+        if (transitions[transition] == 0) {
+            int child = add_node();
+            transitions[transition] = child;
+        }
+
+        node = transitions[transition];
+    }
+
+    int index = entries.size();
+    bool has_context = !before.empty() || !after.empty();
+
+    entries.push_back(Entry{before, after, static_cast<uint32_t>(phonemes.size()),
+                            static_cast<uint32_t>(word.size()), has_context});
+    phonemes.insert(phonemes.end(), word.begin(), word.end());
+    max_length = std::max(max_length, spelling.size());
+
+    // Spellings with a context are tried before those without
+    std::vector<int>& candidates = accepts[node];
+
+    if (has_context) {
+        auto it = std::find_if(candidates.begin(), candidates.end(), [this](int e) {
+            return !entries[e].has_context;
+        });
+
+        candidates.insert(it, index);
+    } else {
+        candidates.push_back(index);
+    }
+
+    // Without a context in front, the first candidate always wins
+    fixed[node] = entries[candidates[0]].has_context ? -1 : candidates[0];
+
+    // The first spelling of a phoneme on its own is how it is written
+    if (has_context || word.size() != 1) {
+        return false;
+    }
+
+    for (int e = 0; e < index; e++) {
+        const Entry& other = entries[e];
+
+        if (other.length == 1 && phonemes[other.phonemes] == word[0] && !other.has_context) {
+            return false;
+        }
+    }
+
+    // Rebuild the flat table with the new spelling
+    int target = std::lower_bound(ids.begin(), ids.end(), word[0]) - ids.begin();
+    std::string rebuilt;
+    std::vector<uint32_t> offsets(1, 0);
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (static_cast<int>(i) == target) {
+            rebuilt += spelling;
+        } else {
+            rebuilt.append(spellings, spelling_offsets[i], spelling_offsets[i + 1] - spelling_offsets[i]);
+        }
+
+        offsets.push_back(rebuilt.size());
+    }
+
+    spellings.swap(rebuilt);
+    spelling_offsets.swap(offsets);
+
+    return false;
+}
+
+void Orthography::write(const unsigned int* word, int len, std::string& output) const {
+    for (int i = 0; i < len; i++) {
+        int index = index_of(word[i]);
+
+        if (index >= 0) {
+            output.append(spellings, spelling_offsets[index], spelling_offsets[index + 1] - spelling_offsets[index]);
+        }
+    }
+}
+
+void Orthography::write(const WordList& words, std::string& output, char separator, int threads) const {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    size_t chunks = std::min<size_t>(threads, words.get_ids().size() / ORTHOGRAPHY_CHUNK + 1);
+
+    if (chunks == 1) {
+        write_words(words, 0, words.size(), output, separator);
+        return;
+    }
+
+    std::vector<std::string> parts(chunks);
+
+    parallel_batches(words.size(), chunks, [&](size_t begin, size_t end, int batch) {
+        write_words(words, begin, end, parts[batch], separator);
+    });
+
+    size_t size = output.size();
+
+    for (auto const& part: parts) {
+        size += part.size();
+    }
+
+    output.reserve(size);
+
+    for (auto const& part: parts) {
+        output += part;
+    }
+}
+
+void Orthography::write_words(const WordList& words, unsigned int begin, unsigned int end,
+                              std::string& output, char separator) const {
+    // Grow the output once to an upper bound, then copy without checks
+    size_t longest = 0;
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        longest = std::max<size_t>(longest, spelling_offsets[i + 1] - spelling_offsets[i]);
+    }
+
+    size_t start = output.size();
+    size_t count = (end > begin ? words.get(end - 1) + words.length(end - 1) - words.get(begin) : 0);
+    output.resize(start + count * longest + (end - begin));
+
+    // Stores through char* may alias any member, so read everything through locals
+    char* out = &output[start];
+    const char* table = spellings.data();
+    const uint32_t* offsets = spelling_offsets.data();
+    const unsigned int* table_ids = slot_ids.data();
+    const int* table_indices = slot_indices.data();
+    const unsigned int mask = slot_ids.size() - 1;
+    const unsigned int shift = slot_shift;
+
+    const unsigned int* word = words.get(begin);
+
+    for (unsigned int w = begin; w < end; w++) {
+        const unsigned int* word_end = word + words.length(w);
+
+        for (; word < word_end; word++) {
+            unsigned int slot = (*word * 0x9e3779b1u) >> shift;
+
+            while (table_indices[slot] >= 0 && table_ids[slot] != *word) {
+                slot = (slot + 1) & mask;
+            }
+
+            int index = table_indices[slot];
+
+            if (index < 0) {
+                continue;
+            }
+
+            // Spellings are a few bytes, a loop beats a call to memcpy
+            for (uint32_t j = offsets[index]; j < offsets[index + 1]; j++) {
+                *out++ = table[j];
+            }
+        }
+
+        *out++ = separator;
+    }
+
+    output.resize(out - output.data());
+}
+
+bool Orthography::holds(const Entry& entry, const char* word, const char* word_end,
+                        const char* begin, const char* end) const {
+
+    if (!entry.before.empty()) {
+        bool found = false;
+
+        for (auto const& context: entry.before) {
+            if (context == "#" ? begin == word
+                : static_cast<size_t>(begin - word) >= context.size()
+                  && std::memcmp(begin - context.size(), context.data(), context.size()) == 0) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    if (!entry.after.empty()) {
+        for (auto const& context: entry.after) {
+            if (context == "#" ? end == word_end
+                : static_cast<size_t>(word_end - end) >= context.size()
+                  && std::memcmp(end, context.data(), context.size()) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+size_t Orthography::read(const char* text, size_t len, WordList& words, int threads) const {
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    size_t chunks = std::min<size_t>(threads, len / ORTHOGRAPHY_CHUNK + 1);
+
+    if (chunks == 1) {
+        return read_words(text, text + len, words);
+    }
+
+    // Chunks end at whitespace so no word is split between two threads
+    std::vector<const char*> bounds(chunks + 1, text + len);
+    bounds[0] = text;
+
+    for (size_t c = 1; c < chunks; c++) {
+        const char* bound = std::max(bounds[c - 1], text + len / chunks * c);
+
+        while (bound < text + len && !is_space(*bound)) {
+            bound++;
+        }
+
+        bounds[c] = bound;
+    }
+
+    std::vector<WordList> lists(chunks);
+    std::vector<size_t> skipped(chunks);
+
+    parallel_batches(chunks, chunks, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; c++) {
+            skipped[c] = read_words(bounds[c], bounds[c + 1], lists[c]);
+        }
+    });
+
+    size_t total = 0;
+
+    for (size_t c = 0; c < chunks; c++) {
+        words.append(lists[c]);
+        total += skipped[c];
+    }
+
+    return total;
+}
+
+size_t Orthography::read_words(const char* text, const char* end, WordList& words) const {
+    const char* position = text;
+    size_t skipped = 0;
+
+    std::vector<unsigned int> word;
+    std::vector<int> matched(max_length + 1);   // Node reached at each depth
+
+    while (position < end) {
+        while (position < end && is_space(*position)) {
+            position++;
+        }
+
+        const char* word_begin = position;
+
+        while (position < end && !is_space(*position)) {
+            position++;
+        }
+
+        const char* word_end = position;
+        const char* cur = word_begin;
+
+        word.clear();
+
+        while (cur < word_end) {
+            // Walk the trie as far as the text allows
+            int node = 0;
+            size_t depth = 0;
+
+            while (cur + depth < word_end) {
+                node = transitions[node * 256 + static_cast<unsigned char>(cur[depth])];
+
+                if (node == 0) {
+                    break;
+                }
+
+                matched[++depth] = node;
+            }
+
+            // Take the longest spelling whose context holds
+            const Entry* chosen = nullptr;
+            size_t length = depth;
+
+            for (; length > 0; length--) {
+                node = matched[length];
+
+                if (fixed[node] >= 0) {
+                    chosen = &entries[fixed[node]];
+                    break;
+                }
+
+                for (auto const& e: accepts[node]) {
+                    const Entry& entry = entries[e];
+
+                    if (!entry.has_context || holds(entry, word_begin, word_end, cur, cur + length)) {
+                        chosen = &entry;
+                        break;
+                    }
+                }
+
+                if (chosen != nullptr) {
+                    break;
+                }
+            }
+
+            if (chosen == nullptr) {
+                // Skip a whole UTF-8 character
+                size_t size = 1;
+
+                while (cur + size < word_end && (static_cast<unsigned char>(cur[size]) & 0xc0) == 0x80) {
+                    size++;
+                }
+
+                skipped += size;
+                cur += size;
+                continue;
+            }
+
+            for (uint32_t i = 0; i < chosen->length; i++) {
+                word.push_back(phonemes[chosen->phonemes + i]);
+            }
+
+            cur += length;
+        }
+
+        // A word nothing could be read from stays as an empty word, so words line up with the text
+        if (word_begin < word_end) {
+            words.add(word);
+        }
+    }
+
+    return skipped;
+}
@@ -17,3 +17,22 @@ std::string Phoneme::get_voi_as_str(Voicing voicing) const {
 
     return str;
 }
+
+bool in_class(unsigned int id, unsigned int phon_class) {
+
+    // Check every digit, including the type in the lowest digit
+    for (int i = 0; i < 32; i += 4) {
+        unsigned long int place = 1UL << i;
+        unsigned int class_digit = (phon_class % (place * 0x10)) / place;
+
+        if (class_digit != 0x0) {
+            unsigned int id_digit = (id % (place * 0x10)) / place;
+
+            if (id_digit != class_digit) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
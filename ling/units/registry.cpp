@@ -0,0 +1,321 @@
+#include "registry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "soundsystem.h"
+#include "parallel.h"
+
+// Record keys are the hex ID followed by the symbol, which never contains a space
+static std::string record_key(unsigned int id, const std::string& symbol) {
+    char hex[12];
+    snprintf(hex, sizeof(hex), "%x ", id);
+    return hex + symbol;
+}
+
+// Slot of the next thread that reads a registry
+static std::atomic<unsigned int> next_slot(0);
+
+Registry::ReadSection::ReadSection(const Registry& registry) {
+    static thread_local unsigned int slot = next_slot++ % REGISTRY_READER_SLOTS;
+
+    // Retry if a writer moved to the next epoch before the reader was counted in this one
+    while (true) {
+        unsigned long epoch = registry.epoch.load();
+        counter = &registry.slots[slot].readers[epoch & 1];
+        counter->fetch_add(1);
+
+        if (registry.epoch.load() == epoch) {
+            break;
+        }
+
+        counter->fetch_sub(1, std::memory_order_release);
+    }
+
+    table = registry.table.load(std::memory_order_acquire);
+}
+
+Registry::Registry() : table(new Table()), epoch(0), version(0) {
+    for (auto& slot: slots) {
+        slot.readers[0].store(0);
+        slot.readers[1].store(0);
+    }
+}
+
+Registry::~Registry() {
+    delete table.load();
+}
+
+void Registry::publish(const Table* new_table) {
+    const Table* old_table = table.exchange(new_table);
+    unsigned long parity = epoch.fetch_add(1) & 1;
+
+    // Readers that can still hold the old table counted themselves in the previous epoch
+    for (auto const& slot: slots) {
+        while (slot.readers[parity].load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    delete old_table;
+    version.fetch_add(1, std::memory_order_release);
+}
+
+const Phoneme* Language::find(unsigned int id) const {
+    auto it = std::lower_bound(phonemes.begin(), phonemes.end(), id,
+        [](const std::shared_ptr<const Phoneme>& phon, unsigned int id) {
+            return phon->get_id() < id;
+        });
+
+    if (it == phonemes.end() || (*it)->get_id() != id) {
+        return nullptr;
+    }
+
+    return it->get();
+}
+
+std::shared_ptr<const Phoneme> Registry::intern(const std::string& key, const Phoneme& phoneme) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<const Phoneme> record = records[key].lock();
+
+    if (!record) {
+        if (phoneme.get_type() == Type::consonant) {
+            record = std::make_shared<Consonant>(static_cast<const Consonant&>(phoneme));
+        } else {
+            record = std::make_shared<Vowel>(static_cast<const Vowel&>(phoneme));
+        }
+
+        records[key] = record;
+    }
+
+    return record;
+}
+
+std::shared_ptr<const Language> Registry::read_language(const std::string& name) {
+    SoundSystem sound_system(name);
+
+    if (sound_system.load()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<Language> language = std::make_shared<Language>(name);
+    const std::map<unsigned int, Consonant>& consonants = sound_system.get_consonants();
+    const std::map<unsigned int, Vowel>& vowels = sound_system.get_vowels();
+
+    // Every key, in ID order, identifies the inventory
+    std::vector<std::pair<unsigned int, std::string>> keys;
+
+    for (auto const& phon: consonants) {
+        keys.push_back(std::make_pair(phon.first, record_key(phon.first, phon.second.get_symbol())));
+        language->phonemes.push_back(intern(keys.back().second, phon.second));
+    }
+
+    for (auto const& phon: vowels) {
+        keys.push_back(std::make_pair(phon.first, record_key(phon.first, phon.second.get_symbol())));
+        language->phonemes.push_back(intern(keys.back().second, phon.second));
+    }
+
+    std::sort(language->phonemes.begin(), language->phonemes.end(),
+        [](const std::shared_ptr<const Phoneme>& a, const std::shared_ptr<const Phoneme>& b) {
+            return a->get_id() < b->get_id();
+        });
+
+    // Marks are compiled into the inventory too
+    for (auto const& supra: sound_system.get_suprasegmentals()) {
+        keys.push_back(std::make_pair(supra.first, record_key(supra.first, supra.second.get_symbol())));
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::string fingerprint;
+
+    for (auto const& key: keys) {
+        fingerprint += key.second;
+        fingerprint += ',';
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        language->inventory = inventories[fingerprint].lock();
+    }
+
+    // Compile outside the lock. If another thread compiled the same inventory
+    // in the meantime, use theirs.
+    if (!language->inventory) {
+        std::shared_ptr<const Inventory> inventory = std::make_shared<Inventory>(sound_system);
+        std::lock_guard<std::mutex> lock(mutex);
+
+        language->inventory = inventories[fingerprint].lock();
+
+        if (!language->inventory) {
+            inventories[fingerprint] = inventory;
+            language->inventory = inventory;
+        }
+    }
+
+    // Phonotactics are optional
+    std::shared_ptr<Phonotactics> phonotactics = std::make_shared<Phonotactics>(name);
+
+    if (!phonotactics->load()) {
+        language->phonotactics = phonotactics;
+    }
+
+    // So are rules, a language without them derives every word unchanged
+    std::vector<Rule> rules;
+    load_rules("langs/" + name + "/phonology/rules.csv", rules);
+    language->cascade = std::make_shared<Cascade>(*language->inventory, rules);
+
+    return language;
+}
+
+bool Registry::load(std::string name) {
+    std::shared_ptr<const Language> language = read_language(name);
+
+    if (!language) {
+        std::cerr << "Failed to load the language " << name << "\n";
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        Table* new_table = new Table(*table.load());
+
+        (*new_table)[name] = language;
+        publish(new_table);
+    }
+
+    // The replaced language went with the old table, unless a reader still holds it
+    purge();
+
+    return false;
+}
+
+bool Registry::reload(std::string name) {
+    if (!get(name)) {
+        return true;
+    }
+
+    std::shared_ptr<const Language> language = read_language(name);
+
+    if (!language) {
+        std::cerr << "Failed to reload the language " << name << "\n";
+        return true;
+    }
+
+    bool loaded;
+
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        loaded = table.load()->count(name) != 0;
+
+        if (loaded) {
+            Table* new_table = new Table(*table.load());
+
+            (*new_table)[name] = language;
+            publish(new_table);
+        }
+    }
+
+    // Records of the replaced version, or of the one read for nothing
+    language.reset();
+    purge();
+
+    return !loaded;
+}
+
+int Registry::load(const std::vector<std::string>& names, int threads) {
+    std::atomic<size_t> next(0);
+    std::atomic<int> failed(0);
+
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+
+    // Languages differ in size, so every thread takes the next name when it is done
+    parallel_batches(names.size(), threads, [&](size_t, size_t, int) {
+        size_t i;
+
+        while ((i = next++) < names.size()) {
+            if (load(names[i])) {
+                failed++;
+            }
+        }
+    });
+
+    return failed;
+}
+
+bool Registry::unload(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+
+        if (table.load()->count(name) == 0) {
+            return true;
+        }
+
+        Table* new_table = new Table(*table.load());
+
+        new_table->erase(name);
+        publish(new_table);
+    }
+
+    purge();
+
+    return false;
+}
+
+void Registry::purge() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = records.begin(); it != records.end();) {
+        it = it->second.expired() ? records.erase(it) : std::next(it);
+    }
+
+    for (auto it = inventories.begin(); it != inventories.end();) {
+        it = it->second.expired() ? inventories.erase(it) : std::next(it);
+    }
+}
+
+std::shared_ptr<const Language> Registry::get(const std::string& name) const {
+    ReadSection section(*this);
+    auto it = section.table->find(name);
+
+    return it == section.table->end() ? nullptr : it->second;
+}
+
+std::vector<std::string> Registry::get_names() const {
+    ReadSection section(*this);
+    std::vector<std::string> names;
+
+    for (auto const& language: *section.table) {
+        names.push_back(language.first);
+    }
+
+    return names;
+}
+
+size_t Registry::get_record_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+
+    for (auto const& record: records) {
+        count += !record.second.expired();
+    }
+
+    return count;
+}
+
+size_t Registry::get_inventory_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+
+    for (auto const& inventory: inventories) {
+        count += !inventory.second.expired();
+    }
+
+    return count;
+}
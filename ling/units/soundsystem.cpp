@@ -1,4 +1,6 @@
 #include "soundsystem.h"
+#include "metrics.h"
+#include "ipa.h"
 
 #include <iostream>
 #include <fstream>
@@ -15,6 +17,7 @@ bool SoundSystem::is_valid_symbol(std::string str) const {
 }
 
 bool SoundSystem::save() {
+    LING_TIME(write_output);
 
     // Do not overwrite file if the soundsystem no longer contains phonemes
     if (consonants.size() == 0 || vowels.size() == 0) {
@@ -45,13 +48,36 @@ bool SoundSystem::save() {
                 << std::hex << phon.second.get_id() << "\n";
     }
 
+    LING_COUNT(bytes_written, metrics::stream_bytes(f_consonants) + metrics::stream_bytes(f_vowels));
+
     f_consonants.close();
     f_vowels.close();
 
+    // Save suprasegmentals, only if the language has any
+    if (suprasegmentals.size() > 0) {
+        std::ofstream f_suprasegmentals("langs/" + name + "/units/suprasegmentals.csv");
+
+        if (!f_suprasegmentals.is_open()) {
+            return true;
+        }
+
+        f_suprasegmentals << "symbol,id\n";
+
+        for (auto const& supra: suprasegmentals) {
+            f_suprasegmentals << supra.second.get_symbol() << ","
+                              << std::hex << supra.second.get_id() << "\n";
+        }
+
+        LING_COUNT(bytes_written, metrics::stream_bytes(f_suprasegmentals));
+        f_suprasegmentals.close();
+    }
+
     return false;
 }
 
 bool SoundSystem::load() {
+    LING_TIME(load_csv);
+
     // Open all files
     std::ifstream f_consonants("langs/" + name + "/units/consonants.csv");
     std::ifstream f_vowels("langs/" + name + "/units/vowels.csv");
@@ -68,6 +94,14 @@ bool SoundSystem::load() {
     f_consonants.close();
     f_vowels.close();
 
+    // Suprasegmentals are optional
+    std::ifstream f_suprasegmentals("langs/" + name + "/units/suprasegmentals.csv");
+
+    if (f_suprasegmentals.is_open()) {
+        read_file(f_suprasegmentals, 3);
+        f_suprasegmentals.close();
+    }
+
     return false;
 }
 
@@ -75,8 +109,8 @@ void SoundSystem::read_file(std::ifstream& file, int type) {
     std::string line;
     bool isFirstLine = true;
 
-    // Check if type passed in is valid (1-2 inclusive)
-    if (type < 1 || type > 2) {
+    // Check if type passed in is valid (1-3 inclusive)
+    if (type < 1 || type > 3) {
         std::cerr << "Failed to traverse file, given type: " << type << "\n";
         return;
     }
@@ -99,41 +133,84 @@ void SoundSystem::read_file(std::ifstream& file, int type) {
 
         /*
          * Check if the line has the correct amount of values.
-         * Each file has at least 2 arguments per line.
+         * Each line has a symbol, an id or both. Standard IPA phonemes can
+         * leave out either one, the other is taken from the IPA table.
          * Extra values will be ignored and eventually deleted when writing over the file.
          */
-        if (tokens.size() < 2) {
+        if (tokens.size() < 1 || (tokens[0].empty() && (tokens.size() < 2 || tokens[1].empty()))) {
             std::cerr << "Invalid amount of values: " << tokens.size() << "\n";
+            LING_COUNT(phonemes_rejected, 1);
             continue; // Skip to next line
         }
 
-        // Check if the phoneme symbol is valid. If not, do not attempt to insert it.
-        if (is_valid_symbol(tokens[0]) == false) {
-            std::cerr << "The symbol [" << tokens[0] << "] is invalid\n";
-            continue; // Skip to next line
+        std::string symbol = tokens[0];
+        unsigned int id;
+
+        if (tokens.size() < 2 || tokens[1].empty()) {
+            const IpaEntry* entry = Ipa::find(symbol);
+
+            if (entry == nullptr) {
+                std::cerr << "The symbol [" << symbol << "] is not in the IPA table and needs an id\n";
+                LING_COUNT(phonemes_rejected, 1);
+                continue; // Skip to next line
+            }
+
+            id = entry->id;
+        } else {
+            // Try to convert id from string to unsigned int
+            try {
+                id = std::stoi(tokens[1], nullptr, 16);
+            } catch (...) {
+                std::cerr << "Failed to convert '" << tokens[1] << "' into an integer id\n";
+                LING_COUNT(phonemes_rejected, 1);
+                continue; // Skip to next line
+            }
+
+            if (symbol.empty()) {
+                const IpaEntry* entry = Ipa::find(id);
+
+                if (entry == nullptr) {
+                    std::cerr << "The id " << std::hex << id << std::dec << " is not in the IPA table and needs a symbol\n";
+                    LING_COUNT(phonemes_rejected, 1);
+                    continue; // Skip to next line
+                }
+
+                symbol = entry->symbol;
+            }
         }
 
-        // Try to convert id from string to unsigned int
-        unsigned int id;
-        try {
-            id = std::stoi(tokens[1], nullptr, 16);
-        } catch (...) {
-            std::cerr << "Failed to convert '" << tokens[1] << "' into an integer id\n";
+        // Check if the phoneme symbol is valid. If not, do not attempt to insert it.
+        if (is_valid_symbol(symbol) == false) {
+            std::cerr << "The symbol [" << symbol << "] is invalid\n";
+            LING_COUNT(phonemes_rejected, 1);
             continue; // Skip to next line
         }
 
         // Insert based on type
         if (type == 1) {
-            if (insert_consonant(tokens[0], id)) {
-                std::cerr << "Could not add the consonant [" << tokens[0]
+            if (insert_consonant(symbol, id)) {
+                std::cerr << "Could not add the consonant [" << symbol
                           << "] with id " << std::hex << id << "\n";
+                LING_COUNT(phonemes_rejected, 1);
+                continue;
+            }
+        } else if (type == 2) {
+            if (insert_vowel(symbol, id)) {
+                std::cerr << "Could not add the vowel [" << symbol
+                          << "] with id " << std::hex << id << "\n";
+                LING_COUNT(phonemes_rejected, 1);
+                continue;
             }
         } else {
-            if (insert_vowel(tokens[0], id)) {
-                std::cerr << "Could not add the vowel [" << tokens[0]
+            if (insert_suprasegmental(symbol, id)) {
+                std::cerr << "Could not add the suprasegmental [" << symbol
                           << "] with id " << std::hex << id << "\n";
+                LING_COUNT(phonemes_rejected, 1);
+                continue;
             }
         }
+
+        LING_COUNT(phonemes_loaded, 1);
     }
 }
 
@@ -210,3 +287,33 @@ bool SoundSystem::insert_vowel(std::string symbol, unsigned int id) {
         return true;
     }
 }
+
+bool SoundSystem::insert_suprasegmental(std::string symbol, unsigned int id) {
+
+    // Check if suprasegmental id
+    if (id % 0x10 != static_cast<int>(Type::suprasegmental)) {
+        return true;
+    }
+
+    // Get fields from id
+    Tier tier = static_cast<Tier>(id % 0x100 / 0x10);
+    unsigned int value = id % 0x1000 / 0x100;
+
+    // Highest value of each tier: tones, stresses and lengths
+    static const unsigned int max_values[NUM_TIERS] = {5, 2, 4};
+
+    // Insert only if id is valid
+    if (id < 0x1000 && tier >= Tier::tone && tier <= Tier::length
+        && value >= 1 && value <= max_values[static_cast<int>(tier) - 1]) {
+
+        // Insert Suprasegmental
+        Suprasegmental supra(symbol, tier, value);
+
+        suprasegmentals.insert(std::pair<unsigned int, Suprasegmental>(id, supra));
+        ids.insert(std::pair<std::string, unsigned int>(symbol, id));
+
+        return false;
+    } else {
+        return true;
+    }
+}
@@ -0,0 +1,31 @@
+#include "suprasegmental.h"
+#include "phoneme.h"
+
+/*
+ * Calculate Suprasegmental ID
+ *
+ * FORMAT
+ *  Index:   |0-4   |5    |6   |7
+ *  Feature: |Unused|Value|Tier|Type
+ */
+
+unsigned int Suprasegmental::calc_id() const {
+    return (value * 0x100) + (static_cast<int>(tier) * 0x10) + static_cast<int>(Type::suprasegmental);
+}
+
+std::string Suprasegmental::update_desc() const {
+    static const char* tones[] = {"Extra-Low", "Low", "Mid", "High", "Extra-High"};
+    static const char* stresses[] = {"Primary", "Secondary"};
+    static const char* lengths[] = {"Extra-Short", "Short", "Half-Long", "Long"};
+
+    switch (tier) {
+        case Tier::tone:
+            return value >= 1 && value <= 5 ? std::string(tones[value - 1]) + " Tone" : "Tone";
+        case Tier::stress:
+            return value >= 1 && value <= 2 ? std::string(stresses[value - 1]) + " Stress" : "Stress";
+        case Tier::length:
+            return value >= 1 && value <= 4 ? std::string(lengths[value - 1]) + " Length" : "Length";
+        default:
+            return "";
+    }
+}
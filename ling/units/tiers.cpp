@@ -0,0 +1,81 @@
+#include "tiers.h"
+
+#include <algorithm>
+
+static bool starts_before(size_t position, const Tiers::Run& run) {
+    return position < run.start;
+}
+
+Tiers::Cursor::Cursor(const Tiers& tiers, Tier tier, size_t position)
+    : runs(&tiers.get_runs(tier)), position(position), current(0) {
+
+    // First run starting after the position
+    run = std::upper_bound(runs->begin(), runs->end(), position, starts_before) - runs->begin();
+
+    if (run > 0) {
+        current = (*runs)[run - 1].value;
+    }
+}
+
+unsigned int Tiers::get(Tier tier, size_t position) const {
+    const std::vector<Run>& tier_runs = runs[index(tier)];
+    auto it = std::upper_bound(tier_runs.begin(), tier_runs.end(), position, starts_before);
+
+    return it == tier_runs.begin() ? 0 : (it - 1)->value;
+}
+
+void Tiers::set(Tier tier, size_t begin, size_t end, unsigned int value) {
+    if (begin >= end) {
+        return;
+    }
+
+    std::vector<Run>& tier_runs = runs[index(tier)];
+    unsigned int before = begin > 0 ? get(tier, begin - 1) : 0;
+    unsigned int after = get(tier, end);
+
+    // Replace every run starting inside [begin, end]. The run after them
+    // already differs from the value at end, so it never needs merging.
+    auto first = std::lower_bound(tier_runs.begin(), tier_runs.end(), begin,
+        [](const Run& run, size_t position) { return run.start < position; });
+    auto last = std::upper_bound(first, tier_runs.end(), end, starts_before);
+
+    Run replacement[2];
+    int count = 0;
+
+    if (value != before) {
+        replacement[count++] = Run{static_cast<unsigned int>(begin), value};
+    }
+
+    if (after != value) {
+        replacement[count++] = Run{static_cast<unsigned int>(end), after};
+    }
+
+    size_t offset = first - tier_runs.begin();
+    tier_runs.erase(first, last);
+    tier_runs.insert(tier_runs.begin() + offset, replacement, replacement + count);
+}
+
+void Tiers::truncate(size_t length) {
+    for (auto& tier_runs: runs) {
+        auto it = std::lower_bound(tier_runs.begin(), tier_runs.end(), length,
+            [](const Run& run, size_t length) { return run.start < length; });
+
+        tier_runs.erase(it, tier_runs.end());
+    }
+}
+
+void Tiers::clear() {
+    for (auto& tier_runs: runs) {
+        tier_runs.clear();
+    }
+}
+
+size_t Tiers::get_memory() const {
+    size_t memory = 0;
+
+    for (auto const& tier_runs: runs) {
+        memory += tier_runs.capacity() * sizeof(Run);
+    }
+
+    return memory;
+}
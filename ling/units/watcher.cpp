@@ -0,0 +1,266 @@
+#include "watcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// Directories of a language whose files are compiled into it
+static const char* watched_dirs[] = {"units", "phonology"};
+
+Watcher::Watcher(Registry& registry, bool polling, int interval)
+    : registry(registry), polling(polling), interval(interval > 0 ? interval : WATCH_INTERVAL),
+      running(false), reloads(0), failures(0) {}
+
+std::map<std::string, Watcher::Stamp> Watcher::scan(const std::string& name) {
+    std::map<std::string, Stamp> stamps;
+
+    for (auto const& dir: watched_dirs) {
+        std::string path = "langs/" + name + "/" + dir;
+        DIR* handle = opendir(path.c_str());
+
+        if (handle == nullptr) {
+            continue;
+        }
+
+        while (dirent* entry = readdir(handle)) {
+            std::string file = path + "/" + entry->d_name;
+            struct stat info;
+
+            if (entry->d_name[0] == '.' || stat(file.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+                continue;
+            }
+
+            int64_t time = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+            stamps[file] = Stamp(time, info.st_size);
+        }
+
+        closedir(handle);
+    }
+
+    return stamps;
+}
+
+void Watcher::touch(Watched& watched) {
+    watched.pending = true;
+    watched.deadline = Clock::now() + std::chrono::milliseconds(WATCH_SETTLE);
+}
+
+void Watcher::sync() {
+    unsigned long version = registry.get_version();
+
+    if (version == synced_version && !languages.empty()) {
+        return;
+    }
+
+    synced_version = version;
+    std::vector<std::string> names = registry.get_names();
+
+    for (auto it = languages.begin(); it != languages.end();) {
+        if (std::binary_search(names.begin(), names.end(), it->first)) {
+            ++it;
+            continue;
+        }
+
+#ifdef __linux__
+        for (auto const& descriptor: it->second.descriptors) {
+            inotify_rm_watch(inotify_fd, descriptor);
+            descriptor_languages.erase(descriptor);
+        }
+#endif
+
+        it = languages.erase(it);
+    }
+
+    for (auto const& name: names) {
+        if (languages.count(name) != 0) {
+            continue;
+        }
+
+        Watched& watched = languages[name];
+
+        if (polling) {
+            watched.stamps = scan(name);
+            continue;
+        }
+
+#ifdef __linux__
+        for (auto const& dir: watched_dirs) {
+            std::string path = "langs/" + name + "/" + dir;
+            int descriptor = inotify_add_watch(inotify_fd, path.c_str(),
+                                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+
+            if (descriptor >= 0) {
+                watched.descriptors.push_back(descriptor);
+                descriptor_languages[descriptor] = name;
+            }
+        }
+#endif
+    }
+}
+
+void Watcher::read_events() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    ssize_t n;
+
+    while ((n = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + n; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+            const inotify_event* event = reinterpret_cast<inotify_event*>(p);
+
+            // Events were dropped, so any language can have changed
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (auto& entry: languages) {
+                    touch(entry.second);
+                }
+
+                continue;
+            }
+
+            auto it = descriptor_languages.find(event->wd);
+
+            if (it == descriptor_languages.end()) {
+                continue;
+            }
+
+            // The directory was removed, no more events come from it
+            if (event->mask & IN_IGNORED) {
+                std::vector<int>& descriptors = languages[it->second].descriptors;
+                descriptors.erase(std::remove(descriptors.begin(), descriptors.end(), event->wd), descriptors.end());
+                descriptor_languages.erase(it);
+                continue;
+            }
+
+            touch(languages[it->second]);
+        }
+    }
+#endif
+}
+
+void Watcher::run() {
+    Clock::time_point next_poll = Clock::now();
+
+    while (running) {
+        sync();
+
+        Clock::time_point now = Clock::now();
+
+        if (polling && now >= next_poll) {
+            for (auto& entry: languages) {
+                std::map<std::string, Stamp> stamps = scan(entry.first);
+
+                if (stamps != entry.second.stamps) {
+                    entry.second.stamps = stamps;
+                    touch(entry.second);
+                }
+            }
+
+            next_poll = now + std::chrono::milliseconds(interval);
+        }
+
+        // Reload the languages that settled, and find when the next one will
+        Clock::time_point wake = now + std::chrono::milliseconds(interval);
+
+        for (auto& entry: languages) {
+            Watched& watched = entry.second;
+
+            if (!watched.pending) {
+                continue;
+            }
+
+            if (watched.deadline > now) {
+                wake = std::min(wake, watched.deadline);
+                continue;
+            }
+
+            // A file still being written when polled has a newer stamp by now
+            if (polling) {
+                std::map<std::string, Stamp> stamps = scan(entry.first);
+
+                if (stamps != watched.stamps) {
+                    watched.stamps = stamps;
+                    touch(watched);
+                    wake = std::min(wake, watched.deadline);
+                    continue;
+                }
+            }
+
+            watched.pending = false;
+
+            // Unloaded since the last sync, which it stays
+            if (!registry.reload(entry.first)) {
+                reloads++;
+            } else if (registry.get(entry.first)) {
+                failures++;
+            }
+        }
+
+        if (polling) {
+            wake = std::min(wake, next_poll);
+        }
+
+        int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(wake - Clock::now()).count();
+        pollfd fds[2] = {{wake_fds[0], POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+
+        if (poll(fds, inotify_fd >= 0 ? 2 : 1, std::max(timeout, 0) + 1) > 0 && (fds[1].revents & POLLIN)) {
+            read_events();
+        }
+    }
+}
+
+bool Watcher::start() {
+    if (running) {
+        return true;
+    }
+
+    if (pipe(wake_fds) != 0) {
+        return true;
+    }
+
+#ifdef __linux__
+    if (!polling) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+#endif
+
+    // Without inotify every change is found by polling
+    if (inotify_fd < 0) {
+        polling = true;
+    }
+
+    languages.clear();
+    descriptor_languages.clear();
+
+    running = true;
+    thread = std::thread(&Watcher::run, this);
+
+    return false;
+}
+
+void Watcher::stop() {
+    if (!running) {
+        return;
+    }
+
+    running = false;
+
+    if (write(wake_fds[1], "", 1) != 1) {
+        std::cerr << "Could not wake the watcher, it stops within " << interval << " ms\n";
+    }
+
+    thread.join();
+
+    for (int* fd: {&inotify_fd, &wake_fds[0], &wake_fds[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
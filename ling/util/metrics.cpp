@@ -0,0 +1,209 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace metrics {
+
+static const char* counter_names[] = {
+    "phonemes_loaded",
+    "phonemes_rejected",
+    "rule_matches",
+    "rule_applications",
+    "rule_blocked",
+    "cache_hits",
+    "cache_misses",
+    "bytes_written"
+};
+
+static const char* timer_names[] = {
+    "load_csv",
+    "parse_json",
+    "apply_rules",
+    "write_output"
+};
+
+/* Written only by its own thread, or under registry_mutex once retired, read by whoever writes the metrics */
+struct Block {
+    std::atomic<uint64_t> counters[static_cast<int>(Counter::count)];
+    std::atomic<uint64_t> nanoseconds[static_cast<int>(Timer::count)];
+    std::atomic<uint64_t> calls[static_cast<int>(Timer::count)];
+
+    Block() {
+        for (auto& counter: counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+
+        for (int i = 0; i < static_cast<int>(Timer::count); i++) {
+            nanoseconds[i].store(0, std::memory_order_relaxed);
+            calls[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+static void increment(std::atomic<uint64_t>& value, uint64_t n) {
+    // Only the owning thread writes, so a plain load and store is enough
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Blocks of running threads, and the sum of the blocks of finished threads.
+// Neither is ever freed, threads can still count while statics are destroyed.
+static std::mutex registry_mutex;
+static std::vector<Block*>& registry() {
+    static std::vector<Block*>* blocks = new std::vector<Block*>();
+    return *blocks;
+}
+
+static Block& retired() {
+    static Block* block = new Block();
+    return *block;
+}
+
+/* Add the counts of a block to the retired ones. Needs registry_mutex. */
+static void fold(const Block& block) {
+    Block& total = retired();
+
+    for (int i = 0; i < static_cast<int>(Counter::count); i++) {
+        increment(total.counters[i], block.counters[i].load(std::memory_order_relaxed));
+    }
+
+    for (int i = 0; i < static_cast<int>(Timer::count); i++) {
+        increment(total.nanoseconds[i], block.nanoseconds[i].load(std::memory_order_relaxed));
+        increment(total.calls[i], block.calls[i].load(std::memory_order_relaxed));
+    }
+}
+
+static thread_local Block* local = nullptr;
+static thread_local bool finished = false;      // The thread's block was already retired
+
+/* Retires the block of its thread when the thread exits, so short lived threads do not pile up */
+struct Owner {
+    ~Owner() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        std::vector<Block*>& blocks = registry();
+
+        fold(*local);
+        blocks.erase(std::find(blocks.begin(), blocks.end(), local));
+        delete local;
+
+        local = nullptr;
+        finished = true;
+    }
+};
+
+/* Block of the calling thread, or nullptr if it was retired and the thread is exiting */
+static Block* local_block() {
+    if (local == nullptr && !finished) {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            local = new Block();
+            registry().push_back(local);
+        }
+
+        static thread_local Owner owner;
+        (void)owner;
+    }
+
+    return local;
+}
+
+void add(Counter counter, uint64_t n) {
+    Block* block = local_block();
+
+    if (block == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        increment(retired().counters[static_cast<int>(counter)], n);
+        return;
+    }
+
+    increment(block->counters[static_cast<int>(counter)], n);
+}
+
+void add_time(Timer timer, uint64_t nanoseconds) {
+    Block* block = local_block();
+    std::unique_lock<std::mutex> lock;
+
+    if (block == nullptr) {
+        lock = std::unique_lock<std::mutex>(registry_mutex);
+        block = &retired();
+    }
+
+    increment(block->nanoseconds[static_cast<int>(timer)], nanoseconds);
+    increment(block->calls[static_cast<int>(timer)], 1);
+}
+
+void write_json(std::ostream& output) {
+    uint64_t counters[static_cast<int>(Counter::count)] = {0};
+    uint64_t nanoseconds[static_cast<int>(Timer::count)] = {0};
+    uint64_t calls[static_cast<int>(Timer::count)] = {0};
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        std::vector<const Block*> blocks(registry().begin(), registry().end());
+
+        blocks.push_back(&retired());
+
+        for (auto const& block: blocks) {
+            for (int i = 0; i < static_cast<int>(Counter::count); i++) {
+                counters[i] += block->counters[i].load(std::memory_order_relaxed);
+            }
+
+            for (int i = 0; i < static_cast<int>(Timer::count); i++) {
+                nanoseconds[i] += block->nanoseconds[i].load(std::memory_order_relaxed);
+                calls[i] += block->calls[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+#ifdef LING_METRICS
+    output << "{\n    \"enabled\": true,\n    \"counters\": {\n";
+#else
+    output << "{\n    \"enabled\": false,\n    \"counters\": {\n";
+#endif
+
+    for (int i = 0; i < static_cast<int>(Counter::count); i++) {
+        output << "        \"" << counter_names[i] << "\": " << counters[i]
+               << (i + 1 < static_cast<int>(Counter::count) ? ",\n" : "\n");
+    }
+
+    output << "    },\n    \"timers\": {\n";
+
+    for (int i = 0; i < static_cast<int>(Timer::count); i++) {
+        output << "        \"" << timer_names[i] << "\": {\"calls\": " << calls[i]
+               << ", \"seconds\": " << nanoseconds[i] / 1e9 << "}"
+               << (i + 1 < static_cast<int>(Timer::count) ? ",\n" : "\n");
+    }
+
+    output << "    }\n}\n";
+}
+
+static void write_at_exit() {
+    write_json(std::cerr);
+}
+
+void enable_stats(int& argc, char* argv[]) {
+    int kept = 1;
+    bool enabled = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--stats") == 0) {
+            enabled = true;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+
+    argc = kept;
+    argv[argc] = nullptr;
+
+    if (enabled) {
+        std::atexit(write_at_exit);
+    }
+}
+
+}
@@ -0,0 +1,238 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace trace {
+
+static_assert(sizeof(Event) == 16, "events are written to files as they are in memory");
+
+std::atomic<bool> enabled_flag(false);
+
+// Changed only by enable() while no other thread derives words
+static Settings settings;
+uint64_t sample_below = 1ull << 32;
+uint32_t sample_word = TRACE_ANY;
+
+thread_local bool traced_flag = false;
+thread_local bool active_flag = false;
+
+/* Two relaxed atomics per event, so a ring can be read while its thread writes */
+struct Slot {
+    std::atomic<uint64_t> key;          // word << 32 | rule << 16 | position
+    std::atomic<uint64_t> change;       // from << 32 | to
+};
+
+/*
+ * Event i is in slot i & mask. Before a slot is written claimed is raised
+ * past the event, and once it is written head is, so a reader that copied
+ * a slot and then sees claimed beyond the slot's next event knows the copy
+ * may be torn.
+ */
+struct Ring {
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<uint64_t> head;         // Events written so far
+    std::atomic<uint64_t> claimed;      // Events written or being written
+
+    Ring(size_t capacity) { reset(capacity); }
+
+    void reset(size_t capacity) {
+        slots.reset(new Slot[capacity]);
+        mask = capacity - 1;
+        head.store(0, std::memory_order_relaxed);
+        claimed.store(0, std::memory_order_relaxed);
+    }
+};
+
+/* Ring and word of a thread, the flags are traced_flag and active_flag */
+struct Context {
+    Ring* ring = nullptr;
+    uint32_t word = 0;
+    uint32_t rule = 0;
+};
+
+// Rings outlive their threads so events from finished threads are kept
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<Ring>>& registry() {
+    static std::vector<std::unique_ptr<Ring>>* rings = new std::vector<std::unique_ptr<Ring>>();
+    return *rings;
+}
+
+static Context& local_context() {
+    static thread_local Context context;
+    return context;
+}
+
+static size_t round_capacity(size_t capacity) {
+    size_t rounded = 1;
+
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+
+    return rounded;
+}
+
+static void push(Context& context, uint32_t rule, int position, uint32_t from, uint32_t to) {
+    if (context.ring == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry().push_back(std::unique_ptr<Ring>(new Ring(round_capacity(settings.capacity))));
+        context.ring = registry().back().get();
+    }
+
+    Ring& ring = *context.ring;
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[head & ring.mask];
+
+    // The claim is visible to any reader that sees part of the new event
+    ring.claimed.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.key.store(static_cast<uint64_t>(context.word) << 32 | rule << 16 | static_cast<uint32_t>(position),
+                   std::memory_order_relaxed);
+    slot.change.store(static_cast<uint64_t>(from) << 32 | to, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void enable(const Settings& new_settings) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    settings = new_settings;
+
+    sample_below = (1ull << 32) / std::max<uint32_t>(settings.sample, 1);
+    sample_word = settings.word;
+
+    for (auto& ring: registry()) {
+        ring->reset(round_capacity(settings.capacity));
+    }
+
+    enabled_flag.store(true, std::memory_order_release);
+}
+
+void disable() {
+    enabled_flag.store(false, std::memory_order_release);
+}
+
+bool start_word(uint32_t handle, const unsigned int* word, int len, int rule) {
+    Context& context = local_context();
+
+    traced_flag = true;
+    context.word = handle;
+
+    // Positions past 16 bits are not recorded
+    for (int i = 0; i < len && i <= 0xffff; i++) {
+        push(context, TRACE_INPUT, i, word[i], rule);
+    }
+
+    set_rule(rule);
+    return true;
+}
+
+void end_word() {
+    traced_flag = false;
+    active_flag = false;
+}
+
+void set_rule(int rule) {
+    local_context().rule = rule;
+    active_flag = traced_flag && rule >= 0 && rule < TRACE_INPUT
+               && (settings.rule == TRACE_ANY || static_cast<uint32_t>(rule) == settings.rule);
+}
+
+void change(int position, unsigned int from, unsigned int to) {
+    Context& context = local_context();
+
+    if (active_flag && position <= 0xffff) {
+        push(context, context.rule, position, from, to);
+    }
+}
+
+std::vector<std::vector<Event>> collect() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::vector<std::vector<Event>> threads;
+
+    for (auto const& ring: registry()) {
+        size_t capacity = ring->mask + 1;
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t start = head > capacity ? head - capacity : 0;
+        std::vector<Event> events;
+
+        for (uint64_t i = start; i < head; i++) {
+            const Slot& slot = ring->slots[i & ring->mask];
+            uint64_t key = slot.key.load(std::memory_order_relaxed);
+            uint64_t change = slot.change.load(std::memory_order_relaxed);
+
+            events.push_back(Event{static_cast<uint32_t>(key >> 32), static_cast<uint16_t>(key >> 16),
+                                   static_cast<uint16_t>(key), static_cast<uint32_t>(change >> 32),
+                                   static_cast<uint32_t>(change)});
+        }
+
+        // Drop events the thread overwrote or started to overwrite while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t claimed = ring->claimed.load(std::memory_order_relaxed);
+
+        if (claimed > capacity && claimed - capacity > start) {
+            events.erase(events.begin(), events.begin() + std::min<uint64_t>(claimed - capacity - start, events.size()));
+        }
+
+        if (!events.empty()) {
+            threads.push_back(events);
+        }
+    }
+
+    return threads;
+}
+
+bool write(const std::string& path) {
+    std::vector<std::vector<Event>> threads = collect();
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    uint32_t header[3] = {TRACE_MAGIC, TRACE_VERSION, static_cast<uint32_t>(threads.size())};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    for (auto const& events: threads) {
+        uint64_t count = events.size();
+
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(events.data()), count * sizeof(Event));
+    }
+
+    return !file;
+}
+
+bool read(const std::string& path, std::vector<std::vector<Event>>& threads) {
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[3];
+
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))
+        || header[0] != TRACE_MAGIC || header[1] != TRACE_VERSION || header[2] > (1u << 20)) {
+        return true;
+    }
+
+    threads.assign(header[2], std::vector<Event>());
+
+    for (auto& events: threads) {
+        uint64_t count;
+
+        if (!file.read(reinterpret_cast<char*>(&count), sizeof(count)) || count > (1ull << 32)) {
+            return true;
+        }
+
+        events.resize(count);
+
+        if (count > 0 && !file.read(reinterpret_cast<char*>(events.data()), count * sizeof(Event))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
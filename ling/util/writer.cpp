@@ -0,0 +1,256 @@
+#include "writer.h"
+#include "corpus.h"
+#include "metrics.h"
+
+#include <cstring>
+#include <iostream>
+
+static char* put_decimal(char* out, unsigned int value) {
+    char digits[10];
+    int len = 0;
+
+    do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (len > 0) {
+        *out++ = digits[--len];
+    }
+
+    return out;
+}
+
+static char* put_hex(char* out, unsigned int value) {
+    static const char hex[] = "0123456789abcdef";
+    char digits[8];
+    int len = 0;
+
+    do {
+        digits[len++] = hex[value % 0x10];
+        value /= 0x10;
+    } while (value > 0);
+
+    while (len > 0) {
+        *out++ = digits[--len];
+    }
+
+    return out;
+}
+
+bool parse_format(const std::string& name, Format& format) {
+    if (name == "ndjson") {
+        format = Format::ndjson;
+    } else if (name == "csv") {
+        format = Format::csv;
+    } else if (name == "binary") {
+        format = Format::binary;
+    } else {
+        return true;
+    }
+
+    return false;
+}
+
+Writer::Writer(Format format, const Inventory* inventory, size_t buffer_size)
+    : format(format), inventory(inventory), buffer(buffer_size) {}
+
+bool Writer::open(std::string path, unsigned long chunk_words) {
+    close();
+
+    this->path = path;
+    this->chunk_words = path == "-" ? 0 : chunk_words;
+    chunk = 0;
+    words = 0;
+    bytes = 0;
+    failed = false;
+
+    return open_chunk();
+}
+
+bool Writer::open_chunk() {
+    if (path == "-") {
+        output = &std::cout;
+    } else {
+        file.open(chunk_words > 0 ? path + "." + std::to_string(chunk) : path, std::ios::binary);
+
+        if (!file.is_open()) {
+            failed = true;
+            return true;
+        }
+
+        output = &file;
+    }
+
+    if (format == Format::csv) {
+        static const char header[] = "ids,text\n";
+        std::memcpy(reserve(sizeof(header) - 1), header, sizeof(header) - 1);
+        used += sizeof(header) - 1;
+    }
+
+    return false;
+}
+
+char* Writer::reserve(size_t len) {
+    if (used + len > buffer.size()) {
+        flush();
+
+        if (len > buffer.size()) {
+            buffer.resize(len);
+        }
+    }
+
+    return buffer.data() + used;
+}
+
+bool Writer::flush() {
+    if (output != nullptr && used > 0) {
+        output->write(buffer.data(), used);
+
+        if (!*output) {
+            failed = true;
+        }
+
+        LING_COUNT(bytes_written, used);
+        bytes += used;
+    }
+
+    used = 0;
+    return failed;
+}
+
+bool Writer::write(const unsigned int* word, int len) {
+    if (output == nullptr || failed) {
+        return true;
+    }
+
+    // Start the next chunk once the current one is full
+    if (chunk_words > 0 && words > 0 && words % chunk_words == 0) {
+        flush();
+        file.close();
+        chunk++;
+
+        if (open_chunk()) {
+            return true;
+        }
+    }
+
+    words++;
+
+    if (format == Format::binary) {
+        unsigned char* out = reinterpret_cast<unsigned char*>(reserve((len + 1) * 4));
+
+        for (int i = 0; i <= len; i++) {
+            unsigned int id = i < len ? word[i] : WORD_BOUNDARY;
+
+            *out++ = id;
+            *out++ = id >> 8;
+            *out++ = id >> 16;
+            *out++ = id >> 24;
+        }
+
+        used += (len + 1) * 4;
+        return failed;
+    }
+
+    // IDs, at most 10 digits and a separator each
+    char* start = reserve(len * 11 + 16);
+    char* out = start;
+
+    if (format == Format::ndjson) {
+        std::memcpy(out, "{\"ids\":[", 8);
+        out += 8;
+
+        for (int i = 0; i < len; i++) {
+            if (i > 0) {
+                *out++ = ',';
+            }
+
+            out = put_decimal(out, word[i]);
+        }
+
+        *out++ = ']';
+    } else {
+        for (int i = 0; i < len; i++) {
+            if (i > 0) {
+                *out++ = ' ';
+            }
+
+            out = put_hex(out, word[i]);
+        }
+    }
+
+    used += out - start;
+
+    if (inventory != nullptr) {
+        if (format == Format::ndjson) {
+            std::memcpy(reserve(9), ",\"text\":\"", 9);
+            used += 9;
+        } else {
+            *reserve(1) = ',';
+            used++;
+        }
+
+        for (int i = 0; i < len; i++) {
+            int index = inventory->index_of(word[i]);
+
+            if (index < 0) {
+                continue;
+            }
+
+            // Escaping at most turns a byte into six. Symbols come from csv
+            // files, so they never need quoting in csv.
+            const std::string& symbol = inventory->get_symbol(index);
+            start = reserve(symbol.size() * 6);
+            out = start;
+
+            for (auto const& c: symbol) {
+                if (format == Format::ndjson && (c == '"' || c == '\\')) {
+                    *out++ = '\\';
+                    *out++ = c;
+                } else if (format == Format::ndjson && static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    std::memcpy(out, "\\u00", 4);
+                    out[4] = hex[c >> 4];
+                    out[5] = hex[c & 0xf];
+                    out += 6;
+                } else {
+                    *out++ = c;
+                }
+            }
+
+            used += out - start;
+        }
+
+        if (format == Format::ndjson) {
+            *reserve(1) = '"';
+            used++;
+        }
+    }
+
+    if (format == Format::ndjson) {
+        *reserve(1) = '}';
+        used++;
+    }
+
+    *reserve(1) = '\n';
+    used++;
+
+    return failed;
+}
+
+bool Writer::close() {
+    if (output != nullptr) {
+        flush();
+
+        if (file.is_open()) {
+            file.close();
+        } else {
+            output->flush();
+        }
+
+        output = nullptr;
+    }
+
+    return failed;
+}
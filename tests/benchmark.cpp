@@ -0,0 +1,461 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "phonotactics.h"
+#include "generator.h"
+#include "wordlist.h"
+#include "metrics.h"
+
+/*
+ * Benchmarks the main paths against synthetic languages and lexicons
+ *
+ * Usage: benchmark [--consonants N] [--vowels N] [--words N] [--filter name]
+ *                  [--out results.json] [--baseline results.json] [--tolerance 0.1]
+ *
+ * Synthetic languages are written to a temporary directory. Results are
+ * printed as JSON, and with --baseline every benchmark slower than the
+ * baseline by more than the tolerance is reported and the exit code is 1.
+ * The baseline has to be from the same build, scale and filter.
+ */
+
+#define BENCH_LANG "synthetic"
+#define MIN_TIME 0.25   // Seconds per repetition
+#define REPETITIONS 3
+
+// Results are added here so the compiler cannot drop the work
+static volatile long sink;
+
+struct Benchmark {
+    std::string name;
+    std::function<long()> run;      // Returns the number of operations performed
+    std::function<void()> reset;    // Run untimed before every run, if set
+
+    Benchmark(std::string name, std::function<long()> run, std::function<void()> reset = nullptr)
+        : name(name), run(run), reset(reset) {}
+};
+
+static void print_usage() {
+    std::cerr << "Usage: benchmark [--consonants N] [--vowels N] [--words N] [--filter name]\n"
+              << "                 [--out results.json] [--baseline results.json] [--tolerance 0.1] [--stats]\n";
+}
+
+/* Create a directory unless it exists, returns true on failure */
+static bool make_dir(const std::string& path) {
+    return mkdir(path.c_str(), 0755) != 0 && errno != EEXIST;
+}
+
+/* Remove a directory and everything in it, returns true on failure */
+static bool remove_dir(const std::string& path) {
+    return nftw(path.c_str(), [](const char* file, const struct stat*, int, struct FTW*) { return remove(file); },
+                16, FTW_DEPTH | FTW_PHYS) != 0;
+}
+
+/* Every valid consonant ID */
+static std::vector<unsigned int> all_consonants() {
+    std::vector<unsigned int> ids;
+
+    for (int release = 0; release <= 4; release++)
+    for (int voicing = 0; voicing <= 2; voicing++)
+    for (int manner = 0; manner <= 8; manner++)
+    for (int sec_art = 0; sec_art <= 13; sec_art++)
+    for (int pri_art = 1; pri_art <= 13; pri_art++)
+    for (int air = 1; air <= 4; air++) {
+        ids.push_back(release * 0x1000000 + voicing * 0x100000 + manner * 0x10000
+                      + sec_art * 0x1000 + pri_art * 0x100 + air * 0x10 + 0x1);
+    }
+
+    return ids;
+}
+
+/* Every valid vowel ID */
+static std::vector<unsigned int> all_vowels() {
+    std::vector<unsigned int> ids;
+
+    for (int rhotic = 1; rhotic <= 2; rhotic++)
+    for (int nasalized = 1; nasalized <= 2; nasalized++)
+    for (int length = 1; length <= 4; length++)
+    for (int voicing = 1; voicing <= 2; voicing++)
+    for (int rounded = 1; rounded <= 2; rounded++)
+    for (int backness = 1; backness <= 3; backness++)
+    for (int height = 1; height <= 7; height++) {
+        ids.push_back(rhotic * 0x10000000 + nasalized * 0x1000000 + length * 0x100000 + voicing * 0x10000
+                      + rounded * 0x1000 + backness * 0x100 + height * 0x10 + 0x2);
+    }
+
+    return ids;
+}
+
+/*
+ * Write a synthetic language with the given number of phonemes to langs/<name>
+ * in the working directory
+ */
+static bool write_language(std::string name, int num_consonants, int num_vowels, std::mt19937& rng) {
+    std::vector<unsigned int> consonants = all_consonants(), vowels = all_vowels();
+
+    std::shuffle(consonants.begin(), consonants.end(), rng);
+    std::shuffle(vowels.begin(), vowels.end(), rng);
+
+    consonants.resize(std::min<size_t>(num_consonants, consonants.size()));
+    vowels.resize(std::min<size_t>(num_vowels, vowels.size()));
+
+    std::string dir = "langs/" + name;
+
+    for (std::string path: {std::string("langs"), dir, dir + "/units", dir + "/phonology"}) {
+        if (make_dir(path)) {
+            return true;
+        }
+    }
+
+    std::ofstream f_consonants(dir + "/units/consonants.csv");
+    std::ofstream f_vowels(dir + "/units/vowels.csv");
+
+    f_consonants << "symbol,id\n";
+    f_vowels << "symbol,id\n";
+
+    for (size_t i = 0; i < consonants.size(); i++) {
+        f_consonants << "c" << i << "," << std::hex << consonants[i] << std::dec << "\n";
+    }
+
+    for (size_t i = 0; i < vowels.size(); i++) {
+        f_vowels << "v" << i << "," << std::hex << vowels[i] << std::dec << "\n";
+    }
+
+    // Single consonant onsets and codas, and one or two vowel nuclei
+    json data;
+    std::vector<std::vector<unsigned int>> onsets, nuclei, codas;
+
+    for (size_t i = 0; i < consonants.size(); i++) {
+        onsets.push_back({consonants[i]});
+
+        if (i % 2 == 0) {
+            codas.push_back({consonants[i]});
+        }
+    }
+
+    for (size_t i = 0; i < vowels.size(); i++) {
+        nuclei.push_back({vowels[i]});
+        nuclei.push_back({vowels[i], vowels[(i + 1) % vowels.size()]});
+    }
+
+    data["inventory"]["onset"] = onsets;
+    data["inventory"]["nucleus"] = nuclei;
+    data["inventory"]["coda"] = codas;
+    data["syllable"]["num"] = {{1, 3}};
+    data["syllable"]["types"] = {"CV", "CVC", "CVV", "V"};
+
+    std::ofstream f_phonotactics(dir + "/phonology/phonotactics.json");
+    f_phonotactics << data.dump(4) << "\n";
+
+    return !f_consonants || !f_vowels || !f_phonotactics;
+}
+
+/* Best nanoseconds per operation over REPETITIONS */
+static double measure(const Benchmark& benchmark) {
+    double best = -1;
+
+    for (int r = 0; r < REPETITIONS; r++) {
+        double elapsed = 0;
+        long ops = 0;
+
+        while (elapsed < MIN_TIME) {
+            if (benchmark.reset) {
+                benchmark.reset();
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            ops += benchmark.run();
+            elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        double ns = elapsed * 1e9 / std::max(ops, 1L);
+        best = best < 0 ? ns : std::min(best, ns);
+    }
+
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    int num_consonants = 500, num_vowels = 100, num_words = 100000;
+    double tolerance = 0.1;
+    std::string filter, out_path, baseline_path;
+
+    // Every option takes a value
+    if (argc % 2 == 0) {
+        print_usage();
+        return 1;
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i], value = argv[i + 1];
+        char* end = nullptr;
+
+        if (arg == "--consonants") {
+            num_consonants = strtol(value.c_str(), &end, 10);
+        } else if (arg == "--vowels") {
+            num_vowels = strtol(value.c_str(), &end, 10);
+        } else if (arg == "--words") {
+            num_words = strtol(value.c_str(), &end, 10);
+        } else if (arg == "--filter") {
+            filter = value;
+        } else if (arg == "--out") {
+            out_path = value;
+        } else if (arg == "--baseline") {
+            baseline_path = value;
+        } else if (arg == "--tolerance") {
+            tolerance = strtod(value.c_str(), &end);
+        } else {
+            print_usage();
+            return 1;
+        }
+
+        // Numeric options have to be a whole number
+        if (end != nullptr && (end == value.c_str() || *end != '\0')) {
+            print_usage();
+            return 1;
+        }
+    }
+
+    json baseline;
+
+    if (!baseline_path.empty()) {
+        std::ifstream file(baseline_path);
+
+        try {
+            baseline = json::parse(file);
+        } catch (...) {}
+
+        if (!baseline.is_object()) {
+            std::cerr << "Could not read baseline " << baseline_path << "\n";
+            return 1;
+        }
+    }
+
+    // Output paths are relative to where the benchmark was started
+    char cwd[PATH_MAX];
+    std::string start_dir = getcwd(cwd, sizeof(cwd)) != nullptr ? cwd : ".";
+
+    char work_dir[] = "/tmp/ling_benchXXXXXX";
+
+    if (mkdtemp(work_dir) == nullptr || chdir(work_dir) != 0) {
+        std::cerr << "Could not create a working directory\n";
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+
+    if (write_language(BENCH_LANG, num_consonants, num_vowels, rng)) {
+        std::cerr << "Could not write the synthetic language\n";
+        remove_dir(work_dir);
+        return 1;
+    }
+
+    SoundSystem sound_system(BENCH_LANG);
+    Phonotactics phonotactics(BENCH_LANG);
+
+    if (sound_system.load() || phonotactics.load()) {
+        std::cerr << "Could not load the synthetic language\n";
+        remove_dir(work_dir);
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+
+    // Synthetic lexicon
+    Generator generator(phonotactics, 42);
+    WordList words;
+    std::vector<unsigned int> word;
+
+    for (int i = 0; i < num_words; i++) {
+        if (generator.generate(word)) {
+            std::cerr << "Could not generate the synthetic lexicon\n";
+            remove_dir(work_dir);
+            return 1;
+        }
+
+        words.add(word);
+    }
+
+    std::vector<std::vector<unsigned int>> lexicon;
+
+    for (unsigned int i = 0; i < words.size(); i++) {
+        lexicon.push_back(words.get_word(i));
+    }
+
+    // Restored before every insert, so every run inserts
+    std::string phonotactics_path = "langs/" BENCH_LANG "/phonology/phonotactics.json";
+    std::string phonotactics_text;
+    {
+        std::ifstream file(phonotactics_path);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        phonotactics_text = ss.str();
+    }
+
+    std::set<unsigned int> ids(inventory.get_ids().begin(), inventory.get_ids().end());
+    std::vector<unsigned int> classes = {0x11, 0x12, 0x100001, 0x200001, 0x20012, 0x10011, 0x1001112, 0x11222312};
+
+    // high vowel -> voiceless / voiceless consonant _ voiceless consonant
+    Rule rule(0x20012, 0x10012, 0x100001, 0x100001);
+
+    // unrounded vowel -> rounded / rounded vowel _ on the vowel tier
+    Rule harmony_rule(0x1002, 0x2002, 0x2002, 0x0);
+    harmony_rule.set_projection(0x2, 0x0, 0x0, true);
+
+    std::vector<Benchmark> benchmarks = {
+        {"soundsystem_load", [&]() {
+            SoundSystem loaded(BENCH_LANG);
+            loaded.load();
+            return 1L;
+        }},
+        {"soundsystem_save", [&]() {
+            sound_system.save();
+            return 1L;
+        }},
+        {"in_class", [&]() {
+            long matches = 0;
+
+            for (auto const& id: inventory.get_ids()) {
+                for (auto const& phon_class: classes) {
+                    matches += in_class(id, phon_class);
+                }
+            }
+
+            sink = sink + matches;
+            return static_cast<long>(inventory.size() * classes.size());
+        }},
+        {"create_sequences", [&]() {
+            std::vector<unsigned int> pattern = {0x100001, 0x12};
+            return static_cast<long>(create_sequences(ids, pattern).size());
+        }},
+        {"rule_apply", [&]() {
+            std::vector<unsigned int> output;
+            long segments = 0;
+
+            for (auto const& w: lexicon) {
+                output = rule.apply(inventory, w);
+                segments += output.size();
+            }
+
+            return segments;
+        }},
+        {"harmony_apply", [&]() {
+            std::vector<unsigned int> output;
+            long segments = 0;
+
+            for (auto const& w: lexicon) {
+                output = harmony_rule.apply(inventory, w);
+                segments += output.size();
+            }
+
+            return segments;
+        }},
+        {"render", [&]() {
+            long bytes = 0;
+
+            for (auto const& w: lexicon) {
+                bytes += inventory.render(w).size();
+            }
+
+            sink = sink + bytes;
+            return static_cast<long>(lexicon.size());
+        }},
+        {"phonotactics_insert", [&]() {
+            std::vector<std::vector<unsigned int>> sequences = {{inventory.get_id(0), inventory.get_id(1)}};
+
+            insert_sequences("onset", BENCH_LANG, sequences);
+            return 1L;
+        }, [&]() {
+            std::ofstream file(phonotactics_path);
+            file << phonotactics_text;
+        }}
+    };
+
+    json results;
+    bool regressed = false;
+
+#ifdef NDEBUG
+    results["build"] = "optimized";
+#else
+    results["build"] = "debug";
+#endif
+    results["scale"] = {{"consonants", sound_system.get_consonants().size()},
+                        {"vowels", sound_system.get_vowels().size()},
+                        {"words", words.size()}};
+    results["filter"] = filter;
+    results["results"] = json::array();
+
+    // Times are only comparable for the same build, lexicon and benchmarks
+    if (!baseline.is_null() && (baseline.value("build", json()) != results["build"]
+                                || baseline.value("scale", json()) != results["scale"]
+                                || baseline.value("filter", json()) != results["filter"])) {
+
+        std::cerr << "Baseline " << baseline_path << " was run with other settings or build\n";
+        remove_dir(work_dir);
+        return 1;
+    }
+
+    for (auto const& benchmark: benchmarks) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        double ns = measure(benchmark);
+        json result = {{"name", benchmark.name}, {"ns_per_op", ns}};
+
+        std::cerr << benchmark.name << ": " << ns << " ns/op";
+
+        if (!baseline.is_null()) {
+            for (auto const& old: baseline["results"]) {
+                if (old["name"] == benchmark.name) {
+                    double ratio = ns / old["ns_per_op"].get<double>();
+                    result["ratio"] = ratio;
+
+                    std::cerr << " (" << ratio << "x baseline)";
+
+                    if (ratio > 1 + tolerance) {
+                        std::cerr << " REGRESSION";
+                        regressed = true;
+                    }
+                }
+            }
+        }
+
+        std::cerr << "\n";
+        results["results"].push_back(result);
+    }
+
+    if (remove_dir(work_dir)) {
+        std::cerr << "Could not remove " << work_dir << "\n";
+    }
+
+    if (!out_path.empty()) {
+        std::ofstream file(out_path[0] == '/' ? out_path : start_dir + "/" + out_path);
+        file << results.dump(4) << "\n";
+    } else {
+        std::cout << results.dump(4) << "\n";
+    }
+
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ling.h"
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "phonotactics.h"
+#include "metrics.h"
+
+/*
+ * Measures the overhead of calling the C interface
+ *
+ * Usage: capi_benchmark [language]
+ * Random words are tokenized, derived, validated and rendered through the C
+ * interface in batches of several sizes, and one at a time through the C++
+ * classes the interface wraps. With a batch of 1 the difference to the C++
+ * call is the cost of crossing the interface.
+ */
+
+#define WORDS 4096
+#define MIN_TIME 0.2    // Seconds per measurement
+
+// Results are added here so the compiler cannot drop the work
+static volatile long sink;
+
+/* Nanoseconds per word of fn(begin, count), run over every word in batches of count */
+static double measure(int count, const std::function<void(uint32_t, uint32_t)>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    long words = 0;
+    double elapsed;
+
+    do {
+        for (uint32_t begin = 0; begin + count <= WORDS; begin += count) {
+            fn(begin, count);
+        }
+
+        words += WORDS / count * count;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < MIN_TIME);
+
+    return elapsed * 1e9 / words;
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    std::string lang = argc > 1 && argv[1][0] != '-' ? argv[1] : "preset01";
+    ling_language* language;
+
+    if (ling_load(lang.c_str(), &language) != LING_OK) {
+        std::cerr << "Usage: capi_benchmark [language] [--stats]\n";
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    // The same language through the C++ classes
+    SoundSystem sound_system(lang);
+    sound_system.load();
+    Inventory inventory(sound_system);
+    Phonotactics phonotactics(lang);
+    bool has_phonotactics = !phonotactics.load();
+    std::vector<Rule> rules;
+    load_rules("langs/" + lang + "/phonology/rules.csv", rules);
+
+    // Random words of 3 to 8 phonemes, as IDs and as text
+    std::mt19937 rng(42);
+    std::vector<uint32_t> ids, offsets(1, 0), text_offsets(1, 0);
+    std::vector<std::vector<unsigned int>> words;
+    std::vector<std::string> texts;
+    std::string text;
+
+    for (int w = 0; w < WORDS; w++) {
+        std::vector<unsigned int> word(3 + rng() % 6);
+
+        for (auto& id: word) {
+            id = inventory.get_id(rng() % inventory.size());
+        }
+
+        ids.insert(ids.end(), word.begin(), word.end());
+        offsets.push_back(ids.size());
+        words.push_back(word);
+        texts.push_back(inventory.render(word));
+        text += texts.back();
+        text_offsets.push_back(text.size());
+    }
+
+    std::vector<uint32_t> out_ids(ids.size()), out_offsets(WORDS + 1);
+    std::vector<char> out_text(text.size());
+    std::vector<uint8_t> flags(WORDS);
+
+    std::cout << "ns per word\n";
+    std::cout << "batch\ttokenize\tderive\tvalidate\trender\n";
+
+    for (int count: {1, 16, 256, WORDS}) {
+        double tokenize = measure(count, [&](uint32_t begin, uint32_t n) {
+            ling_texts input = {text.data(), text_offsets.data() + begin, n};
+            ling_word_buffer output = {out_ids.data(), static_cast<uint32_t>(out_ids.size()), out_offsets.data(), 0};
+            sink += ling_tokenize(language, &input, &output, flags.data());
+        });
+
+        double derive = measure(count, [&](uint32_t begin, uint32_t n) {
+            ling_words input = {ids.data(), offsets.data() + begin, n};
+            ling_word_buffer output = {out_ids.data(), static_cast<uint32_t>(out_ids.size()), out_offsets.data(), 0};
+            sink += ling_derive(language, &input, &output);
+        });
+
+        double validate = measure(count, [&](uint32_t begin, uint32_t n) {
+            ling_words input = {ids.data(), offsets.data() + begin, n};
+            sink += ling_validate(language, &input, flags.data());
+        });
+
+        double render = measure(count, [&](uint32_t begin, uint32_t n) {
+            ling_words input = {ids.data(), offsets.data() + begin, n};
+            ling_text_buffer output = {out_text.data(), static_cast<uint32_t>(out_text.size()), out_offsets.data(), 0};
+            sink += ling_render(language, &input, &output);
+        });
+
+        std::cout << count << "\t" << tokenize << "\t" << derive << "\t";
+        (has_phonotactics ? std::cout << validate : std::cout << "-") << "\t" << render << "\n";
+    }
+
+    // The C++ calls allocate their results, as callers of them do
+    double tokenize = measure(1, [&](uint32_t begin, uint32_t) {
+        std::vector<unsigned int> word;
+        sink += inventory.tokenize(texts[begin], word);
+    });
+
+    double derive = measure(1, [&](uint32_t begin, uint32_t) {
+        std::vector<unsigned int> word = words[begin];
+
+        for (auto const& rule: rules) {
+            word = rule.apply(inventory, word);
+        }
+
+        sink += word.size();
+    });
+
+    double validate = measure(1, [&](uint32_t begin, uint32_t) {
+        sink += phonotactics.validate(words[begin]);
+    });
+
+    double render = measure(1, [&](uint32_t begin, uint32_t) {
+        sink += inventory.render(words[begin]).size();
+    });
+
+    std::cout << "c++\t" << tokenize << "\t" << derive << "\t";
+    (has_phonotactics ? std::cout << validate : std::cout << "-") << "\t" << render << "\n";
+
+    ling_free(language);
+    return 0;
+}
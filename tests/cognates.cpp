@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "wordlist.h"
+#include "alignment.h"
+#include "metrics.h"
+
+// Read a word list, one word per line with phoneme symbols separated by spaces
+static bool read_words(const std::string& path, const Inventory& inventory, WordList& words) {
+    std::ifstream file(path);
+
+    if (!file.is_open()) {
+        return true;
+    }
+
+    std::string line;
+
+    while (getline(file, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else if (!word.empty()) {
+            words.add(word);
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Finds likely cognates between the word lists of two languages and counts
+ * which phonemes correspond to each other
+ *
+ * Usage: cognates <language a> <language b> <words a> <words b> [--local] [--min <score>]
+ * Every word is aligned with every word of the other list. Pairs that are
+ * each other's best match and score at least --min (default 0) are printed
+ * with their alignment, followed by every phoneme correspondence by count.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 5) {
+        std::cerr << "Usage: cognates <language a> <language b> <words a> <words b> [--local] [--min <score>] [--stats]\n";
+        return 1;
+    }
+
+    AlignMode mode = AlignMode::global;
+    int min_score = 0;
+
+    for (int i = 5; i < argc; i++) {
+        if (std::strcmp(argv[i], "--local") == 0) {
+            mode = AlignMode::local;
+        } else if (std::strcmp(argv[i], "--min") == 0 && i + 1 < argc) {
+            min_score = std::atoi(argv[++i]);
+        }
+    }
+
+    SoundSystem system_a(argv[1]);
+    SoundSystem system_b(argv[2]);
+
+    if (system_a.load()) {
+        std::cerr << "Could not find language named " << argv[1] << "\n";
+        return 1;
+    }
+
+    if (system_b.load()) {
+        std::cerr << "Could not find language named " << argv[2] << "\n";
+        return 1;
+    }
+
+    Inventory inventory_a(system_a);
+    Inventory inventory_b(system_b);
+    WordList words_a, words_b;
+
+    if (read_words(argv[3], inventory_a, words_a) || read_words(argv[4], inventory_b, words_b)) {
+        std::cerr << "Could not open word lists " << argv[3] << " and " << argv[4] << "\n";
+        return 1;
+    }
+
+    Aligner aligner(inventory_a, inventory_b, mode);
+    Correspondences counts(inventory_a.size(), inventory_b.size());
+    std::vector<std::pair<unsigned int, unsigned int>> matches;
+
+    auto start = std::chrono::steady_clock::now();
+    aligner.correspondences(words_a, words_b, min_score, counts, matches);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto const& match: matches) {
+        std::vector<unsigned int> a = words_a.get_word(match.first);
+        std::vector<unsigned int> b = words_b.get_word(match.second);
+        Alignment alignment;
+        aligner.align(a, b, alignment);
+
+        std::string top, bottom;
+
+        for (auto const& pair: alignment.pairs) {
+            std::string symbol_a = pair.first < 0 ? "-" : inventory_a.render({a[pair.first]});
+            std::string symbol_b = pair.second < 0 ? "-" : inventory_b.render({b[pair.second]});
+
+            top += " " + symbol_a;
+            bottom += " " + symbol_b;
+        }
+
+        std::cout << inventory_a.render(a) << " ~ " << inventory_b.render(b) << " (" << alignment.score << ")\n"
+                  << "   " << top << "\n   " << bottom << "\n";
+    }
+
+    std::vector<std::pair<unsigned long, std::pair<int, int>>> table;
+
+    for (int a = 0; a <= counts.get_gap_a(); a++) {
+        for (int b = 0; b <= counts.get_gap_b(); b++) {
+            if (counts.get(a, b) > 0) {
+                table.push_back(std::make_pair(counts.get(a, b), std::make_pair(a, b)));
+            }
+        }
+    }
+
+    std::sort(table.begin(), table.end(),
+        [](const std::pair<unsigned long, std::pair<int, int>>& x, const std::pair<unsigned long, std::pair<int, int>>& y) {
+            return x.first > y.first || (x.first == y.first && x.second < y.second);
+        });
+
+    std::cout << "\nCorrespondences:\n";
+
+    for (auto const& entry: table) {
+        int a = entry.second.first, b = entry.second.second;
+
+        std::cout << (a == counts.get_gap_a() ? "-" : inventory_a.get_symbol(a)) << " : "
+                  << (b == counts.get_gap_b() ? "-" : inventory_b.get_symbol(b)) << "  " << entry.first << "\n";
+    }
+
+    std::cerr << words_a.size() << " x " << words_b.size() << " words, " << matches.size() << " cognates, "
+              << (elapsed > 0 ? 2.0 * words_a.size() * words_b.size() / elapsed / 1e6 : 0) << " M alignments/s\n";
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "phonotactics.h"
+#include "corpus.h"
+#include "statistics.h"
+#include "metrics.h"
+
+/*
+ * Prints phoneme, bigram, natural class and syllable statistics of a corpus
+ *
+ * Usage: corpus_stats <language> <corpus> [--json] [natural class as ID]*
+ * Corpora ending in .txt have one word per line with phoneme symbols
+ * separated by spaces, any other file is read as binary IDs.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 3) {
+        std::cerr << "Usage: corpus_stats <language> <corpus> [--json] [natural class as ID]* [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string path = argv[2];
+    bool as_json = false;
+    std::vector<unsigned int> classes;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--json") {
+            as_json = true;
+            continue;
+        }
+
+        try {
+            classes.push_back(std::stoul(arg, nullptr, 16));
+        } catch (...) {
+            std::cerr << "Failed to convert '" << arg << "' into an integer\n";
+            return 1;
+        }
+    }
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    Phonotactics phonotactics(lang);
+
+    if (phonotactics.load()) {
+        std::cerr << "Could not load " << lang << "'s phonotactics, skipping syllables\n";
+    }
+
+    bool is_text = path.size() > 4 && path.compare(path.size() - 4, 4, ".txt") == 0;
+    std::ifstream file(path, is_text ? std::ios::in : std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    CorpusReader reader(file, is_text ? &inventory : nullptr);
+    Statistics statistics(inventory, classes, &phonotactics);
+
+    statistics.count(reader);
+
+    if (reader.get_failed() > 0) {
+        std::cerr << reader.get_failed() << " lines contained unknown phonemes\n";
+    }
+
+    if (as_json) {
+        statistics.write_json(std::cout);
+    } else {
+        statistics.write_csv(std::cout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+#include "metrics.h"
+
+/*
+ * Loads several languages in parallel and reports how much they share
+ *
+ * Usage: languages <language>...
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: languages <language>... [--stats]\n";
+        return 1;
+    }
+
+    std::vector<std::string> names(argv + 1, argv + argc);
+    Registry registry;
+
+    int failed = registry.load(names);
+    size_t phonemes = 0;
+
+    for (auto const& name: registry.get_names()) {
+        std::shared_ptr<const Language> language = registry.get(name);
+
+        std::cout << name << ": " << language->get_phonemes().size() << " phonemes"
+                  << (language->get_phonotactics() ? "" : ", no phonotactics") << "\n";
+
+        phonemes += language->get_phonemes().size();
+    }
+
+    std::cout << registry.get_names().size() << " languages, " << phonemes << " phonemes, "
+              << registry.get_record_count() << " distinct records, "
+              << registry.get_inventory_count() << " distinct inventories\n";
+
+    return failed > 0 ? 1 : 0;
+}
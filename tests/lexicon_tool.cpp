@@ -0,0 +1,179 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "wordlist.h"
+#include "lexicon.h"
+#include "writer.h"
+#include "metrics.h"
+
+/*
+ * Builds and queries lexicon files
+ *
+ * Usage:
+ *  lexicon_tool <language> build <words> <lexicon>
+ *  lexicon_tool <language> find <lexicon> <word>
+ *  lexicon_tool <language> prefix <lexicon> <prefix>
+ *  lexicon_tool <language> range <lexicon> <from> <to>
+ *  lexicon_tool <language> export <lexicon> ndjson|csv|binary <path> [words per chunk]
+ *
+ * Each line of the word list is a word, optionally followed by a tab and a
+ * gloss. Glosses are written to <lexicon>.gloss and each word's payload is
+ * the offset of its gloss.
+ */
+
+static std::string read_gloss(const std::string& path, uint32_t offset) {
+    std::ifstream file(path + ".gloss", std::ios::binary);
+    std::string gloss;
+
+    if (file.is_open()) {
+        file.seekg(offset);
+        getline(file, gloss, '\0');
+    }
+
+    return gloss;
+}
+
+static void print_words(const Lexicon& lexicon, const Inventory& inventory,
+                        const std::string& path, long begin, long end) {
+
+    Lexicon::Cursor cursor = lexicon.iterate(begin, end);
+
+    while (cursor.next()) {
+        std::cout << inventory.render(cursor.get_word());
+
+        if (lexicon.has_payloads()) {
+            std::cout << "\t" << read_gloss(path, cursor.get_payload());
+        }
+
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 5) {
+        std::cerr << "Usage: lexicon_tool <language> build|find|prefix|range|export ... [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string command = argv[2];
+    std::string path = command == "build" ? argv[4] : argv[3];
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+
+    if (command == "build") {
+        std::ifstream input(argv[3]);
+        std::ofstream glosses(path + ".gloss", std::ios::binary);
+
+        if (!input.is_open() || !glosses.is_open()) {
+            std::cerr << "Could not open " << argv[3] << " or " << path << ".gloss\n";
+            return 1;
+        }
+
+        WordList words;
+        std::vector<uint32_t> payloads;
+        std::vector<unsigned int> word;
+        std::string line;
+        uint32_t offset = 0;
+
+        while (getline(input, line)) {
+            size_t tab = line.find('\t');
+            std::string gloss = tab == std::string::npos ? "" : line.substr(tab + 1);
+
+            if (inventory.tokenize(line.substr(0, tab), word)) {
+                std::cerr << "Unknown phoneme in '" << line << "'\n";
+                continue;
+            }
+
+            words.add(word);
+            payloads.push_back(offset);
+
+            glosses << gloss << '\0';
+            offset += gloss.size() + 1;
+        }
+
+        if (write_lexicon(path, words, &payloads)) {
+            std::cerr << "Could not write " << path << "\n";
+            return 1;
+        }
+
+        return 0;
+    }
+
+    Lexicon lexicon;
+
+    if (lexicon.open(path)) {
+        std::cerr << "Could not open lexicon " << path << "\n";
+        return 1;
+    }
+
+    if (command == "export") {
+        Format format;
+
+        if (argc < 6 || parse_format(argv[4], format)) {
+            std::cerr << "Usage: lexicon_tool <language> export <lexicon> ndjson|csv|binary <path> [words per chunk] [--stats]\n";
+            return 1;
+        }
+
+        Writer writer(format, &inventory);
+        Lexicon::Cursor cursor = lexicon.iterate(0, lexicon.get_word_count());
+
+        if (writer.open(argv[5], argc > 6 ? std::stoul(argv[6]) : 0)
+            || writer.write_all(cursor) || writer.close()) {
+            std::cerr << "Could not write " << argv[5] << "\n";
+            return 1;
+        }
+
+        std::cerr << writer.get_words() << " words, " << writer.get_bytes() << " bytes\n";
+        return 0;
+    }
+
+    std::vector<unsigned int> word;
+
+    if (inventory.tokenize(argc > 4 ? argv[4] : "", word)) {
+        std::cerr << "Unknown phoneme in '" << argv[4] << "'\n";
+        return 1;
+    }
+
+    if (command == "find") {
+        long ordinal = lexicon.find(word.data(), word.size());
+
+        if (ordinal < 0) {
+            std::cout << "Not found\n";
+            return 1;
+        }
+
+        print_words(lexicon, inventory, path, ordinal, ordinal + 1);
+    } else if (command == "prefix") {
+        std::pair<long, long> range = lexicon.prefix_range(word.data(), word.size());
+        print_words(lexicon, inventory, path, range.first, range.second);
+    } else if (command == "range" && argc > 5) {
+        std::vector<unsigned int> to;
+
+        if (inventory.tokenize(argv[5], to)) {
+            std::cerr << "Unknown phoneme in '" << argv[5] << "'\n";
+            return 1;
+        }
+
+        print_words(lexicon, inventory, path, lexicon.lower_bound(word.data(), word.size()),
+                    lexicon.lower_bound(to.data(), to.size()));
+    } else {
+        std::cerr << "Unknown command " << command << "\n";
+        return 1;
+    }
+
+    return 0;
+}
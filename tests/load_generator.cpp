@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Drives a server listening on a Unix domain socket and reports its
+ * throughput and latency as JSON
+ *
+ * Usage: load_generator <socket> <language> [--requests N] [--connections N] [--window N]
+ * Each connection keeps at most window requests in flight. Requests cycle
+ * through tokenize, derive, validate and syllabify on words the server
+ * generates first.
+ */
+
+static int connect_to(const std::string& path) {
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+
+        if (n <= 0) {
+            return false;
+        }
+
+        written += n;
+    }
+
+    return true;
+}
+
+/* Reads responses line by line, calling fn for each until it returns false */
+template<typename Function>
+static void read_lines(int fd, Function fn) {
+    char buffer[1 << 16];
+    std::string pending;
+    ssize_t n;
+
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        pending.append(buffer, n);
+        size_t start = 0, end;
+
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            if (!fn(pending.substr(start, end - start))) {
+                return;
+            }
+
+            start = end + 1;
+        }
+
+        pending.erase(0, start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        std::cerr << "Usage: load_generator <socket> <language> [--requests N] [--connections N] [--window N]\n";
+        return 1;
+    }
+
+    std::string path = argv[1], lang = argv[2];
+    long num_requests = 100000;
+    int num_connections = 4, window = 64;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (arg == "--requests") {
+            num_requests = atol(argv[i + 1]);
+        } else if (arg == "--connections") {
+            num_connections = atoi(argv[i + 1]);
+        } else if (arg == "--window") {
+            window = atoi(argv[i + 1]);
+        }
+    }
+
+    num_connections = std::max(1, num_connections);
+    window = std::max(1, window);
+
+    // Words to send come from the server itself
+    std::vector<std::string> words;
+    int fd = connect_to(path);
+
+    if (fd < 0) {
+        std::cerr << "Could not connect to " << path << "\n";
+        return 1;
+    }
+
+    write_all(fd, json({{"op", "generate"}, {"lang", lang}, {"count", 1000}, {"seed", 1}}).dump() + "\n");
+    read_lines(fd, [&](const std::string& line) {
+        json response = json::parse(line);
+
+        if (response.contains("words")) {
+            words = response["words"].get<std::vector<std::string>>();
+        } else {
+            std::cerr << "Server error: " << response.value("error", "") << "\n";
+        }
+
+        return false;
+    });
+    close(fd);
+
+    if (words.empty()) {
+        return 1;
+    }
+
+    const char* ops[] = {"tokenize", "derive", "validate", "syllabify"};
+    long per_connection = num_requests / num_connections;
+
+    std::vector<int64_t> latencies(per_connection * num_connections);
+    std::atomic<long> errors(0);
+    std::vector<std::thread> connections;
+
+    Clock::time_point start = Clock::now();
+
+    for (int c = 0; c < num_connections; c++) {
+        connections.push_back(std::thread([&, c]() {
+            int fd = connect_to(path);
+
+            if (fd < 0) {
+                errors += per_connection;
+                return;
+            }
+
+            std::unique_ptr<std::atomic<int64_t>[]> sent(new std::atomic<int64_t>[per_connection]);
+            std::atomic<long> received(0);
+
+            std::thread reader([&]() {
+                read_lines(fd, [&](const std::string& line) {
+                    int64_t now = Clock::now().time_since_epoch().count();
+                    json response = json::parse(line);
+                    long id = response.value("id", 0L);
+
+                    if (response.contains("error")) {
+                        errors++;
+                    }
+
+                    latencies[c * per_connection + id] = now - sent[id].load();
+                    return ++received < per_connection;
+                });
+            });
+
+            for (long i = 0; i < per_connection; i++) {
+                // Keep at most window requests in flight
+                while (i - received.load() >= window) {
+                    std::this_thread::yield();
+                }
+
+                json request = {{"id", i}, {"op", ops[i % 4]}, {"lang", lang}, {"text", words[i % words.size()]}};
+
+                sent[i] = Clock::now().time_since_epoch().count();
+
+                if (!write_all(fd, request.dump() + "\n")) {
+                    break;
+                }
+            }
+
+            reader.join();
+            close(fd);
+        }));
+    }
+
+    for (auto& connection: connections) {
+        connection.join();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+        size_t i = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+        return std::chrono::duration<double, std::micro>(Clock::duration(latencies[i])).count();
+    };
+
+    json report;
+    report["requests"] = latencies.size();
+    report["connections"] = num_connections;
+    report["seconds"] = seconds;
+    report["requests_per_second"] = latencies.size() / seconds;
+    report["errors"] = errors.load();
+    report["latency_us"] = {{"p50", percentile(0.5)}, {"p99", percentile(0.99)}, {"max", percentile(1.0)}};
+
+    std::cout << report.dump(4) << "\n";
+
+    return errors > 0 ? 1 : 0;
+}
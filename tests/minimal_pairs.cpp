@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "wordlist.h"
+#include "minimalpairs.h"
+#include "metrics.h"
+
+/*
+ * Counts minimal pairs per contrast in a lexicon read from stdin
+ *
+ * Usage: minimal_pairs <language> [--pairs]
+ * Each line of input is one word, with phoneme symbols separated by spaces.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: minimal_pairs <language> [--pairs] [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    bool print_pairs = argc > 2 && std::string(argv[2]) == "--pairs";
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    WordList words;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else if (!word.empty()) {
+            words.add(word);
+        }
+    }
+
+    MinimalPairs minimal_pairs(inventory);
+    minimal_pairs.find(words, print_pairs);
+
+    for (auto const& contrast: minimal_pairs.get_contrasts()) {
+        std::cout << "/" << inventory.render({contrast.first}) << "/~/"
+                  << inventory.render({contrast.second}) << "/: " << contrast.count << "\n";
+    }
+
+    if (print_pairs) {
+        std::cout << "\n";
+
+        for (auto const& pair: minimal_pairs.get_pairs()) {
+            std::cout << inventory.render(words.get_word(pair.first)) << " ~ "
+                      << inventory.render(words.get_word(pair.second)) << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <chrono>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "distance.h"
+#include "metrics.h"
+
+/*
+ * Finds near-homophones in a lexicon read from stdin
+ *
+ * Usage: neighbours <language> <radius>
+ * Each line of input is one word, with phoneme symbols separated by spaces.
+ * Distances are weighted by the number of feature nibbles that differ.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 3) {
+        std::cerr << "Usage: neighbours <language> <radius> [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    int radius = std::atoi(argv[2]);
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    SimilarityIndex index(inventory);
+
+    std::vector<std::vector<unsigned int>> lexicon;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else if (!word.empty()) {
+            index.insert(word);
+            lexicon.push_back(word);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto const& word: lexicon) {
+        std::vector<std::pair<unsigned int, int>> matches = index.within(word, radius);
+
+        if (matches.size() <= 1) {
+            continue;
+        }
+
+        std::cout << inventory.render(word) << ":";
+
+        for (auto const& match: matches) {
+            if (match.second > 0) {
+                std::cout << " " << inventory.render(index.get_word(match.first)) << " (" << match.second << ")";
+            }
+        }
+
+        std::cout << "\n";
+    }
+
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << index.get_word_count() << " words, "
+              << (lexicon.empty() ? 0 : elapsed / lexicon.size()) << " us per query\n";
+
+    return 0;
+}
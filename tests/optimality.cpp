@@ -0,0 +1,94 @@
+#include <chrono>
+#include <iostream>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "wordlist.h"
+#include "optimality.h"
+#include "metrics.h"
+
+/*
+ * Finds the optimal output of every word read from stdin under a ranking of
+ * constraints
+ *
+ * Usage: optimality <language> [constraints.csv]
+ * Each line of input is one word, with phoneme symbols separated by spaces.
+ * Every word is printed with its winner and the violations of both, in
+ * ranking order.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: optimality <language> [constraints.csv] [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string path = argc > 2 ? argv[2] : "langs/" + lang + "/phonology/constraints.csv";
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    Grammar grammar(inventory);
+
+    if (grammar.load(path)) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    WordList inputs, outputs;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else {
+            inputs.add(word);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    grammar.evaluate(inputs, outputs);
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Ranking:";
+
+    for (int k = 0; k < grammar.get_constraint_count(); k++) {
+        std::cout << (k > 0 ? " >> " : " ") << grammar.get_constraint(k).name;
+    }
+
+    std::cout << "\n";
+
+    for (unsigned int w = 0; w < inputs.size(); w++) {
+        Violations faithful, winner;
+        grammar.assess(inputs.get(w), inputs.get(w), inputs.length(w), faithful);
+        grammar.assess(inputs.get(w), outputs.get(w), inputs.length(w), winner);
+
+        std::cout << "/" << inventory.render(inputs.get_word(w)) << "/ -> [" << inventory.render(outputs.get_word(w)) << "]";
+
+        for (int k = 0; k < grammar.get_constraint_count(); k++) {
+            std::cout << (k > 0 ? " " : "  ") << winner.counts[k];
+        }
+
+        std::cout << "  (faithful:";
+
+        for (int k = 0; k < grammar.get_constraint_count(); k++) {
+            std::cout << " " << faithful.counts[k];
+        }
+
+        std::cout << ")\n";
+    }
+
+    std::cerr << inputs.size() << " words, " << grammar.get_state_count() << " states, "
+              << (inputs.size() == 0 ? 0 : elapsed / inputs.size()) << " us per word\n";
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "orthography.h"
+#include "metrics.h"
+
+/*
+ * Converts between a language's spelling and its phonemes
+ *
+ * Usage:
+ *  orthography <language> read     spelled text -> one word per line, phoneme symbols separated by spaces
+ *  orthography <language> write    one word per line, phoneme symbols separated by spaces -> spelling
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 3) {
+        std::cerr << "Usage: orthography <language> read|write [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string command = argv[2];
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    Orthography orthography(inventory);
+
+    if (orthography.load(lang, inventory)) {
+        std::cerr << "Could not open " << lang << "'s orthography\n";
+        return 1;
+    }
+
+    if (command == "read") {
+        std::stringstream ss;
+        ss << std::cin.rdbuf();
+
+        WordList words;
+        size_t skipped = orthography.read(ss.str(), words);
+        std::string output;
+
+        for (unsigned int w = 0; w < words.size(); w++) {
+            const unsigned int* word = words.get(w);
+
+            for (int i = 0; i < words.length(w); i++) {
+                output += (i > 0 ? " " : "") + inventory.get_symbol(inventory.index_of(word[i]));
+            }
+
+            output += "\n";
+        }
+
+        std::cout << output;
+        std::cerr << words.size() << " words, " << skipped << " bytes skipped\n";
+    } else if (command == "write") {
+        WordList words;
+        std::string line;
+
+        while (getline(std::cin, line)) {
+            std::vector<unsigned int> word;
+
+            if (inventory.parse(line, word)) {
+                std::cerr << "Unknown phoneme in '" << line << "'\n";
+            } else if (!word.empty()) {
+                words.add(word);
+            }
+        }
+
+        std::string output;
+        orthography.write(words, output);
+
+        std::cout << output;
+    } else {
+        std::cerr << "Unknown command " << command << "\n";
+        return 1;
+    }
+
+    return 0;
+}
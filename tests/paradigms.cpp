@@ -0,0 +1,81 @@
+#include <iostream>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "morphology.h"
+#include "metrics.h"
+
+/*
+ * Generates the paradigm of every stem read from stdin
+ *
+ * Usage: paradigms <language> [rules.csv]
+ * Each line of input is one stem, with phoneme symbols separated by spaces.
+ * Affixes and slots are read from langs/<language>/morphology.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: paradigms <language> [rules.csv] [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string path = argc > 2 ? argv[2] : "langs/" + lang + "/phonology/rules.csv";
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    std::vector<Rule> rules;
+
+    if (load_rules(path, rules)) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    Morphology morphology;
+
+    if (morphology.load(lang, inventory)) {
+        std::cerr << "Could not open the morphology of " << lang << "\n";
+        return 1;
+    }
+
+    WordList stems;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else if (!word.empty()) {
+            stems.add(word);
+        }
+    }
+
+    Paradigms paradigms;
+
+    if (paradigms.generate(morphology, inventory, rules, stems)) {
+        return 1;
+    }
+
+    for (unsigned int s = 0; s < paradigms.get_stem_count(); s++) {
+        std::cout << "/" << inventory.render(stems.get_word(s)) << "/\n";
+
+        for (int k = 0; k < paradigms.get_slot_count(); k++) {
+            std::cout << "\t" << morphology.get_slot_name(k) << ": "
+                      << inventory.render(paradigms.get_form(s, k)) << "\n";
+        }
+    }
+
+    std::cerr << paradigms.get_stem_count() << " stems, " << paradigms.get_slot_count() << " slots, "
+              << paradigms.get_memory() << " bytes\n";
+
+    return 0;
+}
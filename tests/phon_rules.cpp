@@ -1,7 +1,10 @@
 #include <iostream>
-#include <functional>
 
 #include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "derivation.h"
+#include "metrics.h"
 
 /*
  * Given a vector of phonemes, print out their symbols
@@ -10,21 +13,9 @@ static std::string get_representation(std::map<unsigned int, Consonant>&,
                                       std::map<unsigned int, Vowel>&,
                                       std::vector<unsigned int>&);
 
-/*
- * Applies an assimilation rule to a sequence of phonemes
- *
- * cur_class -> res_class / prev_class _ next_class
- *
- */
-static std::vector<unsigned int> assim_rule(std::map<unsigned int, Consonant>&,
-                                            std::map<unsigned int, Vowel>&,
-                                            unsigned int,
-                                            unsigned int,
-                                            unsigned int,
-                                            unsigned int,
-                                            std::vector<unsigned int>&);
-
-int main() {
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
     SoundSystem soundSystem("preset01");
     soundSystem.load();
 
@@ -32,13 +23,13 @@ int main() {
     std::map<unsigned int, Vowel> vowels = soundSystem.get_vowels();
     std::map<std::string, unsigned int> ids = soundSystem.get_ids();
 
+    Inventory inventory(soundSystem);
+
     // high vowel -> voiceless / voiceless consonant _ voiceless consonant
-    auto voicing_rule = std::bind(assim_rule, consonants, vowels,
-                                  0x20012, 0x10012, 0x100001, 0x100001, std::placeholders::_1);
+    Rule voicing_rule(0x20012, 0x10012, 0x100001, 0x100001);
 
     // plosive -> nasal / _ nasal consonant
-    auto plosive_rule = std::bind(assim_rule, consonants, vowels,
-                                  0x10011, 0x20011, 0x0, 0x20011, std::placeholders::_1);
+    Rule plosive_rule(0x10011, 0x20011, 0x0, 0x20011);
 
     /*
      * Use ids map to retrieve phoneme given a symbol,
@@ -88,13 +79,13 @@ int main() {
     }; // sobni
 
     // Apply voicing rule
-    std::vector<unsigned int> rep1 = voicing_rule(word1); // su̥tuji
-    std::vector<unsigned int> rep2 = voicing_rule(word2); // kuʒin
-    std::vector<unsigned int> rep3 = voicing_rule(word3); // zosi̥ka
+    std::vector<unsigned int> rep1 = voicing_rule.apply(inventory, word1); // su̥tuji
+    std::vector<unsigned int> rep2 = voicing_rule.apply(inventory, word2); // kuʒin
+    std::vector<unsigned int> rep3 = voicing_rule.apply(inventory, word3); // zosi̥ka
 
     // Apply plosive rule
-    std::vector<unsigned int> rep4 = plosive_rule(word4); // vennel
-    std::vector<unsigned int> rep5 = plosive_rule(word5); // somni
+    std::vector<unsigned int> rep4 = plosive_rule.apply(inventory, word4); // vennel
+    std::vector<unsigned int> rep5 = plosive_rule.apply(inventory, word5); // somni
 
     std::cout << "high vowel -> voiceless / voiceless consonant _ voiceless consonant\n"
               << "/" << get_representation(consonants, vowels, word1) << "/ --> ["
@@ -110,6 +101,78 @@ int main() {
               << "/" << get_representation(consonants, vowels, word5) << "/ --> ["
               << get_representation(consonants, vowels, rep5)  << "]\n";
 
+    /*
+     * Derive the words through both rules, then edit the cascade.
+     * Only words the edit can affect are derived again.
+     */
+    std::vector<unsigned int> word6 = {
+        ids["s"],
+        ids["o"],
+        ids["t"],
+        ids["u"]
+    }; // sotu
+
+    // No plosives, so editing the plosive rule leaves them alone
+    std::vector<unsigned int> word7 = {
+        ids["m"],
+        ids["a"],
+        ids["z"],
+        ids["i"]
+    }; // mazi
+
+    std::vector<unsigned int> word8 = {
+        ids["n"],
+        ids["a"],
+        ids["s"],
+        ids["u"]
+    }; // nasu
+
+    Derivation derivation(soundSystem, {voicing_rule, plosive_rule});
+    std::vector<std::vector<unsigned int>> words = {word1, word2, word3, word4, word5, word6, word7, word8};
+
+    for (auto const& word: words) {
+        derivation.add_word(word);
+    }
+
+    // plosive -> nasal / nasal consonant _
+    long applied = derivation.set_rule(1, Rule(0x10011, 0x20011, 0x20011, 0x0));
+
+    std::cout << "\nplosive -> nasal / nasal consonant _\n"
+              << applied << " rule applications for " << words.size() << " words\n";
+
+    // The voicing rule is blocked on /o/ until a voiceless /o/ exists
+    applied = derivation.insert_vowel("o̥", 0x11212332);
+
+    std::cout << "\ninsert [o̥]\n"
+              << applied << " rule applications for " << words.size() << " words\n";
+
+    for (unsigned int i = 0; i < derivation.get_word_count(); i++) {
+        std::cout << "/" << derivation.get_inventory().render(derivation.get_form(i, 0)) << "/ --> ["
+                  << derivation.get_inventory().render(derivation.get_surface(i)) << "]\n";
+    }
+
+    /*
+     * Rounding harmony along the vowel tier, across any number of consonants.
+     * The rule is blocked on /a/, which has no rounded counterpart.
+     */
+    Rule harmony_rule(0x1102, 0x2302, 0x2302, 0x0);
+    harmony_rule.set_projection(0x2, 0x0, 0x0, true);
+
+    Rule agreement_rule = harmony_rule;
+    agreement_rule.set_projection(0x2, 0x0, 0x0, false);
+
+    Rule transparent_rule = harmony_rule;
+    transparent_rule.set_projection(0x2, 0x72, 0x0, true);
+
+    std::vector<unsigned int> word9 = {ids["s"], ids["u"], ids["t"], ids["i"], ids["n"], ids["e"]}; // sutine
+    std::vector<unsigned int> word10 = {ids["s"], ids["u"], ids["k"], ids["a"], ids["n"], ids["i"]}; // sukani
+
+    std::cout << "\nfront unrounded vowel -> back rounded / back rounded vowel _ on the vowel tier\n"
+              << "/" << inventory.render(word9) << "/ --> [" << inventory.render(harmony_rule.apply(inventory, word9))
+              << "] spreading, [" << inventory.render(agreement_rule.apply(inventory, word9)) << "] agreeing\n"
+              << "/" << inventory.render(word10) << "/ --> [" << inventory.render(harmony_rule.apply(inventory, word10))
+              << "], [" << inventory.render(transparent_rule.apply(inventory, word10)) << "] with /a/ transparent\n";
+
     return 0;
 }
 
@@ -131,54 +194,3 @@ static std::string get_representation(std::map<unsigned int, Consonant>& consona
 
     return output;
 }
-
-static std::vector<unsigned int> assim_rule(std::map<unsigned int, Consonant>& consonants,
-                                            std::map<unsigned int, Vowel>& vowels,
-                                            unsigned int cur_class,
-                                            unsigned int res_class,
-                                            unsigned int prev_class,
-                                            unsigned int next_class,
-                                            std::vector<unsigned int>& word) {
-
-    std::vector<unsigned int> output;
-    int len = word.size();
-
-    for(int i = 0; i < len; i ++) {
-        unsigned int cur_id = word[i], new_id = 0x0;
-
-        // Apply rule
-        if (prev_class != 0 && next_class != 0) { // Environment: prev_class _ next_class
-            if (i - 1 >= 0
-                && i + 1 < len
-                && (word[i - 1] & prev_class) == prev_class
-                && (word[i + 1] & next_class) == next_class
-                && (cur_id & cur_class) == cur_class) {
-
-                    new_id = cur_id + (res_class - cur_class);
-            }
-        } else if (prev_class != 0) { // Environment: prev_class _
-            if (i - 1 >= 0
-                && (word[i - 1] & prev_class) == prev_class
-                && (cur_id & cur_class) == cur_class) {
-
-                    new_id = cur_id + (res_class - cur_class);
-            }
-        } else { // Environment: _ next_class
-            if (i + 1 < len
-                && (word[i + 1] & next_class) == next_class
-                && (cur_id & cur_class) == cur_class) {
-
-                    new_id = cur_id + (res_class - cur_class);
-            }
-        }
-
-        // Only push id to output if id exists in the current sound system
-        if(consonants.find(new_id) != consonants.end() || vowels.find(new_id) != vowels.end()) {
-            output.push_back(new_id);
-        } else {
-            output.push_back(cur_id);
-        }
-    }
-
-    return output;
-}
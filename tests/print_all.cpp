@@ -2,8 +2,10 @@
 #include <iomanip>
 
 #include "soundsystem.h"
+#include "metrics.h"
 
-int main() {
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
 
     SoundSystem soundSystem("preset01");
     soundSystem.load();
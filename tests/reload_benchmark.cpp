@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "registry.h"
+#include "watcher.h"
+#include "metrics.h"
+
+/*
+ * Measures how quickly edited language files are reloaded and what readers
+ * pay for it
+ *
+ * Usage: reload_benchmark [language] [--readers N] [--reloads N] [--poll]
+ * Copies a language to langs/<language>_reload and serves it from a
+ * registry. Readers look the language up and derive a word over and over,
+ * first alone and then while its rules.csv is rewritten --reloads times
+ * (20 by default). Prints the time from each write to the new version being
+ * published, the cost of a lookup next to a mutex guarded map, and the
+ * readers' throughput with and without reloads. Readers check that every
+ * version they see is complete.
+ */
+
+#define MIN_TIME 0.5    // Seconds per reader measurement
+#define RELOAD_TIMEOUT 10.0     // Seconds to wait for a reload before giving up
+
+// Results are added here so the compiler cannot drop the work
+static volatile long sink;
+
+static bool copy_file(const std::string& from, const std::string& to) {
+    std::ifstream input(from, std::ios::binary);
+    std::ofstream output(to, std::ios::binary);
+
+    output << input.rdbuf();
+    return !input.is_open() || !output;
+}
+
+static std::vector<std::string> list_files(const std::string& path) {
+    std::vector<std::string> files;
+    DIR* handle = opendir(path.c_str());
+
+    if (handle == nullptr) {
+        return files;
+    }
+
+    while (dirent* entry = readdir(handle)) {
+        if (entry->d_name[0] != '.') {
+            files.push_back(entry->d_name);
+        }
+    }
+
+    closedir(handle);
+    return files;
+}
+
+/* Copy the units and phonology of a language, returns true on failure */
+static bool copy_language(const std::string& from, const std::string& to) {
+    mkdir(("langs/" + to).c_str(), 0755);
+
+    for (std::string dir: {"units", "phonology"}) {
+        mkdir(("langs/" + to + "/" + dir).c_str(), 0755);
+
+        for (auto const& file: list_files("langs/" + from + "/" + dir)) {
+            if (copy_file("langs/" + from + "/" + dir + "/" + file, "langs/" + to + "/" + dir + "/" + file)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void remove_language(const std::string& name) {
+    for (std::string dir: {"units", "phonology"}) {
+        std::string path = "langs/" + name + "/" + dir;
+
+        for (auto const& file: list_files(path)) {
+            unlink((path + "/" + file).c_str());
+        }
+
+        rmdir(path.c_str());
+    }
+
+    rmdir(("langs/" + name).c_str());
+}
+
+struct ReaderResult {
+    long operations = 0;
+    long versions = 0;          // Different versions seen
+    long broken = 0;            // Versions that were not complete
+    const Language* last = nullptr;
+    long sum = 0;               // Of the results, kept per reader so readers share no cache line
+};
+
+/* Nanoseconds per operation of readers running op until stop is set, or for MIN_TIME if it is never set */
+template<typename Operation>
+static double run_readers(int readers, std::atomic<bool>& stop, bool timed, Operation op,
+                          std::vector<ReaderResult>& results) {
+
+    std::vector<std::thread> threads;
+    results.assign(readers, ReaderResult());
+    auto start = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < readers; t++) {
+        threads.push_back(std::thread([&, t]() {
+            ReaderResult& result = results[t];
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) {
+                    op(result);
+                }
+
+                result.operations += 64;
+
+                if (timed && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > MIN_TIME) {
+                    break;
+                }
+            }
+        }));
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long operations = 0;
+
+    for (auto const& result: results) {
+        operations += result.operations;
+        sink += result.sum;
+    }
+
+    // Per operation of one reader
+    return elapsed * 1e9 * readers / std::max(operations, 1L);
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    bool named = argc > 1 && argv[1][0] != '-';
+    std::string lang = named ? argv[1] : "preset01";
+    int readers = 2, reloads = 20;
+    bool poll = false;
+
+    for (int i = named ? 2 : 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--readers" && i + 1 < argc) {
+            readers = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--reloads" && i + 1 < argc) {
+            reloads = std::stoi(argv[++i]);
+        } else if (arg == "--poll") {
+            poll = true;
+        } else {
+            std::cerr << "Usage: reload_benchmark [language] [--readers N] [--reloads N] [--poll] [--stats]\n";
+            return 1;
+        }
+    }
+
+    std::string name = lang + "_reload";
+    std::string rules_path = "langs/" + name + "/phonology/rules.csv";
+
+    if (copy_language(lang, name)) {
+        std::cerr << "Could not copy " << lang << " to " << name << "\n";
+        remove_language(name);
+        return 1;
+    }
+
+    Registry registry;
+
+    if (registry.load(name)) {
+        remove_language(name);
+        return 1;
+    }
+
+    std::string rules;
+    {
+        std::ifstream file(rules_path);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        rules = ss.str();
+    }
+
+    if (rules.empty()) {
+        rules = "cur,res,prev,next\n";
+    } else if (rules.back() != '\n') {
+        rules += '\n';
+    }
+
+    int rule_count = registry.get(name)->get_cascade().get_interactions().get_rule_count();
+    int inventory_size = registry.get(name)->get_inventory().size();
+    std::vector<unsigned int> word(registry.get(name)->get_inventory().get_ids().begin(),
+                                   registry.get(name)->get_inventory().get_ids().begin() + std::min(inventory_size, 6));
+
+    // Lookups alone, against a map behind a mutex as the registry used to be
+    std::atomic<bool> stop(false);
+    std::vector<ReaderResult> results;
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<const Language>> locked = {{name, registry.get(name)}};
+
+    double read_ns = run_readers(readers, stop, true, [&](ReaderResult& result) {
+        registry.read(name, [&](const Language* language) { result.sum += language != nullptr; });
+    }, results);
+
+    double get_ns = run_readers(readers, stop, true, [&](ReaderResult& result) {
+        result.sum += registry.get(name) != nullptr;
+    }, results);
+
+    double locked_ns = run_readers(readers, stop, true, [&](ReaderResult& result) {
+        std::shared_ptr<const Language> language;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            language = locked.find(name)->second;
+        }
+        result.sum += language != nullptr;
+    }, results);
+
+    locked.clear();
+
+    // Every version a reader sees has one of the two rule lists and the whole inventory
+    auto derive = [&](ReaderResult& result) {
+        registry.read(name, [&](const Language* language) {
+            int count = language->get_cascade().get_interactions().get_rule_count();
+
+            if (language != result.last) {
+                result.last = language;
+                result.versions++;
+                result.broken += language->get_inventory().size() != inventory_size
+                              || (count != rule_count && count != rule_count + 1);
+            }
+
+            std::vector<unsigned int> output = language->get_cascade().apply(word);
+            result.sum += output.empty() ? 0 : output[0];
+        });
+    };
+
+    double quiet_ns = run_readers(readers, stop, true, derive, results);
+
+    // Rewrite the rules while the readers run, alternating with an extra identity rule
+    Watcher watcher(registry, poll);
+
+    if (watcher.start()) {
+        std::cerr << "Could not start the watcher\n";
+        remove_language(name);
+        return 1;
+    }
+
+    // Let the watcher find the language
+    std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL + 100));
+
+    std::vector<double> latencies;
+    std::thread writer([&]() {
+        for (int r = 0; r < reloads; r++) {
+            unsigned long version = registry.get_version();
+            {
+                std::ofstream file(rules_path);
+                file << rules << (r % 2 == 0 ? "0,0,0,0\n" : "");
+            }
+
+            auto written = std::chrono::steady_clock::now();
+            double waited = 0;
+
+            while (registry.get_version() == version && waited < RELOAD_TIMEOUT) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - written).count();
+            }
+
+            if (waited >= RELOAD_TIMEOUT) {
+                std::cerr << "No reload after " << RELOAD_TIMEOUT << " s\n";
+                break;
+            }
+
+            latencies.push_back(waited * 1000);
+
+            // Spread the reloads out a little so readers run in between
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        stop = true;
+    });
+
+    double reload_ns = run_readers(readers, stop, false, derive, results);
+    writer.join();
+    watcher.stop();
+
+    long versions = 0, broken = 0;
+
+    for (auto const& result: results) {
+        versions += result.versions;
+        broken += result.broken;
+    }
+
+    double total = 0, worst = 0;
+
+    for (auto const& latency: latencies) {
+        total += latency;
+        worst = std::max(worst, latency);
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << (watcher.is_polling() ? "polling" : "inotify") << ", " << readers << " readers\n";
+    std::cout << "lookup ns: " << read_ns << " read(), " << get_ns << " get(), " << locked_ns << " map with a mutex\n";
+    std::cout << "derive ns per reader: " << quiet_ns << " without reloads, " << reload_ns << " during reloads\n";
+    std::cout << "reloads: " << latencies.size() << " of " << reloads << ", latency ms mean "
+              << (latencies.empty() ? 0 : total / latencies.size()) << " max " << worst
+              << " (includes " << WATCH_SETTLE << " ms settle)\n";
+    std::cout << "reader versions seen: " << versions << ", incomplete: " << broken << "\n";
+
+    remove_language(name);
+
+    return broken > 0 || static_cast<int>(latencies.size()) < reloads ? 1 : 0;
+}
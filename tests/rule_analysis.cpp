@@ -0,0 +1,207 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "interaction.h"
+#include "metrics.h"
+
+/*
+ * Reports how the rules of a language interact and how many passes they need
+ *
+ * Usage: rule_analysis [language] [--random N] [--words N]
+ * Prints every pair of rules where the earlier affects the later and the
+ * rules of each pass, then derives random words applying the rules one at a
+ * time and a pass at a time, and checks both give the same outputs. With
+ * --random the rules of the language are replaced by N random rules over
+ * its inventory, and only the number of dependencies is printed.
+ */
+
+#define MIN_TIME 0.2    // Seconds per measurement
+
+// Results are added here so the compiler cannot drop the work
+static volatile long sink;
+
+/* A class of the type and one random feature nibble of a phoneme */
+static unsigned int random_class(unsigned int id, std::mt19937& rng) {
+    int nibble = 1 + rng() % 6;
+    return (id & 0xf) | (id & (0xfu << (4 * nibble)));
+}
+
+/* Change one feature of the phonemes of a class to the value another phoneme of the same type has */
+static Rule random_rule(const Inventory& inventory, std::mt19937& rng) {
+    unsigned int a = inventory.get_id(rng() % inventory.size());
+    unsigned int b = inventory.get_id(rng() % inventory.size());
+
+    for (int tries = 0; tries < 100 && (a & 0xf) != (b & 0xf); tries++) {
+        b = inventory.get_id(rng() % inventory.size());
+    }
+
+    int nibble = 1 + rng() % 6;
+    unsigned int mask = 0xfu << (4 * nibble);
+    unsigned int cur_class = (a & 0xf) | (a & mask);
+    unsigned int res_class = (a & 0xf) | (b & mask);
+
+    unsigned int prev_class = rng() % 2 ? 0x0 : random_class(inventory.get_id(rng() % inventory.size()), rng);
+    unsigned int next_class = prev_class != 0 && rng() % 2 ? 0x0
+                            : random_class(inventory.get_id(rng() % inventory.size()), rng);
+
+    return Rule(cur_class, res_class, prev_class, next_class);
+}
+
+/* Nanoseconds per word of deriving every word with fn */
+template<typename Derive>
+static double measure(const std::vector<std::vector<unsigned int>>& words, Derive fn) {
+    auto start = std::chrono::steady_clock::now();
+    long count = 0;
+    double elapsed;
+
+    do {
+        for (auto const& word: words) {
+            sink += fn(word);
+        }
+
+        count += words.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < MIN_TIME);
+
+    return elapsed * 1e9 / count;
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    std::string lang = argc > 1 && argv[1][0] != '-' ? argv[1] : "preset01";
+    int random_rules = 0, num_words = 10000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--random" && i + 1 < argc) {
+            random_rules = std::stoi(argv[++i]);
+        } else if (arg == "--words" && i + 1 < argc) {
+            num_words = std::stoi(argv[++i]);
+        }
+    }
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Usage: rule_analysis [language] [--random N] [--words N] [--stats]\n";
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    std::vector<Rule> rules;
+    std::mt19937 rng(42);
+
+    if (random_rules > 0) {
+        for (int r = 0; r < random_rules; r++) {
+            rules.push_back(random_rule(inventory, rng));
+        }
+    } else if (load_rules("langs/" + lang + "/phonology/rules.csv", rules)) {
+        std::cerr << "Could not open the rules of " << lang << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Cascade cascade(inventory, rules);
+    double analysis = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Interactions& interactions = cascade.get_interactions();
+    int dependencies = 0;
+
+    // Rules are numbered from 1, as the lines of the csv after its header
+    for (int b = 0; b < interactions.get_rule_count(); b++) {
+        for (int a = 0; a < b; a++) {
+            if (!interactions.depends(a, b)) {
+                continue;
+            }
+
+            dependencies++;
+
+            if (random_rules == 0) {
+                std::cout << "rule " << a + 1 << " " << interaction_names(interactions.get(a, b))
+                          << " rule " << b + 1 << "\n";
+            }
+        }
+    }
+
+    if (random_rules == 0) {
+        auto passes = interactions.get_passes();
+
+        for (size_t p = 0; p < passes.size(); p++) {
+            std::cout << "pass " << p + 1 << ":";
+
+            for (auto const& r: passes[p]) {
+                std::cout << " " << r + 1;
+            }
+
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << rules.size() << " rules, " << dependencies << " dependencies, "
+              << cascade.get_pass_count() << " passes (analysed in " << analysis * 1e3 << " ms)\n";
+
+    // Random words of 3 to 8 phonemes, some with a boundary
+    std::vector<std::vector<unsigned int>> words;
+
+    for (int w = 0; w < num_words; w++) {
+        std::vector<unsigned int> word(3 + rng() % 6);
+
+        for (auto& id: word) {
+            id = inventory.get_id(rng() % inventory.size());
+        }
+
+        if (rng() % 4 == 0) {
+            word[1 + rng() % (word.size() - 2)] = MORPHEME_BOUNDARY;
+        }
+
+        words.push_back(word);
+    }
+
+    int differing = 0;
+
+    for (auto const& word: words) {
+        std::vector<unsigned int> output = word;
+
+        for (auto const& rule: rules) {
+            output = rule.apply(inventory, output);
+        }
+
+        differing += output != cascade.apply(word);
+    }
+
+    // Both apply each step from one buffer to another
+    std::vector<unsigned int> a, b;
+
+    double in_order = measure(words, [&](const std::vector<unsigned int>& word) {
+        a = word;
+        b.resize(word.size());
+
+        for (auto const& rule: rules) {
+            rule.apply(inventory, a.data(), b.data(), a.size());
+            a.swap(b);
+        }
+
+        return static_cast<long>(a[0]);
+    });
+
+    double by_pass = measure(words, [&](const std::vector<unsigned int>& word) {
+        a.resize(word.size());
+        cascade.apply(word.data(), a.data(), word.size());
+        return static_cast<long>(a[0]);
+    });
+
+    std::cout << "ns per word: " << in_order << " in order, " << by_pass << " by pass\n";
+    std::cout << (differing == 0 ? "outputs identical" : std::to_string(differing) + " outputs differ")
+              << " on " << words.size() << " words\n";
+
+    return differing != 0;
+}
@@ -1,13 +1,13 @@
 #include <iostream>
 #include <sstream>
-#include <fstream>
 #include <set>
 #include <algorithm>
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
 
 #include "../include/soundsystem.h"
+#include "../include/phonotactics.h"
+#include "../include/inventory.h"
+#include "../include/writer.h"
+#include "../include/metrics.h"
 
 template<typename value>
 std::set<unsigned int> get_keys(std::map<unsigned int, value> const& map) {
@@ -20,20 +20,12 @@ std::set<unsigned int> get_keys(std::map<unsigned int, value> const& map) {
     return output;
 }
 
-bool insert_sequences(std::string, std::string, std::vector<std::vector<unsigned int>>);
-
-std::vector<std::vector<unsigned int>> create_sequences(std::map<unsigned int, Consonant>&,
-                                                        std::map<unsigned int, Vowel>&,
-                                                        std::set<unsigned int>&,
-                                                        std::vector<unsigned int>&);
-
 void print_ids(std::map<unsigned int, Consonant>&,
                std::map<unsigned int, Vowel>&,
                std::vector<std::vector<unsigned int>>&);
 
-bool in_class(unsigned int, unsigned int);
-
-int main () {
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
 
     // Prompt for language
     bool done = false;
@@ -60,9 +52,13 @@ int main () {
 
     ids.insert(temp.begin(), temp.end());
 
+    Inventory inventory(sound_system);
+
     std::cout << "Commands:\n\n[onset|nucleus|coda] [natural class as ID]+\n"
               << "\tonset 0000011\t\t allow single pulmonic consonants to appear in the onset\n"
               << "\tnucleus 11221172 12\t allow diphtongs of the form [a][high vowel] to appear in the nucleus\n"
+              << "\nexport [ndjson|csv|binary] [path] [natural class as ID]+\n"
+              << "\texport csv cc.csv 1 1\t write every sequence of two consonants to cc.csv\n"
               << "\n----------\n";
 
     while (!done) {
@@ -107,7 +103,7 @@ int main () {
 
                     if (!failed) {
                         // Create sequences
-                        std::vector<std::vector<unsigned int>> sequences = create_sequences(consonants, vowels, ids, classes);
+                        std::vector<std::vector<unsigned int>> sequences = create_sequences(ids, classes);
 
                         if (sequences.size() != 0) {
 
@@ -135,86 +131,48 @@ int main () {
                         }
                     }
                 }
-            } else {
-                std::cout << "Invalid command\n\n";
-            }
-        }
-    }
-
-
-    return 0;
-}
-
-bool insert_sequences(std::string part, std::string lang, std::vector<std::vector<unsigned int>> sequences) {
-
-    int num_added = 0;
-
-    // Read from file
-    std::ifstream in_file("langs/" + lang + "/phonology/phonotactics.json");
-    json data = json::parse(in_file);
-    in_file.close();
-
-    std::vector<std::vector<unsigned int>> old_sequences = data["inventory"][part];
-
-    // Add new sequences to vector
-    for (auto const& sequence: sequences) {
-        if (std::find(old_sequences.begin(), old_sequences.end(), sequence) == old_sequences.end()) {
-            old_sequences.push_back(sequence);
-            num_added++;
-        }
-    }
-
-    if (num_added == 0) {
-        return false;
-    }
-
-    data["inventory"][part] = old_sequences;
-
-    // Write to file
-    std::ofstream out_file("langs/" + lang + "/phonology/phonotactics.json");
-    out_file << data.dump(4) << "\n";
-    out_file.close();
-    return true;
-}
+            } else if (tokens[0] == "export") {
+                Format format;
+                std::vector<unsigned int> classes;
+                bool failed = false;
+
+                if (tokens.size() < 4 || parse_format(tokens[1], format)) {
+                    std::cerr << "export requires a format (ndjson, csv or binary), a path and at least one natural class\n\n";
+                    continue;
+                }
 
-std::vector<std::vector<unsigned int>> create_sequences(std::map<unsigned int, Consonant>& consonants,
-                                                        std::map<unsigned int, Vowel>& vowels,
-                                                        std::set<unsigned int>& ids,
-                                                        std::vector<unsigned int>& classes) {
+                for (size_t i = 3; i < tokens.size(); i++) {
+                    try {
+                        classes.push_back(std::stoul(tokens[i], nullptr, 16));
+                    } catch (...) {
+                        std::cerr << "Failed to convert '" << tokens[i] << "' into an integer\n\n";
+                        failed = true;
+                        break;
+                    }
+                }
 
-    std::vector<std::vector<unsigned int>> phonemes;
+                if (failed) {
+                    continue;
+                }
 
-    // Search for phonemes
-    for (auto const& phon_class: classes) {
-        std::vector<unsigned int> temp;
+                // Sequences are streamed one at a time, never held in memory
+                Sequences sequences(ids, classes);
+                Writer writer(format, &inventory);
 
-        for (auto const& id: ids) {
-            if (in_class(id, phon_class)) {
-                temp.push_back(id);
+                if (writer.open(tokens[2]) || writer.write_all(sequences) || writer.close()) {
+                    std::cerr << "Could not write to " << tokens[2] << "\n\n";
+                } else {
+                    std::cout << std::dec << "Exported " << writer.get_words() << " sequences ("
+                              << writer.get_bytes() << " bytes) to " << tokens[2] << "\n\n";
+                }
+            } else {
+                std::cout << "Invalid command\n\n";
             }
         }
-
-        phonemes.push_back(temp);
     }
 
-    // Create sequences
-    std::vector<std::vector<unsigned int>> sequences(1);
-
-    for (int i = 0; i < phonemes.size(); i++) {
-        std::vector<std::vector<unsigned int>> temp;
 
-        for (auto const& sequence: sequences) {
-            for (auto const& phoneme: phonemes[i]) {
-
-                std::vector<unsigned int> temp_seq = sequence;
-                temp_seq.push_back(phoneme);
-                temp.push_back(temp_seq);
-            }
-        }
-        sequences = temp;
-    }
-
-    return sequences;
+    return 0;
 }
 
 void print_ids(std::map<unsigned int, Consonant>& consonants,
@@ -233,21 +191,3 @@ void print_ids(std::map<unsigned int, Consonant>& consonants,
     }
     std::cout << "\n";
 }
-
-bool in_class(unsigned int id, unsigned int phon_class) {
-
-    for (int i = 4; i <= 32; i += 4) {
-        unsigned long int place = 1 << i;
-        unsigned int class_digit = (phon_class % (place * 0x10)) / place;
-
-        if (class_digit != 0x0) {
-            unsigned int id_digit = (id % (place * 0x10)) / place;
-
-            if (id_digit != class_digit) {
-                return false;
-            }
-        }
-    }
-
-    return true;
-}
@@ -0,0 +1,72 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "registry.h"
+#include "server.h"
+#include "watcher.h"
+#include "metrics.h"
+
+/*
+ * Keeps languages resident and answers newline-delimited JSON requests
+ *
+ * Usage: server [--socket path] [--threads N] [--batch N] [--max-loads N] [--watch] [--poll] [language]...
+ * Requests are read from stdin unless a socket is given. The languages
+ * listed are loaded up front, up to --max-loads others (16 by default) on
+ * first use. With --watch
+ * languages are reloaded when their files change, --poll looks for changes
+ * by polling instead of inotify.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    std::string socket_path;
+    int threads = 0, batch_size = 32, max_loads = 16;
+    bool watch = false, poll = false;
+    std::vector<std::string> names;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+        } else if (arg == "--max-loads" && i + 1 < argc) {
+            max_loads = atoi(argv[++i]);
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--poll") {
+            watch = poll = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Usage: server [--socket path] [--threads N] [--batch N] [--max-loads N] [--watch] [--poll] [language]... [--stats]\n";
+            return 1;
+        } else {
+            names.push_back(arg);
+        }
+    }
+
+    Registry registry;
+
+    if (registry.load(names) > 0) {
+        return 1;
+    }
+
+    Server server(registry, threads, batch_size, max_loads);
+    Watcher watcher(registry, poll);
+
+    if (watch && watcher.start()) {
+        std::cerr << "Could not watch the language files\n";
+        return 1;
+    }
+
+    if (socket_path.empty()) {
+        server.serve_stdin();
+    } else if (server.serve_socket(socket_path)) {
+        return 1;
+    }
+
+    return 0;
+}
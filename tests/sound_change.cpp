@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "history.h"
+#include "metrics.h"
+
+/*
+ * Runs words read from stdin through an ordered list of sound changes
+ *
+ * Usage: sound_change <language> [rules.csv]
+ * Each line of input is one word, with phoneme symbols separated by spaces.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: sound_change <language> [rules.csv] [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string path = argc > 2 ? argv[2] : "langs/" + lang + "/phonology/rules.csv";
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    std::vector<Rule> rules;
+
+    if (load_rules(path, rules)) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    History history(inventory, rules);
+
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+        } else if (!word.empty()) {
+            history.add_word(word);
+        }
+    }
+
+    history.run();
+
+    int last = history.get_stage_count() - 1;
+
+    for (unsigned int w = 0; w < history.get_word_count(); w++) {
+        std::vector<unsigned int> form = history.get_form(w, 0);
+
+        std::cout << "/" << inventory.render(form) << "/ --> ["
+                  << inventory.render(history.get_form(w, last)) << "]\n";
+
+        for (auto const& step: history.trace(w)) {
+            int index = inventory.index_of(step.second.id);
+
+            std::cout << "\tstage " << std::dec << step.first << ": position " << step.second.position
+                      << " [" << inventory.render({form[step.second.position]}) << "] -> ["
+                      << (index >= 0 ? inventory.get_symbol(index) : "?") << "]\n";
+
+            form[step.second.position] = step.second.id;
+        }
+    }
+
+    std::cerr << history.get_word_count() << " words, " << last << " stages, "
+              << history.get_memory() << " bytes\n";
+
+    return 0;
+}
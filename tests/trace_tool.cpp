@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "derivation.h"
+#include "trace.h"
+#include "metrics.h"
+
+/*
+ * Records which rule changed which segment while deriving words, and
+ * decodes recorded traces
+ *
+ * Usage: trace_tool record <language> <trace file> [--sample N] [--word W] [--rule R]
+ *        trace_tool decode <language> <trace file>
+ * record derives the words read from stdin, one per line, in a Derivation
+ * and writes the changes to the traced words. Words are numbered from 0 by
+ * line and rules from 1 by their line in rules.csv. It also times deriving
+ * the words with tracing off and on. decode prints the derivation of every
+ * traced word.
+ */
+
+#define MIN_TIME 0.2    // Seconds per measurement
+#define REPETITIONS 3   // Measurements alternate between tracing off and on, keeping the best of each
+
+// Results are added here so the compiler cannot drop the work
+static volatile long sink;
+
+static void print_usage() {
+    std::cerr << "Usage: trace_tool record <language> <trace file> [--sample N] [--word W] [--rule R] [--stats]\n";
+    std::cerr << "       trace_tool decode <language> <trace file> [--stats]\n";
+}
+
+/* Symbol of a phoneme, or its ID in hex if it is not in the inventory */
+static std::string symbol(const Inventory& inventory, unsigned int id) {
+    int index = inventory.index_of(id);
+
+    if (index >= 0) {
+        return inventory.get_symbol(index);
+    }
+
+    std::stringstream ss;
+    ss << std::hex << id;
+    return ss.str();
+}
+
+/* Nanoseconds per word of applying every rule to every word, as it would be traced */
+static double measure(const Inventory& inventory, const std::vector<Rule>& rules,
+                      const std::vector<std::vector<unsigned int>>& words) {
+
+    std::vector<unsigned int> a, b;
+    auto start = std::chrono::steady_clock::now();
+    long count = 0;
+    double elapsed;
+
+    do {
+        for (size_t w = 0; w < words.size(); w++) {
+            const std::vector<unsigned int>& word = words[w];
+            bool traced = trace::begin_word(w, word.data(), word.size());
+
+            a = word;
+            b.resize(word.size());
+
+            for (size_t r = 0; r < rules.size(); r++) {
+                if (traced) {
+                    trace::set_rule(r);
+                }
+
+                rules[r].apply(inventory, a.data(), b.data(), a.size());
+                a.swap(b);
+            }
+
+            if (traced) {
+                trace::end_word();
+            }
+
+            sink += a.empty() ? 0 : a[0];
+        }
+
+        count += words.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < MIN_TIME);
+
+    return elapsed * 1e9 / count;
+}
+
+static int record(SoundSystem& sound_system, const std::vector<Rule>& rules, const std::string& path,
+                  const trace::Settings& settings) {
+
+    Inventory inventory(sound_system);
+    std::vector<std::vector<unsigned int>> words;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.tokenize(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+            word.clear();
+        }
+
+        // Unknown words keep their number as an empty word
+        words.push_back(word);
+    }
+
+    double off = -1, on = -1;
+
+    for (int r = 0; r < REPETITIONS; r++) {
+        trace::disable();
+        double ns = measure(inventory, rules, words);
+        off = off < 0 ? ns : std::min(off, ns);
+
+        trace::enable(settings);
+        ns = measure(inventory, rules, words);
+        on = on < 0 ? ns : std::min(on, ns);
+    }
+
+    // Drop the events of the measurement and trace one derivation of the lexicon
+    trace::enable(settings);
+    Derivation derivation(sound_system, rules);
+
+    for (auto const& word: words) {
+        derivation.add_word(word);
+    }
+
+    trace::disable();
+
+    long events = 0;
+
+    for (auto const& thread: trace::collect()) {
+        events += thread.size();
+    }
+
+    if (trace::write(path)) {
+        std::cerr << "Could not write " << path << "\n";
+        return 1;
+    }
+
+    std::cout << words.size() << " words, " << events << " events written to " << path << "\n";
+    std::cout << "ns per word: " << off << " untraced, " << on << " traced (1 in " << settings.sample
+              << " words), overhead " << std::fixed << std::setprecision(1) << (on / off - 1.0) * 100 << "%\n";
+
+    return 0;
+}
+
+static int decode(const Inventory& inventory, const std::vector<Rule>& rules, const std::string& path) {
+    std::vector<std::vector<trace::Event>> threads;
+
+    if (trace::read(path, threads)) {
+        std::cerr << "Could not read a trace from " << path << "\n";
+        return 1;
+    }
+
+    // Events of every word in the order they were recorded
+    std::map<uint32_t, std::vector<trace::Event>> words;
+
+    for (auto const& events: threads) {
+        for (auto const& event: events) {
+            words[event.word].push_back(event);
+        }
+    }
+
+    for (auto const& entry: words) {
+        const std::vector<trace::Event>& events = entry.second;
+        std::vector<unsigned int> form;
+        bool known = false;     // The ring may have dropped the start of a derivation
+        size_t i = 0;
+
+        std::cout << "word " << entry.first << "\n";
+
+        while (i < events.size()) {
+            if (events[i].rule == TRACE_INPUT) {
+                std::vector<unsigned int> input;
+                uint32_t first_rule = events[i].to;
+                bool whole = events[i].position == 0;
+
+                do {
+                    input.push_back(events[i].from);
+                    i++;
+                } while (i < events.size() && events[i].rule == TRACE_INPUT && events[i].position != 0);
+
+                // The ring dropped the start of this form
+                if (!whole) {
+                    continue;
+                }
+
+                // Derivations of later rules restate the form, which only matters after an edit
+                if (!known || input != form) {
+                    std::cout << "  /" << inventory.render(input) << "/"
+                              << (known ? " before rule " + std::to_string(first_rule + 1) : "") << "\n";
+                }
+
+                form = input;
+                known = true;
+                continue;
+            }
+
+            uint16_t rule = events[i].rule;
+            std::string changes;
+
+            for (; i < events.size() && events[i].rule == rule; i++) {
+                const trace::Event& event = events[i];
+
+                if (event.position < form.size()) {
+                    form[event.position] = event.to;
+                }
+
+                changes += (changes.empty() ? "" : ", ") + symbol(inventory, event.from) + " -> "
+                         + symbol(inventory, event.to) + " at " + std::to_string(event.position);
+            }
+
+            std::cout << "  rule " << rule + 1;
+
+            if (rule < rules.size()) {
+                const Rule& r = rules[rule];
+                std::cout << std::hex << " (" << r.get_cur_class() << " -> " << r.get_res_class() << " / "
+                          << r.get_prev_class() << " _ " << r.get_next_class() << ")" << std::dec;
+            }
+
+            std::cout << ": " << changes;
+
+            if (known) {
+                std::cout << " [" << inventory.render(form) << "]";
+            }
+
+            std::cout << "\n";
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    std::string lang = argv[2];
+    std::string path = argv[3];
+    trace::Settings settings;
+
+    // Every option takes a number
+    if ((argc - 4) % 2 != 0) {
+        print_usage();
+        return 1;
+    }
+
+    for (int i = 4; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        char* end;
+        unsigned long value = strtoul(argv[i + 1], &end, 10);
+
+        if (end == argv[i + 1] || *end != '\0' || argv[i + 1][0] == '-' || value > UINT32_MAX) {
+            print_usage();
+            return 1;
+        }
+
+        if (arg == "--sample") {
+            settings.sample = value;
+        } else if (arg == "--word") {
+            settings.word = value;
+        } else if (arg == "--rule" && value > 0) {
+            // Numbered from 1 on the command line
+            settings.rule = value - 1;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    // A language without rules derives every word unchanged
+    std::vector<Rule> rules;
+    load_rules("langs/" + lang + "/phonology/rules.csv", rules);
+
+    if (command == "record") {
+        return record(sound_system, rules, path, settings);
+    } else if (command == "decode") {
+        return decode(Inventory(sound_system), rules, path);
+    }
+
+    print_usage();
+    return 1;
+}
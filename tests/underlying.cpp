@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "phonotactics.h"
+#include "lexicon.h"
+#include "inverse.h"
+#include "metrics.h"
+
+/*
+ * Finds the underlying forms of surface forms under the rules of a language
+ *
+ * Usage: underlying <language> [--lexicon L] [--phonotactics] [--obligatory] [--limit N] [--threads N]
+ * Reads surface forms from stdin, one per line, and prints each with every
+ * underlying form the rules derive it from, followed by ... if there were
+ * more than the limit (1000 by default). --lexicon only keeps forms that are
+ * words of a lexicon file and --phonotactics only well-formed ones.
+ * Optional rules may be left out unless --obligatory is given.
+ *
+ * With --check N it instead builds N random words from the phonotactics of
+ * the language and checks that allows_prefix() accepts every prefix of each
+ * word validate() accepts, as pruning by phonotactics relies on that.
+ */
+
+#define CHECK_SEED 1        // Seed of the random words of --check, so failures can be repeated
+#define CHECK_SYLLABLES 4   // Most syllables of a random word if the phonotactics give no range
+
+static void print_usage() {
+    std::cerr << "Usage: underlying <language> [--lexicon L] [--phonotactics] [--obligatory] [--limit N] [--threads N] [--stats]\n";
+    std::cerr << "       underlying <language> --check N\n";
+}
+
+/* Random sequence of a constituent with the given length, or false if there is none */
+static bool pick(const Phonotactics& phonotactics, Constituent part, int len, std::mt19937& random,
+                 std::vector<unsigned int>& word) {
+
+    std::vector<const std::vector<unsigned int>*> options;
+
+    for (auto const& sequence: phonotactics.get_sequences(part)) {
+        if (static_cast<int>(sequence.size()) == len) {
+            options.push_back(&sequence);
+        }
+    }
+
+    if (options.empty()) {
+        return len == 0;
+    }
+
+    const std::vector<unsigned int>& sequence = *options[random() % options.size()];
+    word.insert(word.end(), sequence.begin(), sequence.end());
+    return true;
+}
+
+/* Random word of syllables with listed types and constituents, which validate() may still reject */
+static std::vector<unsigned int> random_word(const Phonotactics& phonotactics, std::mt19937& random) {
+    const std::vector<std::string>& types = phonotactics.get_types();
+    const std::vector<std::pair<int, int>>& num = phonotactics.get_num();
+    std::vector<unsigned int> word;
+
+    // Sometimes one syllable more than allowed, so words that are too long are checked as well
+    int syllables = 1 + random() % CHECK_SYLLABLES;
+
+    if (!num.empty()) {
+        const std::pair<int, int>& range = num[random() % num.size()];
+        syllables = std::max(range.first, 1) + random() % (std::max(range.second - range.first, 0) + 2);
+    }
+
+    for (int s = 0; s < syllables; s++) {
+        std::string type = types.empty() ? "CVC" : types[random() % types.size()];
+        size_t nucleus = type.find('V');
+        size_t coda = type.find('C', nucleus);
+        int lengths[3] = {
+            static_cast<int>(nucleus),
+            static_cast<int>((coda == std::string::npos ? type.size() : coda) - nucleus),
+            static_cast<int>(coda == std::string::npos ? 0 : type.size() - coda)
+        };
+
+        // Without types any onset and coda may be left out
+        if (types.empty()) {
+            lengths[0] = random() % 2;
+            lengths[2] = random() % 2;
+        }
+
+        for (int part = 0; part < 3; part++) {
+            if (!pick(phonotactics, static_cast<Constituent>(part), lengths[part], random, word)) {
+                return std::vector<unsigned int>();
+            }
+        }
+    }
+
+    return word;
+}
+
+/* Returns the number of valid words of which allows_prefix() rejects a prefix */
+static long check_prefixes(const Phonotactics& phonotactics, const Inventory& inventory, long count) {
+    std::mt19937 random(CHECK_SEED);
+    long valid = 0, failures = 0;
+
+    for (long n = 0; n < count; n++) {
+        std::vector<unsigned int> word = random_word(phonotactics, random);
+
+        if (word.empty() || !phonotactics.validate(word)) {
+            continue;
+        }
+
+        valid++;
+
+        for (size_t len = 1; len <= word.size(); len++) {
+            if (!phonotactics.allows_prefix(word.data(), len)) {
+                std::vector<unsigned int> prefix(word.begin(), word.begin() + len);
+                std::cerr << "/" << inventory.render(prefix) << "/ rejected as a prefix of /"
+                          << inventory.render(word) << "/\n";
+                failures++;
+                break;
+            }
+        }
+    }
+
+    std::cout << count << " random words, " << valid << " valid, " << failures << " with a rejected prefix\n";
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string lexicon_path;
+    bool use_phonotactics = false;
+    bool obligatory = false;
+    size_t limit = 1000;
+    int threads = 0;
+    long check = -1;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--phonotactics") {
+            use_phonotactics = true;
+        } else if (arg == "--obligatory") {
+            obligatory = true;
+        } else if (arg == "--lexicon" && i + 1 < argc) {
+            lexicon_path = argv[++i];
+        } else if (arg == "--limit" && i + 1 < argc) {
+            limit = std::stoul(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--check" && i + 1 < argc) {
+            char* end;
+            check = strtol(argv[++i], &end, 10);
+
+            if (end == argv[i] || *end != '\0' || check < 0) {
+                print_usage();
+                return 1;
+            }
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+
+    if (check >= 0) {
+        Phonotactics phonotactics(lang);
+
+        if (phonotactics.load()) {
+            std::cerr << "Could not load the phonotactics of " << lang << "\n";
+            return 1;
+        }
+
+        return check_prefixes(phonotactics, inventory, check) > 0 ? 1 : 0;
+    }
+
+    std::vector<Rule> rules;
+
+    if (load_rules("langs/" + lang + "/phonology/rules.csv", rules)) {
+        std::cerr << "Could not load the rules of " << lang << "\n";
+        return 1;
+    }
+
+    Inverse inverse(inventory, rules);
+    inverse.set_optional(!obligatory);
+    Phonotactics phonotactics(lang);
+    Lexicon lexicon;
+
+    if (use_phonotactics) {
+        if (phonotactics.load()) {
+            std::cerr << "Could not load the phonotactics of " << lang << "\n";
+            return 1;
+        }
+
+        inverse.set_phonotactics(&phonotactics);
+    }
+
+    if (!lexicon_path.empty()) {
+        if (lexicon.open(lexicon_path)) {
+            std::cerr << "Could not open lexicon " << lexicon_path << "\n";
+            return 1;
+        }
+
+        inverse.set_lexicon(&lexicon);
+    }
+
+    std::vector<std::string> lines;
+    std::vector<std::vector<unsigned int>> surfaces;
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.tokenize(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+            continue;
+        }
+
+        lines.push_back(line);
+        surfaces.push_back(word);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<bool> cut;
+    auto forms = inverse.invert_all(surfaces, limit, threads, &cut);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long total = 0;
+
+    for (size_t w = 0; w < surfaces.size(); w++) {
+        std::cout << "[" << lines[w] << "]";
+
+        for (auto const& form: forms[w]) {
+            std::cout << " /" << inventory.render(form) << "/";
+        }
+
+        std::cout << (cut[w] ? " ...\n" : "\n");
+        total += forms[w].size();
+    }
+
+    std::cerr << surfaces.size() << " surface forms, " << total << " underlying forms in "
+              << elapsed * 1000 << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "rule.h"
+#include "lattice.h"
+#include "metrics.h"
+
+/*
+ * Lists the likeliest outputs of words read from stdin under optional rules
+ *
+ * Usage: variants <language> [rules.csv] [count]
+ * Each line of input is one word, with phoneme symbols separated by spaces.
+ * Rules with a probability below 1 (the seventh column) are optional.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "Usage: variants <language> [rules.csv] [count] [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string path = argc > 2 ? argv[2] : "langs/" + lang + "/phonology/rules.csv";
+    int count = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    std::vector<Rule> rules;
+
+    if (load_rules(path, rules)) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    std::string line;
+
+    while (getline(std::cin, line)) {
+        std::vector<unsigned int> word;
+
+        if (inventory.parse(line, word)) {
+            std::cerr << "Unknown phoneme in '" << line << "'\n";
+            continue;
+        }
+
+        Lattice lattice = derive_lattice(inventory, rules, word);
+
+        std::cout << "/" << inventory.render(word) << "/: " << lattice.count() << " variants, "
+                  << lattice.get_node_count() << " nodes, " << lattice.get_edge_count() << " edges\n";
+
+        for (auto const& variant: lattice.best(count)) {
+            std::cout << "\t[" << inventory.render(variant.second) << "] " << std::exp(-variant.first) << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "soundsystem.h"
+#include "inventory.h"
+#include "phonotactics.h"
+#include "generator.h"
+#include "corpus.h"
+#include "ngram.h"
+#include "metrics.h"
+
+/*
+ * Trains phonotactic models, generates words and validates words
+ *
+ * Usage:
+ *  word_tool <language> train <corpus> <model>
+ *  word_tool <language> generate <count> [<model> <min average log probability>]
+ *  word_tool <language> validate [<model> <min average log probability>]
+ *
+ * Corpora ending in .txt, and words read by validate, have one word per line
+ * with phoneme symbols separated by spaces. Other corpora are binary IDs.
+ */
+int main(int argc, char* argv[]) {
+    metrics::enable_stats(argc, argv);
+
+    if (argc < 3) {
+        std::cerr << "Usage: word_tool <language> train|generate|validate ... [--stats]\n";
+        return 1;
+    }
+
+    std::string lang = argv[1];
+    std::string command = argv[2];
+
+    SoundSystem sound_system(lang);
+
+    if (sound_system.load()) {
+        std::cerr << "Could not find language named " << lang << "\n";
+        return 1;
+    }
+
+    Inventory inventory(sound_system);
+    Phonotactics phonotactics(lang);
+
+    if (phonotactics.load()) {
+        std::cerr << "Could not load " << lang << "'s phonotactics\n";
+        return 1;
+    }
+
+    if (command == "train") {
+        if (argc < 5) {
+            std::cerr << "Usage: word_tool <language> train <corpus> <model> [--stats]\n";
+            return 1;
+        }
+
+        std::string path = argv[3];
+        bool is_text = path.size() > 4 && path.compare(path.size() - 4, 4, ".txt") == 0;
+        std::ifstream file(path, is_text ? std::ios::in : std::ios::binary);
+
+        if (!file.is_open()) {
+            std::cerr << "Could not open " << path << "\n";
+            return 1;
+        }
+
+        CorpusReader reader(file, is_text ? &inventory : nullptr);
+        NgramModel model(inventory);
+
+        model.train(reader);
+
+        if (model.save(argv[4])) {
+            std::cerr << "Could not save model to " << argv[4] << "\n";
+            return 1;
+        }
+
+        std::cerr << model.get_trigram_count() << " trigrams\n";
+        return 0;
+    }
+
+    // Optional model used as a filter
+    int model_arg = command == "generate" ? 4 : 3;
+    bool use_model = argc > model_arg + 1;
+    double min_average = 0;
+    NgramModel model;
+
+    if (use_model) {
+        if (model.load(argv[model_arg])) {
+            std::cerr << "Could not load model from " << argv[model_arg] << "\n";
+            return 1;
+        }
+
+        char* end;
+        min_average = strtod(argv[model_arg + 1], &end);
+
+        if (end == argv[model_arg + 1] || *end != '\0') {
+            std::cerr << "Usage: word_tool <language> "
+                      << (command == "generate" ? "generate <count>" : "validate") << " [<model> <min>] [--stats]\n";
+            return 1;
+        }
+    }
+
+    if (command == "generate") {
+        if (argc < 4) {
+            std::cerr << "Usage: word_tool <language> generate <count> [<model> <min>] [--stats]\n";
+            return 1;
+        }
+
+        char* end;
+        long count = strtol(argv[3], &end, 10);
+
+        if (end == argv[3] || *end != '\0' || count < 0) {
+            std::cerr << "Usage: word_tool <language> generate <count> [<model> <min>] [--stats]\n";
+            return 1;
+        }
+
+        Generator generator(phonotactics, std::random_device()());
+        WordFilter filter;
+        std::vector<unsigned int> word;
+
+        if (use_model) {
+            filter = [&](const std::vector<unsigned int>& word) { return model.accepts(word, min_average); };
+        }
+
+        for (long i = 0; i < count; i++) {
+            if (generator.generate(word, filter)) {
+                std::cerr << "Could not generate a word\n";
+                return 1;
+            }
+
+            std::cout << inventory.render(word) << "\n";
+        }
+    } else if (command == "validate") {
+        std::string line;
+        std::vector<unsigned int> word;
+
+        while (getline(std::cin, line)) {
+            if (inventory.parse(line, word)) {
+                std::cout << line << "\tunknown phoneme\n";
+                continue;
+            }
+
+            std::cout << inventory.render(word);
+
+            if (use_model) {
+                std::cout << "\t" << model.average(word.data(), word.size());
+            }
+
+            if (!phonotactics.validate(word)) {
+                std::cout << "\tinvalid\n";
+            } else if (use_model && !model.accepts(word, min_average)) {
+                std::cout << "\timprobable\n";
+            } else {
+                std::cout << "\tok\n";
+            }
+        }
+    } else {
+        std::cerr << "Invalid command\n";
+        return 1;
+    }
+
+    return 0;
+}